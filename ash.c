@@ -0,0 +1,623 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Active session history.  A second connection samples the wait event and
+ * query of every active session ASH_HZ times a second, in between display
+ * updates, into ring buffers.  The display then shows which waits, queries
+ * and sessions the sampled active time of the last few seconds went to.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "ash.h"
+#include "display.h"
+#include "pg.h"
+#include "utils.h"
+
+char		fmt_header_ash[] =
+"    AAS  %ACT WAIT                                             ID QUERY";
+
+enum AshRowKind
+{
+	ASH_TITLE,
+	ASH_WAITS,
+	ASH_QUERIES,
+	ASH_SESSIONS
+};
+
+struct ash_sample
+{
+	long long	queryid;
+	unsigned int tick;			/* the sample the session was seen in */
+	int			pid;
+	int			wait;			/* index into waitnames */
+};
+
+struct ash_row
+{
+	int			kind;
+	long long	key;
+	int			count;
+	int			wait;			/* the wait sampled most often */
+};
+
+struct ash_query
+{
+	RB_ENTRY(ash_query) entry;
+	long long	queryid;
+	char	   *query;
+};
+
+int			ashquerycmp(struct ash_query *, struct ash_query *);
+
+RB_HEAD(ashquery, ash_query) head_query = RB_INITIALIZER(&head_query);
+RB_PROTOTYPE(ashquery, ash_query, entry, ashquerycmp)
+RB_GENERATE(ashquery, ash_query, entry, ashquerycmp)
+
+static PGconn *ash_conn = NULL;
+static struct timeval next_sample;
+static int	window = ASH_WINDOW;
+
+/* when each sample was taken, and the sessions seen in them */
+static struct timeval *ticks;
+static unsigned int ntick;
+static struct ash_sample *samples;
+static unsigned long nsamples;
+
+/* wait event names, the first being the one for not waiting */
+static char **waitnames;
+static int	nwaitnames;
+static int	waitnames_size;
+
+/* what is being displayed */
+static struct ash_sample *scratch;
+static struct ash_row *groups;
+static int	groups_size;
+static struct ash_row *rows;
+static int	rows_size;
+static int	nrows;
+static int	row_index;
+static unsigned int shown_ticks;
+static int	shown_count;
+static double shown_seconds;
+
+int
+ashquerycmp(struct ash_query *e1, struct ash_query *e2)
+{
+	return (e1->queryid < e2->queryid ? -1 : e1->queryid > e2->queryid);
+}
+
+static void *
+ash_alloc(void *ptr, size_t nmemb, size_t size)
+{
+	if ((ptr = reallocarray(ptr, nmemb, size)) == NULL)
+	{
+		fprintf(stderr, "reallocarray error\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+static int
+wait_index(char *type, char *event)
+{
+	char		name[NAMEDATALEN * 2];
+	int			i;
+
+	if (nwaitnames == 0)
+	{
+		waitnames_size = 64;
+		waitnames = ash_alloc(NULL, waitnames_size, sizeof(char *));
+		waitnames[nwaitnames++] = "CPU";
+	}
+
+	/* an active session not waiting on anything is using the cpu */
+	if (*type == '\0')
+		return 0;
+
+	if (*event == '\0')
+		snprintf(name, sizeof(name), "%s", type);
+	else
+		snprintf(name, sizeof(name), "%s:%s", type, event);
+
+	for (i = 1; i < nwaitnames; i++)
+		if (strcmp(waitnames[i], name) == 0)
+			return i;
+
+	if (nwaitnames == waitnames_size)
+	{
+		waitnames_size *= 2;
+		waitnames = ash_alloc(waitnames, waitnames_size, sizeof(char *));
+	}
+	waitnames[nwaitnames] = strdup(name);
+	return nwaitnames++;
+}
+
+int
+ash_running(void)
+{
+	return ash_conn != NULL;
+}
+
+int
+ash_window(void)
+{
+	return window;
+}
+
+void
+ash_set_window(int seconds)
+{
+	if (seconds > 0)
+		window = seconds;
+}
+
+/*
+ * Open the connection to take samples with.  The settings are copied from the
+ * connection already made, since the password is not kept for persistent
+ * connections.
+ */
+int
+ash_start(struct pg_conninfo_ctx *conninfo)
+{
+	PQconninfoOption *options,
+			   *option;
+	const char **keywords;
+	const char **values;
+	int			i = 0;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection == NULL)
+		return -1;
+	options = PQconninfo(conninfo->connection);
+	disconnect_from_db(conninfo);
+	if (options == NULL)
+		return -1;
+
+	for (option = options; option->keyword != NULL; option++)
+		i++;
+	keywords = ash_alloc(NULL, i + 1, sizeof(char *));
+	values = ash_alloc(NULL, i + 1, sizeof(char *));
+	for (i = 0, option = options; option->keyword != NULL; option++)
+	{
+		if (option->val == NULL)
+			continue;
+		keywords[i] = option->keyword;
+		values[i++] = option->val;
+	}
+	keywords[i] = NULL;
+	values[i] = NULL;
+
+	ash_conn = PQconnectdbParams(keywords, values, 0);
+	free(keywords);
+	free(values);
+	PQconninfoFree(options);
+
+	if (PQstatus(ash_conn) != CONNECTION_OK)
+	{
+		new_message(MT_standout | MT_delayed, " %s",
+					PQerrorMessage(ash_conn));
+		ash_stop();
+		return -1;
+	}
+	if (PQserverVersion(ash_conn) < 90200)
+	{
+		new_message(MT_standout | MT_delayed,
+					" Session history needs PostgreSQL 9.2 or later");
+		ash_stop();
+		return -1;
+	}
+	if (pg_ash_prepare(ash_conn) != 0)
+	{
+		new_message(MT_standout | MT_delayed, " %s",
+					PQerrorMessage(ash_conn));
+		ash_stop();
+		return -1;
+	}
+
+	if (samples == NULL)
+	{
+		ticks = ash_alloc(NULL, ASH_TICKS, sizeof(struct timeval));
+		samples = ash_alloc(NULL, ASH_SAMPLES, sizeof(struct ash_sample));
+		scratch = ash_alloc(NULL, ASH_SAMPLES, sizeof(struct ash_sample));
+	}
+	ntick = 0;
+	nsamples = 0;
+	gettimeofday(&next_sample, NULL);
+
+	return 0;
+}
+
+void
+ash_stop(void)
+{
+	PQfinish(ash_conn);
+	ash_conn = NULL;
+}
+
+/*
+ * Shorten timeout to when the next sample is due, if that is sooner.  Returns
+ * 1 if it was shortened.
+ */
+int
+ash_timeout(struct timeval *timeout)
+{
+	struct timeval now,
+				left;
+
+	if (ash_conn == NULL)
+		return 0;
+
+	gettimeofday(&now, NULL);
+	if (timercmp(&next_sample, &now, <))
+		timerclear(&left);
+	else
+		timersub(&next_sample, &now, &left);
+
+	if (timercmp(&left, timeout, >))
+		return 0;
+	*timeout = left;
+	return 1;
+}
+
+/* Take a sample if one is due. */
+void
+ash_sample(void)
+{
+	static const struct timeval interval = {0, 1000000 / ASH_HZ};
+	struct timeval now;
+	struct ash_sample *s;
+	PGresult   *pgresult;
+	int			i,
+				rows;
+
+	if (ash_conn == NULL)
+		return;
+
+	gettimeofday(&now, NULL);
+	if (timercmp(&now, &next_sample, <))
+		return;
+
+	/* keep to the rate, unless we fell behind */
+	timeradd(&next_sample, &interval, &next_sample);
+	if (timercmp(&next_sample, &now, <))
+		timeradd(&now, &interval, &next_sample);
+
+	pgresult = pg_ash_sample(ash_conn);
+	if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+	{
+		PQclear(pgresult);
+		if (PQstatus(ash_conn) == CONNECTION_BAD)
+			ash_stop();
+		return;
+	}
+
+	ticks[ntick % ASH_TICKS] = now;
+	rows = PQntuples(pgresult);
+	for (i = 0; i < rows; i++)
+	{
+		s = &samples[nsamples++ % ASH_SAMPLES];
+		s->tick = ntick;
+		s->pid = atoi(PQgetvalue(pgresult, i, ASH_PID));
+		s->wait = wait_index(PQgetvalue(pgresult, i, ASH_WAIT_EVENT_TYPE),
+							 PQgetvalue(pgresult, i, ASH_WAIT_EVENT));
+		s->queryid = strtoll(PQgetvalue(pgresult, i, ASH_QUERY_ID), NULL, 10);
+	}
+	ntick++;
+	PQclear(pgresult);
+}
+
+/* Sleep for the delay, taking samples along the way. */
+void
+ash_wait(struct timeval *delay)
+{
+	struct timeval deadline,
+				now,
+				timeout;
+	int			sampling;
+
+	gettimeofday(&now, NULL);
+	timeradd(&now, delay, &deadline);
+	for (;;)
+	{
+		gettimeofday(&now, NULL);
+		if (!timercmp(&now, &deadline, <))
+			break;
+		timersub(&deadline, &now, &timeout);
+		sampling = ash_timeout(&timeout);
+		select(0, NULL, NULL, NULL, &timeout);
+		if (sampling)
+			ash_sample();
+	}
+}
+
+/* Remember the text of the queries running now, for the query ids sampled. */
+static void
+update_queries(struct pg_conninfo_ctx *conninfo)
+{
+	struct ash_query *q,
+			   *p;
+	PGresult   *pgresult = NULL;
+	int			i,
+				rows = 0;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_ash_queries(conninfo->connection);
+		if (PQresultStatus(pgresult) == PGRES_TUPLES_OK)
+			rows = PQntuples(pgresult);
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		if ((q = malloc(sizeof(struct ash_query))) == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		memset(q, 0, sizeof(struct ash_query));
+		q->queryid = strtoll(PQgetvalue(pgresult, i, 0), NULL, 10);
+		if ((p = RB_INSERT(ashquery, &head_query, q)) != NULL)
+		{
+			free(q);
+			q = p;
+		}
+		update_str(&q->query, PQgetvalue(pgresult, i, 1));
+		printable(q->query);
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+	disconnect_from_db(conninfo);
+}
+
+static int
+compare_wait(const void *v1, const void *v2)
+{
+	const struct ash_sample *s1 = v1;
+	const struct ash_sample *s2 = v2;
+
+	return (s1->wait > s2->wait) - (s1->wait < s2->wait);
+}
+
+static int
+compare_query(const void *v1, const void *v2)
+{
+	const struct ash_sample *s1 = v1;
+	const struct ash_sample *s2 = v2;
+	int			result;
+
+	if ((result = (s1->queryid > s2->queryid) - (s1->queryid < s2->queryid)))
+		return result;
+	return compare_wait(v1, v2);
+}
+
+static int
+compare_session(const void *v1, const void *v2)
+{
+	const struct ash_sample *s1 = v1;
+	const struct ash_sample *s2 = v2;
+	int			result;
+
+	if ((result = (s1->pid > s2->pid) - (s1->pid < s2->pid)))
+		return result;
+	return compare_wait(v1, v2);
+}
+
+static int
+compare_count(const void *v1, const void *v2)
+{
+	const struct ash_row *r1 = v1;
+	const struct ash_row *r2 = v2;
+	int			result;
+
+	if ((result = (r1->count < r2->count) - (r1->count > r2->count)))
+		return result;
+	return (r1->key > r2->key) - (r1->key < r2->key);
+}
+
+static long long
+sample_key(int kind, struct ash_sample *s)
+{
+	switch (kind)
+	{
+		case ASH_QUERIES:
+			return s->queryid;
+		case ASH_SESSIONS:
+			return s->pid;
+		case ASH_WAITS:
+		default:
+			return s->wait;
+	}
+}
+
+/*
+ * Add a title row and the limit rows that most of the count samples went to,
+ * grouped by kind.
+ */
+static void
+aggregate(int kind, int count, int limit)
+{
+	int			(*compare) (const void *, const void *);
+	struct ash_row *g = NULL;
+	long long	key;
+	int			ngroups = 0;
+	int			run = 0;
+	int			best = 0;
+	int			i;
+
+	switch (kind)
+	{
+		case ASH_QUERIES:
+			compare = compare_query;
+			break;
+		case ASH_SESSIONS:
+			compare = compare_session;
+			break;
+		case ASH_WAITS:
+		default:
+			compare = compare_wait;
+	}
+	qsort(scratch, count, sizeof(struct ash_sample), compare);
+
+	/* count the samples for each key, and the wait seen most for it */
+	for (i = 0; i < count; i++)
+	{
+		key = sample_key(kind, &scratch[i]);
+		if (g == NULL || g->key != key)
+		{
+			if (ngroups == groups_size)
+			{
+				groups_size += 64;
+				groups = ash_alloc(groups, groups_size, sizeof(struct ash_row));
+			}
+			g = &groups[ngroups++];
+			g->kind = kind;
+			g->key = key;
+			g->count = 0;
+			best = 0;
+			run = 0;
+		}
+		else if (scratch[i].wait != scratch[i - 1].wait)
+			run = 0;
+		g->count++;
+		if (++run > best)
+		{
+			best = run;
+			g->wait = scratch[i].wait;
+		}
+	}
+	qsort(groups, ngroups, sizeof(struct ash_row), compare_count);
+
+	if (limit > ngroups)
+		limit = ngroups;
+	if (nrows + limit + 1 > rows_size)
+	{
+		rows_size = nrows + limit + 1;
+		rows = ash_alloc(rows, rows_size, sizeof(struct ash_row));
+	}
+	rows[nrows].kind = ASH_TITLE;
+	rows[nrows++].key = kind;
+	memcpy(&rows[nrows], groups, limit * sizeof(struct ash_row));
+	nrows += limit;
+}
+
+/*
+ * Gather the samples taken over the window and group them into at most topn
+ * rows, split between waits, queries and sessions.
+ */
+caddr_t
+get_ash_info(struct system_info *si, struct pg_conninfo_ctx *conninfo,
+			 int topn)
+{
+	struct timeval now,
+				since,
+				span;
+	struct ash_sample *s;
+	unsigned int first;
+	unsigned long i;
+	int			count = 0;
+	int			limit;
+
+	nrows = 0;
+	row_index = 0;
+	si->P_ACTIVE = 0;
+	if (ash_conn == NULL || ntick == 0)
+		return (caddr_t) 0;
+
+	update_queries(conninfo);
+
+	/* find the oldest sample in the window that is still kept */
+	gettimeofday(&now, NULL);
+	since = now;
+	since.tv_sec -= window;
+	first = ntick;
+	while (first > 0 && ntick - first < ASH_TICKS &&
+		   !timercmp(&ticks[(first - 1) % ASH_TICKS], &since, <))
+		first--;
+
+	/* and the sessions seen since then, as far back as they are kept */
+	for (i = nsamples; i > 0 && nsamples - i < ASH_SAMPLES; i--)
+	{
+		s = &samples[(i - 1) % ASH_SAMPLES];
+		if (s->tick < first)
+			break;
+		scratch[count++] = *s;
+	}
+	if (i > 0 && nsamples - i == ASH_SAMPLES && count > 0)
+	{
+		/* the oldest sample may have only been kept in part */
+		first = scratch[count - 1].tick + 1;
+		while (count > 0 && scratch[count - 1].tick < first)
+			count--;
+	}
+
+	shown_ticks = ntick - first;
+	shown_count = count;
+	if (shown_ticks == 0)
+		return (caddr_t) 0;
+	timersub(&ticks[(ntick - 1) % ASH_TICKS], &ticks[first % ASH_TICKS], &span);
+	shown_seconds = span.tv_sec + span.tv_usec / 1e6 + 1.0 / ASH_HZ;
+
+	if ((limit = (topn - 3) / 3) < 1)
+		limit = 1;
+	aggregate(ASH_WAITS, count, limit);
+	aggregate(ASH_QUERIES, count, limit);
+	aggregate(ASH_SESSIONS, count, limit);
+
+	si->P_ACTIVE = nrows;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_ash(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		id[21];
+	struct ash_row *r = &rows[row_index++];
+	struct ash_query key,
+			   *q;
+	double		aas = (double) r->count / shown_ticks;
+	double		pct = shown_count > 0 ? r->count * 100.0 / shown_count : 0;
+
+	switch (r->kind)
+	{
+		case ASH_TITLE:
+			if (r->key == ASH_WAITS)
+				snprintf(fmt, sizeof(fmt),
+						 "Top waits over %.0f seconds, %u samples, %.2f average active sessions",
+						 shown_seconds, shown_ticks,
+						 (double) shown_count / shown_ticks);
+			else if (r->key == ASH_QUERIES)
+				snprintf(fmt, sizeof(fmt), "Top queries");
+			else
+				snprintf(fmt, sizeof(fmt), "Top sessions");
+			break;
+		case ASH_QUERIES:
+			key.queryid = r->key;
+			q = RB_FIND(ashquery, &head_query, &key);
+			if (r->key == 0)
+				strcpy(id, "-");
+			else
+				snprintf(id, sizeof(id), "%lld", r->key);
+			snprintf(fmt, sizeof(fmt), "%7.2f %5.1f %-30.30s %20s %s",
+					 aas, pct, waitnames[r->wait], id,
+					 q != NULL ? q->query : "");
+			break;
+		case ASH_SESSIONS:
+			snprintf(fmt, sizeof(fmt), "%7.2f %5.1f %-30.30s %20lld",
+					 aas, pct, waitnames[r->wait], r->key);
+			break;
+		case ASH_WAITS:
+		default:
+			snprintf(fmt, sizeof(fmt), "%7.2f %5.1f %s",
+					 aas, pct, waitnames[r->key]);
+	}
+
+	return (fmt);
+}
@@ -0,0 +1,33 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _ASH_H_
+#define _ASH_H_
+
+#include <sys/time.h>
+
+#include "machine.h"
+
+/* Samples taken per second. */
+#define ASH_HZ 20
+
+/* Default number of seconds of history shown. */
+#define ASH_WINDOW 60
+
+/* Number of samples and sampled sessions kept in the ring buffers. */
+#define ASH_TICKS 65536
+#define ASH_SAMPLES 262144
+
+int			ash_running(void);
+void		ash_sample(void);
+void		ash_set_window(int);
+int			ash_start(struct pg_conninfo_ctx *);
+void		ash_stop(void);
+int			ash_timeout(struct timeval *);
+void		ash_wait(struct timeval *);
+int			ash_window(void);
+caddr_t		get_ash_info(struct system_info *, struct pg_conninfo_ctx *, int);
+char	   *format_next_ash(caddr_t);
+
+extern char fmt_header_ash[];
+
+#endif							/* _ASH_H_ */
@@ -0,0 +1,466 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Blocking sessions: the sessions waiting on a lock drawn as trees under the
+ * session at the head of each chain, from a single sample of pg_locks and
+ * pg_blocking_pids(), with the number of granted and waiting locks by mode.
+ *
+ * A session waiting on more than one other is drawn under the first of them.
+ * Sessions in a cycle, a deadlock that has not been detected yet, are drawn
+ * under whichever of them is reached first.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+
+#include "display.h"
+#include "blocking.h"
+#include "pg.h"
+#include "utils.h"
+
+/* deepest level of a tree that is indented */
+#define MAX_INDENT 5
+
+char		fmt_header_blocking[] =
+"  PID               BLOCKS   WAIT MODE               RELATION             STATE  QUERY";
+
+struct blocker
+{
+	int			pid;
+	int			row;			/* row of the session in the sample */
+	int			parent;			/* the session it is drawn under, or -1 */
+	int			nblockers;		/* number of sessions it waits on */
+	int			blocks;			/* number of sessions waiting behind it */
+	int			depth;
+	int			child;			/* first session drawn under it, or -1 */
+	int			sibling;		/* next session with the same parent, or -1 */
+	int			visited;
+	double		wait;			/* seconds waiting, or -1 if unknown */
+	char	   *mode;
+	char	   *relation;
+	char	   *state;
+	char	   *query;
+};
+
+static struct blocker *blockers;
+static int	blockers_size;
+static int	nblockers;
+
+/* scratch space for putting sessions in order, as indexes into blockers */
+static int *order;
+
+/* the order the sessions are shown in, as indexes into blockers */
+static int *shown;
+static int	nshown;
+static int	shown_index;
+
+/* the sample the sessions refer to */
+static PGresult *sample = NULL;
+
+/* summary of granted and waiting locks by mode */
+static char summary[MAX_COLS];
+
+/* the sessions of the last sample as rows, for recording them */
+static struct blocking_row *rowtable;
+static int	rowtable_size;
+
+static int
+compare_pid(const void *v1, const void *v2)
+{
+	const struct blocker *p1 = (const struct blocker *) v1;
+	const struct blocker *p2 = (const struct blocker *) v2;
+
+	return (p1->pid > p2->pid) - (p1->pid < p2->pid);
+}
+
+/* longest waiting first */
+static int
+compare_wait(const void *v1, const void *v2)
+{
+	const struct blocker *p1 = &blockers[*(const int *) v1];
+	const struct blocker *p2 = &blockers[*(const int *) v2];
+	int			result;
+
+	if ((result = (p2->wait > p1->wait) - (p2->wait < p1->wait)) == 0)
+		result = (p1->pid > p2->pid) - (p1->pid < p2->pid);
+	return result;
+}
+
+/* most sessions blocked first */
+static int
+compare_blocks(const void *v1, const void *v2)
+{
+	const struct blocker *p1 = &blockers[*(const int *) v1];
+	const struct blocker *p2 = &blockers[*(const int *) v2];
+	int			result;
+
+	if ((result = (p2->blocks > p1->blocks) - (p2->blocks < p1->blocks)) == 0)
+		result = (p1->pid > p2->pid) - (p1->pid < p2->pid);
+	return result;
+}
+
+static int
+find_blocker(int pid)
+{
+	struct blocker key;
+	struct blocker *p;
+
+	key.pid = pid;
+	p = bsearch(&key, blockers, nblockers, sizeof(struct blocker), compare_pid);
+	return p == NULL ? -1 : (int) (p - blockers);
+}
+
+/* Count the sessions waiting behind a session. */
+static int
+count_blocked(int i)
+{
+	int			c;
+
+	blockers[i].visited = 1;
+	blockers[i].blocks = 0;
+	for (c = blockers[i].child; c != -1; c = blockers[c].sibling)
+		if (!blockers[c].visited)
+			blockers[i].blocks += 1 + count_blocked(c);
+	return blockers[i].blocks;
+}
+
+/* Put a session and the ones waiting behind it in the order shown. */
+static void
+show_tree(int i, int depth)
+{
+	int			c;
+
+	blockers[i].visited = 1;
+	blockers[i].depth = depth;
+	shown[nshown++] = i;
+	for (c = blockers[i].child; c != -1; c = blockers[c].sibling)
+		if (!blockers[c].visited)
+			show_tree(c, depth + 1);
+}
+
+static void
+update_summary(PGresult *pgresult, int rows)
+{
+	char	   *s = summary;
+	char	   *end = summary + sizeof(summary);
+	char	   *mode;
+	size_t		len;
+	int			i;
+
+	s += snprintf(s, end - s, "Locks granted/waiting:");
+	for (i = 0; i < rows && s < end; i++)
+	{
+		if (!PQgetisnull(pgresult, i, BLOCK_PID))
+			continue;
+
+		/* every mode ends in "Lock", which is left out */
+		mode = PQgetvalue(pgresult, i, BLOCK_MODE);
+		len = strlen(mode);
+		if (len > 4 && strcmp(mode + len - 4, "Lock") == 0)
+			len -= 4;
+		s += snprintf(s, end - s, " %.*s %s/%s", (int) len, mode,
+					  PQgetvalue(pgresult, i, BLOCK_GRANTED),
+					  PQgetvalue(pgresult, i, BLOCK_WAITING));
+	}
+}
+
+/*
+ * Sample the sessions waiting on locks and put them in the order they are
+ * shown: the session at the head of the chain blocking the most sessions
+ * first, each followed by the sessions waiting behind it, longest waiting
+ * first.
+ */
+caddr_t
+get_blocking_info(struct system_info *si, struct pg_conninfo_ctx *conninfo)
+{
+	struct blocker *n;
+	PGresult   *pgresult = NULL;
+	int		   *o1,
+			   *o2;
+	char	   *s,
+			   *end;
+	int			rows = 0;
+	int			i,
+				j,
+				k,
+				head,
+				pid;
+
+	if (sample != NULL)
+		PQclear(sample);
+	sample = NULL;
+	nblockers = 0;
+	nshown = 0;
+	shown_index = 0;
+	summary[0] = '\0';
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_blocking(conninfo->connection);
+		if (pgresult == NULL)
+		{
+			new_message(MT_standout | MT_delayed,
+						" Blocking sessions need PostgreSQL 9.6 or later");
+		}
+		else if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+		{
+			new_message(MT_standout | MT_delayed, " %s",
+						PQresultErrorMessage(pgresult));
+			PQclear(pgresult);
+			pgresult = NULL;
+		}
+		else
+		{
+			rows = PQntuples(pgresult);
+		}
+	}
+	disconnect_from_db(conninfo);
+
+	if (rows + 1 > blockers_size)
+	{
+		n = reallocarray(blockers, rows + 1, sizeof(struct blocker));
+		o1 = reallocarray(order, rows + 1, sizeof(int));
+		o2 = reallocarray(shown, rows + 1, sizeof(int));
+		if (n == NULL || o1 == NULL || o2 == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		blockers = n;
+		order = o1;
+		shown = o2;
+		blockers_size = rows + 1;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		if (PQgetisnull(pgresult, i, BLOCK_PID))
+			continue;
+
+		n = &blockers[nblockers++];
+		memset(n, 0, sizeof(struct blocker));
+		n->pid = atoi(PQgetvalue(pgresult, i, BLOCK_PID));
+		n->row = i;
+		n->parent = -1;
+		n->child = -1;
+		n->sibling = -1;
+		if (PQgetisnull(pgresult, i, BLOCK_WAIT))
+			n->wait = -1;
+		else
+			n->wait = atof(PQgetvalue(pgresult, i, BLOCK_WAIT));
+		n->mode = PQgetvalue(pgresult, i, BLOCK_MODE);
+		n->relation = PQgetvalue(pgresult, i, BLOCK_RELATION);
+		n->state = PQgetvalue(pgresult, i, BLOCK_STATE);
+		n->query = printable(PQgetvalue(pgresult, i, BLOCK_QUERY));
+	}
+	if (rows > 0)
+		update_summary(pgresult, rows);
+	sample = pgresult;
+
+	qsort(blockers, nblockers, sizeof(struct blocker), compare_pid);
+
+	/* link each waiting session to the first session blocking it */
+	for (i = 0; i < nblockers; i++)
+	{
+		if (PQgetisnull(sample, blockers[i].row, BLOCK_BLOCKERS))
+			continue;
+
+		/* the array of pids is formatted as {pid,pid,...} */
+		s = PQgetvalue(sample, blockers[i].row, BLOCK_BLOCKERS);
+		while (*s != '\0')
+		{
+			if (*s == '{' || *s == ',')
+			{
+				++s;
+				continue;
+			}
+			pid = (int) strtol(s, &end, 10);
+			if (end == s)
+				break;
+			s = end;
+			if (blockers[i].nblockers++ == 0)
+				blockers[i].parent = find_blocker(pid);
+		}
+	}
+
+	/* add each session to the ones drawn under its parent, longest first */
+	for (i = 0; i < nblockers; i++)
+		order[i] = i;
+	qsort(order, nblockers, sizeof(int), compare_wait);
+	for (i = nblockers - 1; i >= 0; i--)
+	{
+		n = &blockers[order[i]];
+		if (n->parent == -1)
+			continue;
+		n->sibling = blockers[n->parent].child;
+		blockers[n->parent].child = order[i];
+	}
+
+	/*
+	 * The heads of the chains are the sessions not waiting on one that is
+	 * shown, followed by one session from each cycle.  Following the parents
+	 * of a session not reached from a head for as many steps as there are
+	 * sessions is sure to end in a cycle.
+	 */
+	j = 0;
+	for (i = 0; i < nblockers; i++)
+	{
+		if (blockers[i].parent == -1)
+		{
+			order[j++] = i;
+			count_blocked(i);
+		}
+	}
+	for (i = 0; i < nblockers; i++)
+	{
+		if (!blockers[i].visited)
+		{
+			head = i;
+			for (k = 0; k < nblockers; k++)
+				head = blockers[head].parent;
+			order[j++] = head;
+			count_blocked(head);
+		}
+	}
+	qsort(order, j, sizeof(int), compare_blocks);
+
+	for (i = 0; i < nblockers; i++)
+		blockers[i].visited = 0;
+	for (i = 0; i < j; i++)
+		if (!blockers[order[i]].visited)
+			show_tree(order[i], 0);
+
+	/* the summary is shown first */
+	si->P_ACTIVE = summary[0] != '\0' ? nshown + 1 : 0;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_blocking(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		pid[32];
+	char		blocks[16];
+	struct blocker *p;
+	int			depth;
+
+	if (shown_index++ == 0)
+		return summary;
+
+	p = &blockers[shown[shown_index - 2]];
+	depth = p->depth < MAX_INDENT ? p->depth : MAX_INDENT;
+
+	/* a pid of 0 is a prepared transaction */
+	if (p->pid == 0)
+		snprintf(pid, sizeof(pid), "%*sprepared", depth * 2, "");
+	else
+		snprintf(pid, sizeof(pid), "%*s%d%s", depth * 2, "", p->pid,
+				 p->nblockers > 1 ? "*" : "");
+
+	if (p->blocks > 0)
+		snprintf(blocks, sizeof(blocks), "%d", p->blocks);
+	else
+		blocks[0] = '\0';
+
+	snprintf(fmt, sizeof(fmt),
+			 "%-19s %6s %6s %-18.18s %-20.20s %-6.6s %s",
+			 pid,
+			 blocks,
+			 p->wait >= 0 ? format_time((long) p->wait) : "",
+			 p->mode,
+			 p->relation,
+			 p->state,
+			 p->query);
+
+	return (fmt);
+}
+
+/* The sessions of the last sample as rows to be recorded, in the order shown. */
+int
+get_blocking_rows(struct blocking_row **rows, char **lines)
+{
+	struct blocking_row *r;
+	struct blocker *p;
+	int			i;
+
+	if (nshown > rowtable_size)
+	{
+		r = reallocarray(rowtable, nshown, sizeof(struct blocking_row));
+		if (r == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		rowtable = r;
+		rowtable_size = nshown;
+	}
+
+	for (i = 0; i < nshown; i++)
+	{
+		p = &blockers[shown[i]];
+		r = &rowtable[i];
+		r->pid = p->pid;
+		r->depth = p->depth;
+		r->nblockers = p->nblockers;
+		r->blocks = p->blocks;
+		r->wait = p->wait;
+		r->mode = p->mode;
+		r->relation = p->relation;
+		r->state = p->state;
+		r->query = p->query;
+	}
+
+	*lines = summary;
+	*rows = rowtable;
+	return nshown;
+}
+
+/* Show recorded sessions as if they were sampled, in the order recorded. */
+caddr_t
+put_blocking_rows(struct system_info *si, struct blocking_row *rows,
+				  int nrows, char *lines)
+{
+	struct blocker *n;
+	int		   *o1,
+			   *o2;
+	int			i;
+
+	if (nrows + 1 > blockers_size)
+	{
+		n = reallocarray(blockers, nrows + 1, sizeof(struct blocker));
+		o1 = reallocarray(order, nrows + 1, sizeof(int));
+		o2 = reallocarray(shown, nrows + 1, sizeof(int));
+		if (n == NULL || o1 == NULL || o2 == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		blockers = n;
+		order = o1;
+		shown = o2;
+		blockers_size = nrows + 1;
+	}
+
+	for (i = 0; i < nrows; i++)
+	{
+		n = &blockers[i];
+		memset(n, 0, sizeof(struct blocker));
+		n->pid = rows[i].pid;
+		n->depth = rows[i].depth;
+		n->nblockers = rows[i].nblockers;
+		n->blocks = rows[i].blocks;
+		n->wait = rows[i].wait;
+		n->mode = rows[i].mode;
+		n->relation = rows[i].relation;
+		n->state = rows[i].state;
+		n->query = rows[i].query;
+		shown[i] = i;
+	}
+	nblockers = nshown = nrows;
+	shown_index = 0;
+	snprintf(summary, sizeof(summary), "%s", lines);
+
+	si->P_ACTIVE = summary[0] != '\0' ? nshown + 1 : 0;
+	return (caddr_t) 0;
+}
@@ -0,0 +1,30 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _BLOCKING_H_
+#define _BLOCKING_H_
+
+#include "machine.h"
+
+/* a session of the last sample, in the order shown, as it is recorded */
+struct blocking_row
+{
+	int			pid;
+	int			depth;
+	int			nblockers;
+	int			blocks;
+	double		wait;
+	char	   *mode;
+	char	   *relation;
+	char	   *state;
+	char	   *query;
+};
+
+caddr_t		get_blocking_info(struct system_info *, struct pg_conninfo_ctx *);
+char	   *format_next_blocking(caddr_t);
+int			get_blocking_rows(struct blocking_row **, char **);
+caddr_t		put_blocking_rows(struct system_info *, struct blocking_row *, int,
+							  char *);
+
+extern char fmt_header_blocking[];
+
+#endif							/* _BLOCKING_H_ */
@@ -28,6 +28,9 @@
 
 #include "sigdesc.h"			/* generated automatically */
 #include "pg_top.h"
+#include "ash.h"
+#include "fleet.h"
+#include "record.h"
 #include "boolean.h"
 #include "utils.h"
 #include "version.h"
@@ -54,29 +57,68 @@ struct cmd	cmd_map[] = {
 	{'\014', cmd_redraw},
 	{'#', cmd_number},
 	{' ', cmd_update},
+	{'+', cmd_faster},
+	{'-', cmd_slower},
+	{'<', cmd_step_back},
+	{'>', cmd_step},
 	{'?', cmd_help},
 	{'A', cmd_explain_analyze},
+	{'B', cmd_blocking},
 	{'a', cmd_activity},
 	{'c', cmd_cmdline},
 #ifdef ENABLE_COLOR
 	{'C', cmd_color},
 #endif							/* ENABLE_COLOR */
 	{'d', cmd_displays},
+	{'D', cmd_database},
 	{'E', cmd_explain},
+	{'F', cmd_fleet},
+	{'g', cmd_goto},
+	{'G', cmd_topology},
+	{'H', cmd_history},
 	{'h', cmd_help},
 	{'i', cmd_idletog},
 	{'I', cmd_io},
+	{'K', cmd_pgbouncer},
 	{'L', cmd_locks},
 	{'n', cmd_number},
+	{'O', cmd_slots},
 	{'o', cmd_order},
+	{'p', cmd_pause},
+	{'P', cmd_progress},
 	{'q', cmd_quit},
 	{'R', cmd_replication},
 	{'Q', cmd_current_query},
 	{'s', cmd_delay},
+	{'S', cmd_statements},
+	{'T', cmd_tables},
 	{'u', cmd_user},
+	{'w', cmd_window},
+	{'[', cmd_rewind},
+	{']', cmd_forward},
 	{'\0', NULL},
 };
 
+/* the commands that need no sampling, for when attached to a pg_top serving */
+static char attached_commands[] = "\014# ?Cdhnqs";
+
+/*
+ * and those that move about a recording, or show or sort what it recorded
+ * differently, for when replaying one
+ */
+static char replay_commands[] = "+-<>[]gpaBHIKOPRSTiou";
+
+/* Say that a command only moves about a recording, if not replaying one. */
+static int
+not_replaying(struct pg_top_context *pgtctx)
+{
+	if (pgtctx->replay != NULL)
+		return No;
+	new_message(MT_standout, " Only available when replaying a recording");
+	putchar('\r');
+	return Yes;
+}
+
 int
 cmd_activity(struct pg_top_context *pgtctx)
 {
@@ -87,6 +129,16 @@ cmd_activity(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_blocking(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_BLOCKING;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
 #ifdef ENABLE_COLOR
 int
 cmd_color(struct pg_top_context *pgtctx)
@@ -160,6 +212,24 @@ cmd_current_query(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_database(struct pg_top_context *pgtctx)
+{
+	char		tempbuf[NAMEDATALEN + 1];
+
+	new_message(MT_standout, "Database to show activity for: ");
+	if (readline(tempbuf, sizeof(tempbuf), No) > 0)
+	{
+		pg_database_stats(strcmp(tempbuf, "+") == 0 ? NULL : tempbuf);
+		putchar('\r');
+	}
+	else
+	{
+		clear_message();
+	}
+	return No;
+}
+
 int
 cmd_delay(struct pg_top_context *pgtctx)
 {
@@ -173,6 +243,7 @@ cmd_delay(struct pg_top_context *pgtctx)
 		{
 			pgtctx->delay = 1;
 		}
+		pgtctx->delay_usec = 0;
 	}
 	clear_message();
 	return No;
@@ -228,6 +299,97 @@ cmd_explain_analyze(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_faster(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_speed(2);
+	return No;
+}
+
+/*
+ * Show the fleet of servers, or when it is showing, connect the other displays
+ * to one of them.
+ */
+int
+cmd_fleet(struct pg_top_context *pgtctx)
+{
+	char		tempbuf[256];
+	int			i;
+
+	if (pgtctx->mode == MODE_FLEET)
+	{
+		new_message(MT_standout, "Server to show: ");
+		if (readline(tempbuf, sizeof(tempbuf), No) <= 0)
+		{
+			clear_message();
+			return No;
+		}
+		if ((i = fleet_find(tempbuf)) == -1)
+		{
+			new_message(MT_standout, " %s: no such server", tempbuf);
+			putchar('\r');
+			return Yes;
+		}
+		new_message(MT_standout | MT_delayed, " Showing %s",
+					fleet_select(&pgtctx->conninfo, i));
+		putchar('\r');
+		pgtctx->mode = MODE_PROCESSES;
+	}
+	else
+	{
+		pgtctx->mode = MODE_FLEET;
+	}
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
+int
+cmd_forward(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_seek(60);
+	return No;
+}
+
+int
+cmd_goto(struct pg_top_context *pgtctx)
+{
+	char		tempbuf[16];
+	int			hour,
+				minute,
+				second = 0;
+
+	if (not_replaying(pgtctx))
+		return Yes;
+
+	new_message(MT_standout, "Time to go to (HH:MM[:SS]): ");
+	if (readline(tempbuf, sizeof(tempbuf), No) > 0)
+	{
+		if (sscanf(tempbuf, "%d:%d:%d", &hour, &minute, &second) < 2 ||
+			hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+			second < 0 || second > 59)
+		{
+			new_message(MT_standout, " Bad time: %s", tempbuf);
+			putchar('\r');
+			return Yes;
+		}
+		if (replay_goto(hour, minute, second) == -1)
+		{
+			new_message(MT_standout, " The recording ends before %s",
+						tempbuf);
+			putchar('\r');
+			return Yes;
+		}
+	}
+	clear_message();
+	return No;
+}
+
 int
 cmd_help(struct pg_top_context *pgtctx)
 {
@@ -238,6 +400,16 @@ cmd_help(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_history(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_ASH;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
 int
 cmd_idletog(struct pg_top_context *pgtctx)
 {
@@ -307,6 +479,35 @@ cmd_number(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_pause(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_pause();
+	return No;
+}
+
+int
+cmd_pgbouncer(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_PGBOUNCER;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
+int
+cmd_progress(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_PROGRESS;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
 int
 cmd_quit(struct pg_top_context *pgtctx)
 {
@@ -315,6 +516,15 @@ cmd_quit(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_rewind(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_seek(-60);
+	return No;
+}
+
 int
 cmd_replication(struct pg_top_context *pgtctx)
 {
@@ -331,8 +541,11 @@ cmd_order(struct pg_top_context *pgtctx)
 	int			i;
 	int			no_command = No;
 	char		tempbuf[50];
+	char	  **order_names;
+	int		   *order_index;
 
-	if (pgtctx->statics.order_names == NULL)
+	order_names = mode_order_names(pgtctx, &order_index);
+	if (order_names == NULL)
 	{
 		new_message(MT_standout, " Ordering not supported.");
 		putchar('\r');
@@ -343,7 +556,7 @@ cmd_order(struct pg_top_context *pgtctx)
 		new_message(MT_standout, "Order to sort: ");
 		if (readline(tempbuf, sizeof(tempbuf), No) > 0)
 		{
-			i = string_index(tempbuf, pgtctx->statics.order_names);
+			i = string_index(tempbuf, order_names);
 			if (i == -1)
 			{
 				new_message(MT_standout, " %s: unrecognized sorting order",
@@ -352,7 +565,7 @@ cmd_order(struct pg_top_context *pgtctx)
 			}
 			else
 			{
-				pgtctx->order_index = i;
+				*order_index = i;
 			}
 			putchar('\r');
 		}
@@ -407,6 +620,73 @@ cmd_redraw(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_slots(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_SLOTS;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
+int
+cmd_slower(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_speed(0.5);
+	return No;
+}
+
+int
+cmd_statements(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_STATEMENTS;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
+int
+cmd_step(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_step(1);
+	return No;
+}
+
+int
+cmd_step_back(struct pg_top_context *pgtctx)
+{
+	if (not_replaying(pgtctx))
+		return Yes;
+	replay_step(-1);
+	return No;
+}
+
+int
+cmd_tables(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_RELATIONS;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
+int
+cmd_topology(struct pg_top_context *pgtctx)
+{
+	pgtctx->mode = MODE_TOPOLOGY;
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	reset_display(pgtctx);
+	return No;
+}
+
 int
 cmd_update(struct pg_top_context *pgtctx)
 {
@@ -431,6 +711,22 @@ cmd_user(struct pg_top_context *pgtctx)
 	return No;
 }
 
+int
+cmd_window(struct pg_top_context *pgtctx)
+{
+	int			i;
+	char		tempbuf[50];
+
+	new_message(MT_standout, "Seconds of session history to show (currently %d): ",
+				ash_window());
+	if ((i = readline(tempbuf, 8, Yes)) > 0)
+	{
+		ash_set_window(i);
+	}
+	clear_message();
+	return No;
+}
+
 int
 execute_command(struct pg_top_context *pgtctx, char ch)
 {
@@ -438,6 +734,22 @@ execute_command(struct pg_top_context *pgtctx, char ch)
 
 	cmap = cmd_map;
 
+	if (pgtctx->attach != NULL && strchr(attached_commands, ch) == NULL)
+	{
+		new_message(MT_standout, " Not available when attached to %s",
+					pgtctx->attach);
+		putchar('\r');
+		return Yes;
+	}
+	if (pgtctx->replay != NULL && strchr(attached_commands, ch) == NULL &&
+		strchr(replay_commands, ch) == NULL)
+	{
+		new_message(MT_standout, " Not available when replaying %s",
+					pgtctx->replay);
+		putchar('\r');
+		return Yes;
+	}
+
 	while (cmap->func != NULL)
 	{
 		if (cmap->ch == ch)
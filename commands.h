@@ -19,28 +19,46 @@ struct cmd
 #define EXPLAIN_ANALYZE 1
 
 int			cmd_activity(struct pg_top_context *);
+int			cmd_blocking(struct pg_top_context *);
 #ifdef ENABLE_COLOR
 int			cmd_color(struct pg_top_context *);
 #endif							/* ENABLE_COLOR */
 int			cmd_cmdline(struct pg_top_context *);
 int			cmd_current_query(struct pg_top_context *);
+int			cmd_database(struct pg_top_context *);
 int			cmd_delay(struct pg_top_context *);
 int			cmd_displays(struct pg_top_context *);
 int			cmd_explain(struct pg_top_context *);
 int			cmd_explain_analyze(struct pg_top_context *);
+int			cmd_faster(struct pg_top_context *);
+int			cmd_fleet(struct pg_top_context *);
+int			cmd_forward(struct pg_top_context *);
+int			cmd_goto(struct pg_top_context *);
 int			cmd_help(struct pg_top_context *);
+int			cmd_history(struct pg_top_context *);
 int			cmd_idletog(struct pg_top_context *);
 int			cmd_indexes(struct pg_top_context *);
 int			cmd_io(struct pg_top_context *);
 int			cmd_locks(struct pg_top_context *);
 int			cmd_number(struct pg_top_context *);
+int			cmd_pause(struct pg_top_context *);
+int			cmd_pgbouncer(struct pg_top_context *);
+int			cmd_progress(struct pg_top_context *);
 int			cmd_quit(struct pg_top_context *);
 int			cmd_replication(struct pg_top_context *);
+int			cmd_rewind(struct pg_top_context *);
 int			cmd_order(struct pg_top_context *);
 int			cmd_redraw(struct pg_top_context *);
+int			cmd_slots(struct pg_top_context *);
+int			cmd_slower(struct pg_top_context *);
 int			cmd_statements(struct pg_top_context *);
+int			cmd_step(struct pg_top_context *);
+int			cmd_step_back(struct pg_top_context *);
+int			cmd_tables(struct pg_top_context *);
+int			cmd_topology(struct pg_top_context *);
 int			cmd_update(struct pg_top_context *);
 int			cmd_user(struct pg_top_context *);
+int			cmd_window(struct pg_top_context *);
 
 int			execute_command(struct pg_top_context *, char);
 
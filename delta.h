@@ -0,0 +1,94 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#include <time.h>
+
+/*
+ * Counters are sampled into arrays of two, with an index to the element of
+ * the latest sample.
+ */
+
+/* The change in a counter since the previous sample. */
+static inline long long
+diff_stat(long long value[2], int index)
+{
+	return value[index] - value[(index + 1) % 2];
+}
+
+/* The change in a counter per second, or 0 if no time has passed. */
+static inline double
+rate_stat(long long value[2], int index, double seconds)
+{
+	if (seconds <= 0)
+		return 0;
+	return diff_stat(value, index) / seconds;
+}
+
+/* Seconds on a clock that is not set back, to time samples with. */
+static inline double
+sample_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* most counters in a row of statistics */
+#define DELTA_STATS 16
+
+/*
+ * A row of statistics, such as the one row of pg_stat_wal, sampled into two
+ * arrays the same way, with when each was taken.
+ */
+struct delta_stats
+{
+	double		value[2][DELTA_STATS];
+	double		time[2];
+	int			index;
+	int			samples;
+};
+
+/* The array to take the next sample into, which becomes the latest. */
+static inline double *
+delta_next(struct delta_stats *d)
+{
+	d->index = (d->index + 1) % 2;
+	d->time[d->index] = sample_time();
+	d->samples++;
+	return d->value[d->index];
+}
+
+/*
+ * The change in the first n counters of the row over the last two samples,
+ * -1 where a counter is not known, as when the server does not report it,
+ * and 0 where it went backwards, as when the statistics are reset.  Returns
+ * the seconds between the samples, or 0 when there are not two of them.
+ */
+static inline double
+delta_diff(struct delta_stats *d, double *delta, int n)
+{
+	double	   *cur = d->value[d->index];
+	double	   *prev = d->value[(d->index + 1) % 2];
+	double		seconds;
+	int			i;
+
+	if (d->samples < 2)
+		return 0;
+	seconds = d->time[d->index] - d->time[(d->index + 1) % 2];
+	if (seconds <= 0)
+		return 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (cur[i] < 0 || prev[i] < 0)
+			delta[i] = -1;
+		else
+			delta[i] = cur[i] > prev[i] ? cur[i] - prev[i] : 0;
+	}
+	return seconds;
+}
+
+#endif							/* _DELTA_H_ */
@@ -71,6 +71,10 @@ static int	x_mem = X_MEM;
 static int	y_mem = Y_MEM;
 static int	x_swap = -1;
 static int	y_swap = -1;
+static int	y_diskstats = -1;
+static int	y_dbstats = -1;
+static int	y_walstats = -1;
+static int	y_bgwstats = -1;
 static int	y_message = Y_MESSAGE;
 static int	x_header = X_HEADER;
 static int	y_header = Y_HEADER;
@@ -126,6 +130,8 @@ static int	header_cidx;
 static int *cpustate_cidx;
 static int *memory_cidx;
 static int *swap_cidx;
+static int	fpi_cidx;
+static int	ckpt_req_cidx;
 #endif
 static int	header_color = 0;
 
@@ -583,8 +589,9 @@ summary_format_memory(int x, int y, long *numbers, char **names, int *cidx)
 	if (lastname == NULL)
 	{
 		/*
-		 * Don't show anything if the data doesn't exist.
+		 * Show that none of the data is known.
 		 */
+		display_write(x, y, 0, 1, "-");
 		return;
 	}
 	else if ((num = strlen(lastname)) > 1 &&
@@ -702,6 +709,37 @@ display_init(struct statics *statics)
 		y_swap = Y_SWAP;
 	}
 
+	/* then the disk activity, where it is known */
+	if (statics->flags.diskstats)
+	{
+		y_diskstats = y_message;
+		y_message++;
+		y_header++;
+		y_idlecursor++;
+		y_procs++;
+	}
+
+	/* the database activity goes on the line after that */
+	y_dbstats = y_message;
+	y_message++;
+	y_header++;
+	y_idlecursor++;
+	y_procs++;
+
+	/* followed by the WAL activity */
+	y_walstats = y_message;
+	y_message++;
+	y_header++;
+	y_idlecursor++;
+	y_procs++;
+
+	/* and the checkpointer activity */
+	y_bgwstats = y_message;
+	y_message++;
+	y_header++;
+	y_idlecursor++;
+	y_procs++;
+
 	/* call resize to do the dirty work */
 	lines = display_resize();
 
@@ -773,6 +811,12 @@ display_init(struct statics *statics)
 		strcpy(p, homogenize(swap_names[i] + 1));
 		swap_cidx[i++] = color_tag(scratchbuf);
 	}
+
+	/* color tag for the share of full page images after a checkpoint */
+	fpi_cidx = color_tag("wal.fpi");
+
+	/* color tag for the checkpoints started on request */
+	ckpt_req_cidx = color_tag("checkpoint.req");
 #endif
 
 	/* return number of lines available (or error) */
@@ -787,8 +831,13 @@ pr_loadavg(double avg, int i)
 #ifdef ENABLE_COLOR
 	color = color_test(load_cidx[i], (int) (avg * 100));
 #endif
-	display_fmt(x_loadave + X_LOADAVEWIDTH * i, y_loadave, color, 0,
-				avg < 10.0 ? " %5.2f" : " %5.1f", avg);
+	/* a negative load average is not known */
+	if (avg < 0)
+		display_write(x_loadave + X_LOADAVEWIDTH * i, y_loadave, 0, 0,
+					  "     -");
+	else
+		display_fmt(x_loadave + X_LOADAVEWIDTH * i, y_loadave, color, 0,
+					avg < 10.0 ? " %5.2f" : " %5.1f", avg);
 	display_write(-1, -1, 0, 0, (i < 2 ? "," : ";"));
 }
 
@@ -800,13 +849,21 @@ i_loadave(int mpid, double *avenrun)
 	/* i_loadave also clears the screen, since it is first */
 	display_clear();
 
-	/* mpid == -1 implies this system doesn't have an _mpid */
-	if (mpid != -1)
+	/*
+	 * mpid == -1 implies this system doesn't have an _mpid, and 0 that it
+	 * is not known
+	 */
+	if (mpid > 0)
 	{
 		display_fmt(0, 0, 0, 0,
 					"last pid: %5d;  load avg:", mpid);
 		x_loadave = X_LOADAVE;
 	}
+	else if (mpid == 0)
+	{
+		display_write(0, 0, 0, 0, "last pid:     -;  load avg:");
+		x_loadave = X_LOADAVE;
+	}
 	else
 	{
 		display_write(0, 0, 0, 0, "load averages:");
@@ -830,8 +887,11 @@ u_loadave(int mpid, double *avenrun)
 		/* change screen only when value has really changed */
 		if (mpid != lmpid)
 		{
-			display_fmt(x_lastpid, y_lastpid, 0, 0,
-						"%5d", mpid);
+			if (mpid == 0)
+				display_write(x_lastpid, y_lastpid, 0, 0, "    -");
+			else
+				display_fmt(x_lastpid, y_lastpid, 0, 0,
+							"%5d", mpid);
 			lmpid = mpid;
 		}
 	}
@@ -1034,12 +1094,17 @@ i_cpustates(int64_t * states)
 			color = color_test(*cidx++, value / 10);
 #endif
 
+			/* a negative percentage is not known */
+			if (value < 0)
+				display_fmt(x_cpustates + *colp, y_cpustates, 0, 0,
+							"   -%% %s", thisname);
 			/* if percentage is >= 1000, print it as 100% */
-			display_fmt(x_cpustates + *colp, y_cpustates,
-						color, 0,
-						(value >= 1000 ? "%4.0f%% %s" : "%4.1f%% %s"),
-						((float) value) / 10.,
-						thisname);
+			else
+				display_fmt(x_cpustates + *colp, y_cpustates,
+							color, 0,
+							(value >= 1000 ? "%4.0f%% %s" : "%4.1f%% %s"),
+							((float) value) / 10.,
+							thisname);
 			if (*names != NULL)
 				display_write(-1, -1, 0, 0, ",");
 
@@ -1087,12 +1152,18 @@ u_cpustates(int64_t * states)
 				color = color_test(*cidx, value / 10);
 #endif
 
+				/* a negative percentage is not known */
+				if (value < 0)
+					display_fmt(x_cpustates + *colp, y_cpustates, 0, 0,
+								"   -%% %s", thisname);
 				/* if percentage is >= 1000, print it as 100% */
-				display_fmt(x_cpustates + *colp, y_cpustates,
-							color, 0,
-							(value >= 1000 ? "%4.0f%% %s" : "%4.1f%% %s"),
-							((float) value) / 10.,
-							thisname);
+				else
+					display_fmt(x_cpustates + *colp, y_cpustates,
+								color, 0,
+								(value >= 1000 ? "%4.0f%% %s" :
+								 "%4.1f%% %s"),
+								((float) value) / 10.,
+								thisname);
 				if (*names != NULL)
 					display_write(-1, -1, 0, 0, ",");
 
@@ -1126,12 +1197,15 @@ z_cpustates()
 	{
 		if (*thisname != '\0')
 		{
-			display_fmt(-1, -1, 0, 0, "%s    %% %s", i++ == 0 ? "" : ", ",
+			display_fmt(-1, -1, 0, 0, "%s   -%% %s", i++ == 0 ? "" : ", ",
 						thisname);
 		}
 	}
 
-	/* fill the "last" array with all -1s, to insure correct updating */
+	/*
+	 * fill the "last" array with all -1s, as not known, to insure correct
+	 * updating
+	 */
 	lp = lcpustates;
 	i = num_cpustates;
 	while (--i >= 0)
@@ -1195,6 +1269,217 @@ u_swap(long *stats)
 	}
 }
 
+/*
+ *	*_diskstats(info) - print "Disk: " followed by the reads and writes of
+ *	the whole disks per second, and how busy the busiest of them was
+ */
+
+void
+i_diskstats(struct disk_info *info)
+{
+	char		line[MAX_COLS];
+	char	   *p = line;
+	char	   *end = line + sizeof(line);
+
+	if (y_diskstats < 0 || info == NULL)
+		return;
+
+	p += snprintf(p, end - p, "Disk: ");
+	if (info->reads < 0)
+		p += snprintf(p, end - p, "-");
+	else
+	{
+		p += snprintf(p, end - p, "%s read/s", format_n(info->reads));
+		p += snprintf(p, end - p, " %s/s", format_b(info->read_bytes));
+		p += snprintf(p, end - p, ", %s write/s", format_n(info->writes));
+		p += snprintf(p, end - p, " %s/s", format_b(info->write_bytes));
+		if (info->busy >= 0 && info->busiest != NULL)
+			snprintf(p, end - p, ", %.1f%% busy %s", info->busy,
+					 info->busiest);
+	}
+	if (strlen(line) > display_width)
+		line[display_width] = '\0';
+	display_write(0, y_diskstats, 0, 1, line);
+}
+
+void
+u_diskstats(struct disk_info *info)
+{
+	i_diskstats(info);
+}
+
+/*
+ *	*_dbstats(info) - print "DB: " followed by the activity of the database,
+ *	or of all of them
+ */
+
+void
+i_dbstats(struct db_info *info)
+{
+	char		hit[8];
+	char		line[MAX_COLS];
+
+	if (info->hit < 0)
+		strcpy(hit, "-");
+	else
+		snprintf(hit, sizeof(hit), "%.1f%%", info->hit);
+
+	snprintf(line, sizeof(line),
+			 "DB %s: %s commit/s, %s rollback/s, %s ret/s, %s fetch/s, %s mod/s, %s hit, %s temp/s, %lld deadlocks",
+			 info->datname != NULL ? info->datname : "all",
+			 format_n(info->commits),
+			 format_n(info->rollbacks),
+			 format_n(info->returned),
+			 format_n(info->fetched),
+			 format_n(info->modified),
+			 hit,
+			 format_b(info->temp_bytes),
+			 info->deadlocks);
+
+	/* truncate the line to conform to our current screen width */
+	if (strlen(line) > display_width)
+		line[display_width] = '\0';
+	display_write(0, y_dbstats, 0, 1, line);
+}
+
+void
+u_dbstats(struct db_info *info)
+{
+	i_dbstats(info);
+}
+
+/*
+ *	*_walstats(info) - print "WAL: " followed by the rate WAL is written at and
+ *	what pg_stat_wal says about it.  The share of full page images is colored
+ *	when a checkpoint started since the last update.
+ */
+
+void
+i_walstats(struct wal_info *info)
+{
+	char		line[MAX_COLS];
+	char		fpi[32];
+	char	   *p = line;
+	char	   *end = line + sizeof(line);
+	int			color = 0;
+	size_t		len;
+
+	p += snprintf(p, end - p, "WAL: %s/s",
+				  info->bytes >= 0 ? format_b(info->bytes) : "-");
+	if (info->records >= 0)
+		p += snprintf(p, end - p, ", %s rec/s", format_n(info->records));
+	len = strlen(line);
+	if (len > display_width)
+		line[len = display_width] = '\0';
+	display_write(0, y_walstats, 0, 0, line);
+
+	if (info->fpi >= 0)
+	{
+#ifdef ENABLE_COLOR
+		if (info->checkpoint)
+			color = color_test(fpi_cidx, (int) info->fpi);
+#endif
+		snprintf(fpi, sizeof(fpi), ", %.1f%% FPI%s", info->fpi,
+				 info->checkpoint ? " after checkpoint" : "");
+		if (len + strlen(fpi) > display_width)
+			fpi[display_width - len] = '\0';
+		len += strlen(fpi);
+		display_write(-1, -1, color, 0, fpi);
+	}
+
+	p = line;
+	line[0] = '\0';
+	if (info->buffers_full >= 0)
+		p += snprintf(p, end - p, ", %s full/s", format_n(info->buffers_full));
+	if (info->writes >= 0)
+	{
+		p += snprintf(p, end - p, ", %s write/s", format_n(info->writes));
+		if (info->write_time >= 0)
+			p += snprintf(p, end - p, " %.2fms", info->write_time);
+	}
+	if (info->syncs >= 0)
+	{
+		p += snprintf(p, end - p, ", %s sync/s", format_n(info->syncs));
+		if (info->sync_time >= 0)
+			p += snprintf(p, end - p, " %.2fms", info->sync_time);
+	}
+	if (len + strlen(line) > display_width)
+		line[display_width - len] = '\0';
+	display_write(-1, -1, 0, 1, line);
+}
+
+void
+u_walstats(struct wal_info *info)
+{
+	i_walstats(info);
+}
+
+/*
+ *	*_bgwstats(info) - print "Checkpoints: " followed by the checkpoints
+ *	started since the last update, the time spent writing and syncing them,
+ *	and the rate buffers are written at by the checkpointer, the background
+ *	writer and the backends.  Checkpoints started on request are colored.
+ */
+
+void
+i_bgwstats(struct bgwriter_info *info)
+{
+	char		line[MAX_COLS];
+	char		req[32];
+	char	   *p = line;
+	char	   *end = line + sizeof(line);
+	int			color = 0;
+	size_t		len;
+
+	p += snprintf(p, end - p, "Checkpoints: ");
+	if (info->timed >= 0)
+		p += snprintf(p, end - p, "%.0f timed", info->timed);
+	else
+		p += snprintf(p, end - p, "-");
+	len = strlen(line);
+	if (len > display_width)
+		line[len = display_width] = '\0';
+	display_write(0, y_bgwstats, 0, 0, line);
+
+	if (info->requested >= 0)
+	{
+#ifdef ENABLE_COLOR
+		color = color_test(ckpt_req_cidx, (int) info->requested);
+#endif
+		snprintf(req, sizeof(req), ", %.0f requested", info->requested);
+		if (len + strlen(req) > display_width)
+			req[display_width - len] = '\0';
+		len += strlen(req);
+		display_write(-1, -1, color, 0, req);
+	}
+
+	p = line;
+	line[0] = '\0';
+	if (info->write_time >= 0)
+		p += snprintf(p, end - p, ", %.0fms write", info->write_time);
+	if (info->sync_time >= 0)
+		p += snprintf(p, end - p, ", %.0fms sync", info->sync_time);
+	if (info->checkpointer >= 0)
+		p += snprintf(p, end - p, "; buffers %s/s checkpointer",
+					  format_n(info->checkpointer));
+	if (info->bgwriter >= 0)
+		p += snprintf(p, end - p, ", %s/s bgwriter",
+					  format_n(info->bgwriter));
+	if (info->maxwritten >= 0)
+		p += snprintf(p, end - p, " (%.0f maxwritten)", info->maxwritten);
+	if (info->backend >= 0)
+		p += snprintf(p, end - p, ", %s/s backend", format_n(info->backend));
+	if (len + strlen(line) > display_width)
+		line[display_width - len] = '\0';
+	display_write(-1, -1, 0, 1, line);
+}
+
+void
+u_bgwstats(struct bgwriter_info *info)
+{
+	i_bgwstats(info);
+}
+
 /*
  *	*_message() - print the next pending message line, or erase the one
  *				  that is there.
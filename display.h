@@ -28,6 +28,14 @@ void		i_memory(long *stats);
 void		u_memory(long *stats);
 void		i_swap(long *stats);
 void		u_swap(long *stats);
+void		i_diskstats(struct disk_info *info);
+void		u_diskstats(struct disk_info *info);
+void		i_dbstats(struct db_info *info);
+void		u_dbstats(struct db_info *info);
+void		i_walstats(struct wal_info *info);
+void		u_walstats(struct wal_info *info);
+void		i_bgwstats(struct bgwriter_info *info);
+void		u_bgwstats(struct bgwriter_info *info);
 void		i_message();
 void		u_message();
 void		i_header(char *text);
@@ -0,0 +1,810 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Fleet of servers: one row for each of a list of servers, with its sessions,
+ * transactions per second, cpu use, the wait most of its active sessions are
+ * on, and how far behind its replication is.
+ *
+ * The servers are sampled all at once.  Each keeps a connection that is used
+ * without blocking, and an update waits on all of them together, until they
+ * have all answered or FLEET_TIMEOUT is up.  A server that has not answered by
+ * then is shown with its last sample, and is not asked again until it does.
+ * The topology display is drawn from the same samples.
+ */
+
+#include "os.h"
+#include <ctype.h>
+#include <errno.h>
+#include <bsd/stdlib.h>
+#include <sys/select.h>
+
+#include "display.h"
+#include "fleet.h"
+#include "pg.h"
+#include "pg_top.h"
+#include "utils.h"
+
+/* the counters of a server, in its delta_stats */
+enum ServerStat
+{
+	SERVER_STAT_XACTS,
+	SERVER_STAT_BUSY,			/* cpu time, -1 if unknown */
+	SERVER_STAT_TOTAL,
+	SERVER_STATS
+};
+
+char		fmt_header_fleet[] =
+"  # SERVER               ROLE      SESS ACTIVE      TPS  CPU% WAIT                        LAG STATUS";
+
+static int	compare_active(const void *, const void *);
+static int	compare_cpu(const void *, const void *);
+static int	compare_lag(const void *, const void *);
+static int	compare_server(const void *, const void *);
+static int	compare_tps(const void *, const void *);
+
+char	   *fleet_ordernames[] = {
+	"server", "active", "tps", "cpu", "lag", NULL
+};
+
+int			(*fleet_compares[]) () =
+{
+	compare_server,
+		compare_active,
+		compare_tps,
+		compare_cpu,
+		compare_lag,
+		NULL
+};
+
+/* the settings that can be given on the command line, as for connect_to_db() */
+static const char *default_keywords[] = {
+	"host", "port", "user", "password", "dbname"
+};
+
+static struct fleet_server *servers;
+static int	nservers;
+static struct fleet_server **servertable;
+static int	server_index;
+
+static void *
+fleet_alloc(void *ptr, size_t nmemb, size_t size)
+{
+	if ((ptr = reallocarray(ptr, nmemb, size)) == NULL)
+	{
+		fprintf(stderr, "reallocarray error\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+/* Append keyword='value' to the connection string in buf, ending at s. */
+static char *
+add_param(char *buf, char *s, const char *keyword, const char *value)
+{
+	s += sprintf(s, "%s%s='", s == buf ? "" : " ", keyword);
+	for (; *value != '\0'; value++)
+	{
+		if (*value == '\'' || *value == '\\')
+			*s++ = '\\';
+		*s++ = *value;
+	}
+	*s++ = '\'';
+	*s = '\0';
+	return s;
+}
+
+/*
+ * Add a server from a line of the list, with the settings given on the
+ * command line for what the line does not set.  A line naming a service takes
+ * all its settings from the service file.
+ */
+static int
+add_server(char *line, const char **defaults)
+{
+	PQconninfoOption *options,
+			   *option;
+	const char *values[PG_DBNAME + 1];
+	const char *service = NULL;
+	char	   *errmsg = NULL;
+	struct fleet_server *s;
+	size_t		size = 1;
+	char	   *p;
+	int			i;
+
+	if ((options = PQconninfoParse(line, &errmsg)) == NULL)
+	{
+		fprintf(stderr, "%s: %s", line, errmsg != NULL ? errmsg :
+				"out of memory\n");
+		PQfreemem(errmsg);
+		return -1;
+	}
+
+	for (i = PG_HOST; i <= PG_DBNAME; i++)
+		values[i] = NULL;
+	for (option = options; option->keyword != NULL; option++)
+	{
+		if (option->val == NULL)
+			continue;
+		size += strlen(option->keyword) + 2 * strlen(option->val) + 4;
+		if (strcmp(option->keyword, "service") == 0)
+			service = option->val;
+		for (i = PG_HOST; i <= PG_DBNAME; i++)
+			if (strcmp(option->keyword, default_keywords[i]) == 0)
+				values[i] = option->val;
+	}
+	for (i = PG_HOST; i <= PG_DBNAME; i++)
+	{
+		if (service != NULL || values[i] != NULL || defaults[i] == NULL)
+			continue;
+		size += strlen(default_keywords[i]) + 2 * strlen(defaults[i]) + 4;
+		values[i] = defaults[i];
+	}
+
+	servers = fleet_alloc(servers, nservers + 1, sizeof(struct fleet_server));
+	s = &servers[nservers];
+	memset(s, 0, sizeof(struct fleet_server));
+	s->number = ++nservers;
+	s->lag = -1;
+	s->position = -1;
+	s->tps = -1;
+	s->cpu = -1;
+	if (values[PG_HOST] != NULL)
+		s->host = strdup(values[PG_HOST]);
+
+	s->conninfo = p = fleet_alloc(NULL, size, 1);
+	*p = '\0';
+	for (option = options; option->keyword != NULL; option++)
+		if (option->val != NULL)
+			p = add_param(s->conninfo, p, option->keyword, option->val);
+	for (i = PG_HOST; i <= PG_DBNAME; i++)
+		if (service == NULL && values[i] == defaults[i] && values[i] != NULL)
+			p = add_param(s->conninfo, p, default_keywords[i], values[i]);
+
+	/* name it after the service, or where it is */
+	size = (service != NULL ? strlen(service) :
+			(values[PG_HOST] != NULL ? strlen(values[PG_HOST]) : 5) +
+			(values[PG_PORT] != NULL ? strlen(values[PG_PORT]) : 0) +
+			(values[PG_DBNAME] != NULL ? strlen(values[PG_DBNAME]) : 0)) + 3;
+	s->name = fleet_alloc(NULL, size, 1);
+	if (service != NULL)
+		snprintf(s->name, size, "%s", service);
+	else
+		snprintf(s->name, size, "%s%s%s%s%s",
+				 values[PG_HOST] != NULL ? values[PG_HOST] : "local",
+				 values[PG_PORT] != NULL ? ":" : "",
+				 values[PG_PORT] != NULL ? values[PG_PORT] : "",
+				 values[PG_DBNAME] != NULL ? "/" : "",
+				 values[PG_DBNAME] != NULL ? values[PG_DBNAME] : "");
+	printable(s->name);
+
+	PQconninfoFree(options);
+	return 0;
+}
+
+/*
+ * Read the servers to show from a file, one connection string per line, with
+ * the settings given on the command line as defaults.  A file in the format of
+ * pg_service.conf adds a server for each of its services instead, and is used
+ * as the service file.  Without a file, the fleet is the one server given on
+ * the command line.  Returns the number of servers, or -1 on error.
+ */
+int
+fleet_init(char *filename, const char **defaults)
+{
+	FILE	   *file;
+	char	   *line = NULL;
+	size_t		linesize = 0;
+	char	   *start,
+			   *end;
+	char	   *service;
+	int			services = 0;
+	int			result = 0;
+
+	if (filename == NULL)
+	{
+		if (add_server("", defaults) != 0)
+			return -1;
+		servertable = fleet_alloc(NULL, nservers, sizeof(struct fleet_server *));
+		return nservers;
+	}
+
+	if ((file = fopen(filename, "r")) == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	while (result == 0 && getline(&line, &linesize, file) != -1)
+	{
+		for (start = line; isspace((unsigned char) *start); start++)
+			;
+		for (end = start + strlen(start);
+			 end > start && isspace((unsigned char) end[-1]); end--)
+			;
+		*end = '\0';
+		if (*start == '\0' || *start == '#')
+			continue;
+
+		if (*start == '[' && end[-1] == ']')
+		{
+			end[-1] = '\0';
+			service = malloc(strlen(start) + sizeof("service="));
+			if (service == NULL)
+			{
+				fprintf(stderr, "malloc error\n");
+				exit(1);
+			}
+			sprintf(service, "service=%s", start + 1);
+			result = add_server(service, defaults);
+			free(service);
+			services++;
+		}
+		else if (services == 0)
+		{
+			/* the settings of a service are not servers */
+			result = add_server(start, defaults);
+		}
+	}
+	free(line);
+	fclose(file);
+
+	if (result != 0)
+		return -1;
+	if (nservers == 0)
+	{
+		fprintf(stderr, "%s: no servers listed\n", filename);
+		return -1;
+	}
+	if (services > 0 && setenv("PGSERVICEFILE", filename, 1) != 0)
+	{
+		fprintf(stderr, "setenv error\n");
+		return -1;
+	}
+
+	servertable = fleet_alloc(NULL, nservers, sizeof(struct fleet_server *));
+	return nservers;
+}
+
+int
+fleet_servers(void)
+{
+	return nservers;
+}
+
+struct fleet_server *
+fleet_server(int i)
+{
+	return &servers[i];
+}
+
+/* Find a server by its number or name, returning its index or -1. */
+int
+fleet_find(char *which)
+{
+	char	   *end;
+	long		number;
+	int			i;
+
+	number = strtol(which, &end, 10);
+	if (*end == '\0' && number >= 1 && number <= nservers)
+		return number - 1;
+	for (i = 0; i < nservers; i++)
+		if (strcmp(servers[i].name, which) == 0)
+			return i;
+	return -1;
+}
+
+/*
+ * Connect the other displays to a server of the fleet instead, returning its
+ * name.
+ */
+char *
+fleet_select(struct pg_conninfo_ctx *conninfo, int i)
+{
+	int			j;
+
+	/* a persistent connection freed its settings once it was made */
+	if (!conninfo->persistent || conninfo->kept == NULL)
+		for (j = PG_HOST; j <= PG_DBNAME; j++)
+			free((void *) conninfo->values[j]);
+	if (conninfo->kept != NULL)
+		PQfinish(conninfo->kept);
+	conninfo->kept = NULL;
+	conninfo->connection = NULL;
+
+	for (j = PG_HOST; j <= PG_DBNAME; j++)
+		conninfo->values[j] = NULL;
+	conninfo->values[PG_DBNAME] = strdup(servers[i].conninfo);
+
+	/* what was sampled from the last server says nothing about this one */
+	pg_reset_stats();
+
+	return servers[i].name;
+}
+
+static void
+server_error(struct fleet_server *s, char *message)
+{
+	char	   *end;
+
+	update_str(&s->error, message);
+	if ((end = strchr(s->error, '\n')) != NULL)
+		*end = '\0';
+	printable(s->error);
+}
+
+/* Give up on the connection; the next update makes a new one. */
+static void
+server_lost(struct fleet_server *s, char *message)
+{
+	server_error(s, message);
+	PQfinish(s->conn);
+	s->conn = NULL;
+	s->state = SERVER_IDLE;
+	s->flushing = 0;
+	s->stats.samples = 0;
+	PQclear(s->downstream);
+	s->downstream = NULL;
+}
+
+static void
+server_send(struct fleet_server *s, int state)
+{
+	int			sent;
+
+	if (state == SERVER_PROBING)
+		sent = pg_fleet_probe(s->conn);
+	else
+		sent = pg_fleet_sample(s->conn, s->cputime);
+	if (!sent)
+	{
+		server_lost(s, PQerrorMessage(s->conn));
+		return;
+	}
+	s->state = state;
+	s->flushing = 1;
+	s->result = 0;
+}
+
+/* The seconds connect_timeout sets for the connection, or FLEET_TIMEOUT. */
+static int
+connect_timeout(PGconn *conn)
+{
+	PQconninfoOption *options,
+			   *option;
+	int			timeout = FLEET_TIMEOUT;
+
+	if ((options = PQconninfo(conn)) == NULL)
+		return timeout;
+	for (option = options; option->keyword != NULL; option++)
+		if (strcmp(option->keyword, "connect_timeout") == 0 &&
+			option->val != NULL && atoi(option->val) > 0)
+			timeout = atoi(option->val);
+	PQconninfoFree(options);
+	return timeout;
+}
+
+/* Connect to the server, or ask it for a sample if it is connected. */
+static void
+server_start(struct fleet_server *s)
+{
+	static const char *keywords[] = {"dbname", NULL};
+	const char *values[2];
+
+	if (s->state != SERVER_IDLE || s->unsupported)
+		return;
+
+	if (s->conn != NULL)
+	{
+		server_send(s, SERVER_SAMPLING);
+		return;
+	}
+
+	values[0] = s->conninfo;
+	values[1] = NULL;
+	s->conn = PQconnectStartParams(keywords, values, 1);
+	if (s->conn == NULL)
+	{
+		server_error(s, "out of memory");
+		return;
+	}
+	if (PQstatus(s->conn) == CONNECTION_BAD)
+	{
+		server_lost(s, PQerrorMessage(s->conn));
+		return;
+	}
+	s->state = SERVER_CONNECTING;
+	s->polling = PGRES_POLLING_WRITING;
+	gettimeofday(&s->give_up, NULL);
+	s->give_up.tv_sec += connect_timeout(s->conn);
+}
+
+static long long
+get_count(PGresult *pgresult, int column)
+{
+	if (PQgetisnull(pgresult, 0, column))
+		return -1;
+	return strtoll(PQgetvalue(pgresult, 0, column), NULL, 10);
+}
+
+static double
+get_time(PGresult *pgresult, int column)
+{
+	if (PQgetisnull(pgresult, 0, column))
+		return -1;
+	return atof(PQgetvalue(pgresult, 0, column));
+}
+
+static void
+update_server(struct fleet_server *s, PGresult *pgresult)
+{
+	double	   *value;
+	double		delta[SERVER_STATS];
+	double		seconds;
+
+	value = delta_next(&s->stats);
+	value[SERVER_STAT_XACTS] = get_count(pgresult, FLEET_XACTS);
+	value[SERVER_STAT_BUSY] = get_time(pgresult, FLEET_CPU_BUSY);
+	value[SERVER_STAT_TOTAL] = get_time(pgresult, FLEET_CPU_TOTAL);
+
+	s->sessions = get_count(pgresult, FLEET_SESSIONS);
+	s->active = get_count(pgresult, FLEET_ACTIVE);
+	/* on a standby, what was received can be behind what was replayed */
+	s->lag = get_count(pgresult, FLEET_LAG_BYTES);
+	if (s->lag < 0 && !PQgetisnull(pgresult, 0, FLEET_LAG_BYTES))
+		s->lag = 0;
+	s->recovery = *PQgetvalue(pgresult, 0, FLEET_IN_RECOVERY) == 't';
+	update_str(&s->wait, PQgetvalue(pgresult, 0, FLEET_WAIT_EVENT));
+	s->position = get_count(pgresult, FLEET_POSITION);
+	update_str(&s->cluster_name, PQgetvalue(pgresult, 0, FLEET_CLUSTER_NAME));
+	update_str(&s->address, PQgetvalue(pgresult, 0, FLEET_ADDRESS));
+
+	s->tps = -1;
+	s->cpu = -1;
+	if ((seconds = delta_diff(&s->stats, delta, SERVER_STATS)) > 0)
+	{
+		if (delta[SERVER_STAT_XACTS] >= 0)
+			s->tps = delta[SERVER_STAT_XACTS] / seconds;
+		if (delta[SERVER_STAT_BUSY] >= 0 && delta[SERVER_STAT_TOTAL] > 0)
+			s->cpu = delta[SERVER_STAT_BUSY] * 100.0 /
+				delta[SERVER_STAT_TOTAL];
+	}
+
+	s->answered = 1;
+	free(s->error);
+	s->error = NULL;
+}
+
+/* Carry on with whatever the server was doing, now that it can. */
+static void
+server_step(struct fleet_server *s)
+{
+	PGresult   *pgresult;
+
+	if (s->state == SERVER_CONNECTING)
+	{
+		s->polling = PQconnectPoll(s->conn);
+		if (s->polling == PGRES_POLLING_FAILED)
+		{
+			server_lost(s, PQerrorMessage(s->conn));
+		}
+		else if (s->polling == PGRES_POLLING_OK)
+		{
+			if (PQserverVersion(s->conn) < 90200)
+			{
+				server_lost(s, "needs PostgreSQL 9.2 or later");
+				s->unsupported = 1;
+			}
+			else if (PQsetnonblocking(s->conn, 1) != 0)
+				server_lost(s, PQerrorMessage(s->conn));
+			else
+				server_send(s, SERVER_PROBING);
+		}
+		return;
+	}
+
+	if (s->flushing && (s->flushing = PQflush(s->conn)) == -1)
+	{
+		server_lost(s, PQerrorMessage(s->conn));
+		return;
+	}
+	if (PQconsumeInput(s->conn) == 0)
+	{
+		server_lost(s, PQerrorMessage(s->conn));
+		return;
+	}
+
+	while (!PQisBusy(s->conn))
+	{
+		if ((pgresult = PQgetResult(s->conn)) == NULL)
+		{
+			/* the query is done */
+			if (s->state == SERVER_PROBING)
+				server_send(s, SERVER_SAMPLING);
+			else
+				s->state = SERVER_IDLE;
+			return;
+		}
+
+		/* a sample is the server's row followed by its standbys */
+		if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+		{
+			server_error(s, PQresultErrorMessage(pgresult));
+			PQclear(pgresult);
+		}
+		else if (s->state == SERVER_PROBING)
+		{
+			s->cputime = atoi(PQgetvalue(pgresult, 0, 0)) > 0;
+			PQclear(pgresult);
+		}
+		else if (s->result++ == 0)
+		{
+			update_server(s, pgresult);
+			PQclear(pgresult);
+		}
+		else
+		{
+			PQclear(s->downstream);
+			s->downstream = pgresult;
+		}
+	}
+}
+
+/*
+ * Sample all the servers at once, waiting for them no longer than the delay
+ * between updates or FLEET_TIMEOUT, whichever is shorter.  FLEET_TIMEOUT is
+ * waited for only when there is no delay.
+ */
+void
+fleet_sample(struct timeval *delay)
+{
+	struct timeval wait = {FLEET_TIMEOUT, 0};
+	struct timeval deadline,
+				wake,
+				now,
+				timeout;
+	fd_set		readfds,
+				writefds;
+	struct fleet_server *s;
+	int			sock,
+				maxfd;
+	int			i;
+
+	if (timerisset(delay) && timercmp(delay, &wait, <))
+		wait = *delay;
+	gettimeofday(&now, NULL);
+	timeradd(&now, &wait, &deadline);
+
+	for (i = 0; i < nservers; i++)
+	{
+		servers[i].answered = 0;
+		server_start(&servers[i]);
+	}
+
+	for (;;)
+	{
+		FD_ZERO(&readfds);
+		FD_ZERO(&writefds);
+		maxfd = -1;
+		gettimeofday(&now, NULL);
+		wake = deadline;
+		for (i = 0; i < nservers; i++)
+		{
+			s = &servers[i];
+			if (s->state == SERVER_IDLE)
+				continue;
+
+			/* a host that never answers is tried again on a later update */
+			if (s->state == SERVER_CONNECTING &&
+				!timercmp(&now, &s->give_up, <))
+			{
+				server_lost(s, "timeout expired while connecting");
+				continue;
+			}
+			if (s->state == SERVER_CONNECTING &&
+				timercmp(&s->give_up, &wake, <))
+				wake = s->give_up;
+
+			if ((sock = PQsocket(s->conn)) < 0 || sock >= FD_SETSIZE)
+			{
+				server_lost(s, sock < 0 ? PQerrorMessage(s->conn) :
+							"too many servers");
+				continue;
+			}
+
+			if (s->state == SERVER_CONNECTING ?
+				s->polling == PGRES_POLLING_READING : 1)
+				FD_SET(sock, &readfds);
+			if (s->state == SERVER_CONNECTING ?
+				s->polling == PGRES_POLLING_WRITING : s->flushing)
+				FD_SET(sock, &writefds);
+			if (sock > maxfd)
+				maxfd = sock;
+		}
+		if (maxfd == -1)
+			break;
+
+		if (!timercmp(&now, &deadline, <))
+			break;
+		timersub(&wake, &now, &timeout);
+
+		if (select(maxfd + 1, &readfds, &writefds, NULL, &timeout) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (i = 0; i < nservers; i++)
+		{
+			s = &servers[i];
+			if (s->state == SERVER_IDLE || (sock = PQsocket(s->conn)) < 0)
+				continue;
+			if (FD_ISSET(sock, &readfds) || FD_ISSET(sock, &writefds))
+				server_step(s);
+		}
+	}
+}
+
+caddr_t
+get_fleet_info(struct system_info *si, int compare_index,
+			   struct timeval *delay)
+{
+	int			i;
+
+	fleet_sample(delay);
+
+	for (i = 0; i < nservers; i++)
+		servertable[i] = &servers[i];
+	if (compare_index > 0)
+		qsort(servertable, nservers, sizeof(struct fleet_server *),
+			  fleet_compares[compare_index]);
+
+	si->P_ACTIVE = nservers;
+	server_index = 0;
+	return (caddr_t) 0;
+}
+
+/* What the server is doing, or the last error. */
+char *
+fleet_status(struct fleet_server *s)
+{
+	if (s->state == SERVER_CONNECTING)
+		return "connecting";
+	else if (s->state != SERVER_IDLE && !s->answered)
+		return "no answer";
+	else if (s->error != NULL)
+		return s->error;
+	else
+		return "";
+}
+
+char *
+format_next_fleet(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		sessions[16];
+	char		active[16];
+	char		tps[16];
+	char		cpu[8];
+	char		lag[16];
+	struct fleet_server *s = servertable[server_index++];
+
+	sessions[0] = active[0] = tps[0] = cpu[0] = lag[0] = '\0';
+	if (s->stats.samples > 0)
+	{
+		snprintf(sessions, sizeof(sessions), "%lld", s->sessions);
+		snprintf(active, sizeof(active), "%lld", s->active);
+		if (s->tps >= 0)
+			snprintf(tps, sizeof(tps), "%s", format_n(s->tps));
+		if (s->cpu >= 0)
+			snprintf(cpu, sizeof(cpu), "%5.1f", s->cpu);
+		if (s->lag >= 0)
+			snprintf(lag, sizeof(lag), "%s", format_b(s->lag));
+	}
+
+	snprintf(fmt, sizeof(fmt),
+			 "%3d %-20.20s %-7s %6s %6s %8s %5s %-22.22s %8s %s",
+			 s->number,
+			 s->name,
+			 s->stats.samples == 0 ? "" : s->recovery ? "standby" : "primary",
+			 sessions,
+			 active,
+			 tps,
+			 cpu,
+			 s->stats.samples > 0 && s->wait != NULL ? s->wait : "",
+			 lag,
+			 fleet_status(s));
+
+	return (fmt);
+}
+
+/*
+ * Comparison routines for qsort, largest first.  What is not known sorts
+ * last.
+ */
+
+#define KNOWN(p, v) ((p)->stats.samples > 0 ? (v) : -1e300)
+#define ORDERKEY_ACTIVE if ((result = (KNOWN(p2, p2->active) > \
+                                       KNOWN(p1, p1->active)) - \
+                                      (KNOWN(p2, p2->active) < \
+                                       KNOWN(p1, p1->active))) == 0)
+#define ORDERKEY_TPS    if ((result = (KNOWN(p2, p2->tps) > KNOWN(p1, p1->tps)) - \
+                                      (KNOWN(p2, p2->tps) < KNOWN(p1, p1->tps))) == 0)
+#define ORDERKEY_CPU    if ((result = (KNOWN(p2, p2->cpu) > KNOWN(p1, p1->cpu)) - \
+                                      (KNOWN(p2, p2->cpu) < KNOWN(p1, p1->cpu))) == 0)
+#define ORDERKEY_LAG    if ((result = (KNOWN(p2, p2->lag) > KNOWN(p1, p1->lag)) - \
+                                      (KNOWN(p2, p2->lag) < KNOWN(p1, p1->lag))) == 0)
+#define ORDERKEY_SERVER if ((result = p1->number - p2->number) == 0)
+
+static int
+compare_active(const void *v1, const void *v2)
+{
+	struct fleet_server *p1 = *(struct fleet_server **) v1;
+	struct fleet_server *p2 = *(struct fleet_server **) v2;
+	int			result;
+
+	ORDERKEY_ACTIVE
+		ORDERKEY_TPS
+		ORDERKEY_SERVER
+		;
+
+	return (result);
+}
+
+static int
+compare_cpu(const void *v1, const void *v2)
+{
+	struct fleet_server *p1 = *(struct fleet_server **) v1;
+	struct fleet_server *p2 = *(struct fleet_server **) v2;
+	int			result;
+
+	ORDERKEY_CPU
+		ORDERKEY_ACTIVE
+		ORDERKEY_SERVER
+		;
+
+	return (result);
+}
+
+static int
+compare_lag(const void *v1, const void *v2)
+{
+	struct fleet_server *p1 = *(struct fleet_server **) v1;
+	struct fleet_server *p2 = *(struct fleet_server **) v2;
+	int			result;
+
+	ORDERKEY_LAG
+		ORDERKEY_SERVER
+		;
+
+	return (result);
+}
+
+static int
+compare_server(const void *v1, const void *v2)
+{
+	struct fleet_server *p1 = *(struct fleet_server **) v1;
+	struct fleet_server *p2 = *(struct fleet_server **) v2;
+	int			result;
+
+	ORDERKEY_SERVER
+		;
+
+	return (result);
+}
+
+static int
+compare_tps(const void *v1, const void *v2)
+{
+	struct fleet_server *p1 = *(struct fleet_server **) v1;
+	struct fleet_server *p2 = *(struct fleet_server **) v2;
+	int			result;
+
+	ORDERKEY_TPS
+		ORDERKEY_ACTIVE
+		ORDERKEY_SERVER
+		;
+
+	return (result);
+}
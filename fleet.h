@@ -0,0 +1,76 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _FLEET_H_
+#define _FLEET_H_
+
+#include <sys/time.h>
+
+#include "delta.h"
+#include "machine.h"
+#include "pg.h"
+
+/*
+ * Most seconds an update waits for the servers to answer.  The ones that are
+ * slower are shown with what they last answered.  It is also how long
+ * connecting is waited for, over as many updates as it takes, unless the
+ * server sets connect_timeout.
+ */
+#define FLEET_TIMEOUT 5
+
+enum ServerState
+{
+	SERVER_IDLE,				/* nothing sent */
+	SERVER_CONNECTING,
+	SERVER_PROBING,				/* finding out whether there is pg_cputime() */
+	SERVER_SAMPLING
+};
+
+struct fleet_server
+{
+	int			number;			/* place in the list, from 1 */
+	char	   *name;
+	char	   *conninfo;
+	char	   *host;			/* as listed, or NULL */
+
+	PGconn	   *conn;
+	int			state;
+	PostgresPollingStatusType polling;	/* what connecting waits for */
+	struct timeval give_up;		/* when connecting is given up on */
+	int			flushing;		/* whether a query is still being sent */
+	int			cputime;		/* whether pg_cputime() can be sampled */
+	int			unsupported;	/* not to be connected to again */
+	int			answered;		/* whether it answered in this update */
+	char	   *error;			/* the last error, or NULL */
+
+	/* the counters, with the number of samples since connecting */
+	struct delta_stats stats;
+
+	long long	sessions;
+	long long	active;
+	long long	lag;			/* bytes, or -1 if unknown */
+	int			recovery;
+	char	   *wait;
+	long long	position;		/* in WAL written, or replayed on a standby */
+	char	   *cluster_name;
+	char	   *address;		/* the server's end of the connection */
+	PGresult   *downstream;		/* the standbys replicating from it */
+	int			result;			/* which result of a sample is next */
+
+	double		tps;			/* -1 if unknown */
+	double		cpu;			/* percentage, or -1 if unknown */
+};
+
+int			fleet_init(char *, const char **);
+int			fleet_servers(void);
+int			fleet_find(char *);
+void		fleet_sample(struct timeval *);
+char	   *fleet_select(struct pg_conninfo_ctx *, int);
+struct fleet_server *fleet_server(int);
+char	   *fleet_status(struct fleet_server *);
+caddr_t		get_fleet_info(struct system_info *, int, struct timeval *);
+char	   *format_next_fleet(caddr_t);
+
+extern char fmt_header_fleet[];
+extern char *fleet_ordernames[];
+
+#endif							/* _FLEET_H_ */
@@ -10,22 +10,38 @@ These single-character commands are available:\n\
 \n\
 ^L      - redraw screen\n\
 <sp>    - update screen\n\
++ or -  - double or halve the speed of a recording replayed\n\
+< or >  - step one update back or forward in a recording replayed\n\
+[ or ]  - go back or forward a minute in a recording replayed\n\
 A       - EXPLAIN ANALYZE (UPDATE/DELETE safe)\n\
 a       - show PostgreSQL activity\n\
+B       - show sessions blocked by locks and who blocks them\n\
 C       - toggle the use of color\n\
 E       - show execution plan (UPDATE/DELETE safe)\n\
+F       - show the fleet of servers, or pick one from it for the other displays\n\
+G       - show the replication topology of the fleet\n\
+H       - show active session history\n\
 I       - show I/O statistics per process (Linux only)\n\
+K       - show the pools of pgbouncer\n\
 L       - show locks held by a process\n\
+O       - show replication slots\n\
+P       - show progress of long running commands\n\
 Q       - show current query of a process\n\
+S       - show top statements from pg_stat_statements\n\
+T       - show table activity\n\
 c       - toggle the display of process commands\n\
+D       - show activity for only one database (+ selects all databases)\n\
 d       - change number of displays to show\n\
+g       - go to a time of day in a recording replayed\n\
 h or ?  - help; show this text\n\
 i       - toggle the displaying of idle processes\n\
 n or #  - change number of processes to display\n\
 o       - specify sort order (%s)\n\
+p       - pause or go on replaying a recording\n\
 q       - quit\n\
 s       - change number of seconds to delay between updates\n\
 u       - display processes for only one user (+ selects all users)\n\
+w       - change number of seconds of session history to show\n\
 \n\
 Not all commands are available on all systems.\n\
 ";
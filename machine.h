@@ -34,6 +34,15 @@ enum DisplayMode
 	MODE_PROCESSES,
 	MODE_IO_STATS,
 	MODE_REPLICATION,
+	MODE_ASH,
+	MODE_RELATIONS,
+	MODE_STATEMENTS,
+	MODE_BLOCKING,
+	MODE_PROGRESS,
+	MODE_SLOTS,
+	MODE_FLEET,
+	MODE_TOPOLOGY,
+	MODE_PGBOUNCER,
 	MODE_TYPES					/* number of modes */
 };
 
@@ -67,6 +76,7 @@ struct statics
 		unsigned int fullcmds:1;
 		unsigned int idle:1;
 		unsigned int warmup:1;
+		unsigned int diskstats:1;	/* disk_info is filled in */
 	}			flags;
 };
 
@@ -80,6 +90,20 @@ struct statics
 #define P_ACTIVE p_active
 #endif
 
+/*
+ * Activity of the whole disks of the system since the last update, or -1
+ * where it is not known.
+ */
+struct disk_info
+{
+	double		reads;			/* per second */
+	double		writes;			/* per second */
+	double		read_bytes;		/* per second */
+	double		write_bytes;	/* per second */
+	double		busy;			/* percentage of time the busiest disk was */
+	char	   *busiest;		/* name of the busiest disk, or NULL */
+};
+
 struct system_info
 {
 	int			last_pid;
@@ -90,6 +114,7 @@ struct system_info
 	int64_t    *cpustates;
 	long	   *memory;
 	long	   *swap;
+	struct disk_info *disk;		/* optional */
 };
 
 /* cpu_states is an array of percentages * 10.	For example,
@@ -109,6 +134,50 @@ struct process_select
 	char		usename[NAMEDATALEN + 1];	/* only this postgres usename */
 };
 
+/*
+ * The counters of a process, each the change over the interval between its
+ * last two samples.  Not every module has all of them.
+ */
+enum ProcessCounter
+{
+	PC_RCHAR,
+	PC_WCHAR,
+	PC_SYSCR,
+	PC_SYSCW,
+	PC_IOPS,
+	PC_READ_BYTES,
+	PC_WRITE_BYTES,
+	PC_CANCELLED_WRITE_BYTES,
+	PC_BLKIO,
+	PC_MAJFLT,
+	PC_MINFLT,
+	PC_NVCSW,
+	PC_NIVCSW,
+	PROCESS_COUNTERS			/* number of counters */
+};
+
+/*
+ * A process of the last sample, as it is recorded and given back to be shown
+ * again when replayed.
+ */
+struct process_row
+{
+	int			pid;
+	char	   *usename;
+	char	   *name;
+	char	   *backend_type;	/* NULL if not known */
+	int			pgstate;
+	unsigned long size;
+	unsigned long rss;			/* in k */
+	unsigned long xtime;
+	unsigned long qtime;
+	unsigned int locks;
+	double		pcpu;
+	double		prunq;
+	double		interval;		/* seconds the counters are over, 0 if none */
+	long long	counter[PROCESS_COUNTERS];
+};
+
 /* routines defined by the machine dependent module */
 int			machine_init(struct statics *);
 void		get_system_info(struct system_info *);
@@ -119,8 +188,15 @@ char	   *format_header(char *);
 char	   *format_next_io(caddr_t);
 #endif /* defined(__linux__) || defined (__FreeBSD__) */
 char	   *format_next_process(caddr_t);
-char	   *format_next_replication(caddr_t);
+#if defined(__linux__)
+void		output_next_process(caddr_t);
+void		machine_replay_init(struct statics *);
+int			get_process_rows(struct process_row **);
+caddr_t		put_process_rows(struct system_info *, struct process_select *,
+							 struct process_row *, int, int);
+#endif /* defined(__linux__) */
 uid_t		proc_owner(pid_t);
+char	   *backend_type_name(char *);
 void		update_state(int *pgstate, char *state);
 void		update_str(char **, char *);
 
@@ -129,6 +205,5 @@ extern int	mode_stats;
 extern char *backendstatenames[];
 extern char *procstatenames[];
 extern char fmt_header_io[];
-extern char fmt_header_replication[];
 
 #endif							/* _MACHINE_H_ */
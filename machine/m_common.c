@@ -24,8 +24,28 @@ char	   *procstatenames[] =
 	" fastpath, ", " aborted, ", " disabled, ", NULL
 };
 
-char		fmt_header_replication[] =
-"    PID USERNAME APPLICATION          CLIENT STATE     PRIMARY    SENT       WRITE      FLUSH      REPLAY      SLAG  WLAG  FLAG  RLAG";
+/*
+ * Short names for the backend types reported by pg_stat_activity, and for the
+ * postmaster and its children that may not be listed there.  Anything not
+ * listed here is displayed as is, truncated to fit the column.
+ */
+static char *backendtypenames[][2] =
+{
+	{"client backend", "client"},
+	{"autovacuum launcher", "avlaunch"},
+	{"autovacuum worker", "autovac"},
+	{"logical replication launcher", "lrlaunch"},
+	{"logical replication worker", "lrworker"},
+	{"parallel worker", "parallel"},
+	{"background writer", "bgwriter"},
+	{"checkpointer", "ckpointr"},
+	{"walwriter", "walwrite"},
+	{"walreceiver", "walrecv"},
+	{"walsummarizer", "walsumm"},
+	{"stats collector", "stats"},
+	{"slotsync worker", "slotsync"},
+	{NULL, NULL}
+};
 
 void
 update_state(int *pgstate, char *state)
@@ -59,3 +79,17 @@ update_str(char **old, char *new)
 		*old = strdup(new);
 	}
 }
+
+char *
+backend_type_name(char *backend_type)
+{
+	int			i;
+
+	if (backend_type == NULL)
+		return "";
+
+	for (i = 0; backendtypenames[i][0] != NULL; i++)
+		if (strcmp(backend_type, backendtypenames[i][0]) == 0)
+			return backendtypenames[i][1];
+	return backend_type;
+}
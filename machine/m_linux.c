@@ -62,7 +62,9 @@
 		value[len] = '\0'; \
 		v = atoll(value);
 
+#include "delta.h"
 #include "machine.h"
+#include "output.h"
 #include "utils.h"
 
 #define PROCFS "/proc"
@@ -74,10 +76,14 @@ struct top_proc
 {
 	RB_ENTRY(top_proc) entry;
 	pid_t		pid;
+	pid_t		ospid;			/* pid in /proc, if in another namespace */
 
 	/* index for which element is current in data arrays */
 	int index;
 
+	/* the last sample this process was seen in */
+	unsigned int sample;
+
 	/* Data from /proc/<pid>/stat. */
 	char	   *name;
 	char	   *usename;
@@ -90,28 +96,32 @@ struct top_proc
 	unsigned long xtime;
 	unsigned long qtime;
 	unsigned int locks;
+	char	   *backend_type;
 	double		pcpu;
+	double		prunq;
+
+	/* Data from /proc/<pid>/schedstat, in nanoseconds. */
+	long long	run_delay[2];
+
+	/* Page faults from /proc/<pid>/stat. */
+	long long	minflt[2];
+	long long	majflt[2];
+
+	/* Time blocked waiting on block i/o from /proc/<pid>/stat, in ticks. */
+	long long	blkio[2];
+
+	/* Context switches from /proc/<pid>/status. */
+	long long	nvcsw[2];
+	long long	nivcsw[2];
 
 	/* Data from /proc/<pid>/io. */
+	long long	rchar[2];	/* bytes read, including page cache hits */
+	long long	wchar[2];	/* bytes written, including to page cache */
 	long long	iops[2]; /* syscr + syscw */
 	long long	syscr[2];
 	long long	syscw[2];
 	long long	read_bytes[2];
 	long long	write_bytes[2];
-
-	/* Replication data */
-	char	   *application_name;
-	char	   *client_addr;
-	char	   *repstate;
-	char	   *primary;
-	char	   *sent;
-	char	   *write;
-	char	   *flush;
-	char	   *replay;
-	long long	sent_lag;
-	long long	write_lag;
-	long long	flush_lag;
-	long long	replay_lag;
 };
 
 int			topproccmp(struct top_proc *, struct top_proc *);
@@ -125,12 +135,17 @@ double		timediff;
 /*=STATE IDENT STRINGS==================================================*/
 
 #define NCPUSTATES 5
-static char *cpustatenames[NCPUSTATES + 1] =
+#define CPUSTATE_RUNQ NCPUSTATES	/* not a cpu state, see get_system_info */
+static char *cpustatenames[NCPUSTATES + 2] =
 {
-	"user", "nice", "system", "idle", "iowait",
+	"user", "nice", "system", "idle", "iowait", "runq",
 	NULL
 };
 static int	show_iowait = 0;
+static int	show_runq = 0;
+
+/* where runq is in cpustatenames, moved up when there is no iowait */
+static int	runq_state = CPUSTATE_RUNQ;
 
 #define MEMUSED    0
 #define MEMFREE    1
@@ -165,40 +180,54 @@ struct swap_t
 	long long out[2];
 } swap_activity;
 
+struct runq_t
+{
+	int index;
+	long long delay[2];			/* in nanoseconds */
+} runq_activity;
+
 static char fmt_header[] =
-"    PID X           SIZE   RES STATE   XTIME  QTIME  %CPU LOCKS COMMAND";
+"    PID X           SIZE   RES STATE  TYPE      XTIME  QTIME  %CPU %RUNQ LOCKS COMMAND";
 
 char		fmt_header_io[] =
-"    PID    IOPS   IORPS   IOWPS READS WRITES COMMAND";
+"    PID  IOPS IORPS IOWPS LREAD LWRITE READS WRITES  HIT% BLKIO MAJFLT MINFLT  VCSW NVCSW COMMAND";
 
 /* these are names given to allowed sorting orders -- first is default */
 static char *ordernames[] =
 {
-	"cpu", "size", "res", "xtime", "qtime", "iops", "iorps", "iowps", "reads",
-	"writes", "locks", "command", "flag", "rlag", "slag", "wlag", NULL
+	"cpu", "runq", "size", "res", "xtime", "qtime", "iops", "iorps", "iowps",
+	"reads", "writes", "locks", "command", "majflt", "minflt", "vcsw",
+	"nvcsw", "lread", "lwrite", "hit", "blkio", "type", NULL
 };
 
 /* forward definitions for comparison functions */
+static int	compare_blkio(const void *, const void *);
 static int	compare_cmd(const void *, const void *);
 static int	compare_cpu(const void *, const void *);
+static int	compare_hit(const void *, const void *);
 static int	compare_iops(const void *, const void *);
-static int	compare_lag_flush(const void *, const void *);
-static int	compare_lag_replay(const void *, const void *);
-static int	compare_lag_sent(const void *, const void *);
-static int	compare_lag_write(const void *, const void *);
 static int	compare_locks(const void *, const void *);
+static int	compare_lread(const void *, const void *);
+static int	compare_lwrite(const void *, const void *);
+static int	compare_majflt(const void *, const void *);
+static int	compare_minflt(const void *, const void *);
+static int	compare_nivcsw(const void *, const void *);
+static int	compare_nvcsw(const void *, const void *);
 static int	compare_qtime(const void *, const void *);
 static int	compare_reads(const void *, const void *);
 static int	compare_res(const void *, const void *);
+static int	compare_runq(const void *, const void *);
 static int	compare_size(const void *, const void *);
 static int	compare_syscr(const void *, const void *);
 static int	compare_syscw(const void *, const void *);
+static int	compare_type(const void *, const void *);
 static int	compare_writes(const void *, const void *);
 static int	compare_xtime(const void *, const void *);
 
 int			(*proc_compares[]) () =
 {
 	compare_cpu,
+		compare_runq,
 		compare_size,
 		compare_res,
 		compare_xtime,
@@ -210,10 +239,15 @@ int			(*proc_compares[]) () =
 		compare_writes,
 		compare_locks,
 		compare_cmd,
-		compare_lag_flush,
-		compare_lag_replay,
-		compare_lag_sent,
-		compare_lag_write,
+		compare_majflt,
+		compare_minflt,
+		compare_nvcsw,
+		compare_nivcsw,
+		compare_lread,
+		compare_lwrite,
+		compare_hit,
+		compare_blkio,
+		compare_type,
 		NULL
 };
 
@@ -235,11 +269,68 @@ static struct timeval lasttime;
 #define PROCBLOCK_SIZE		 (32)
 static struct top_proc *pgtable;
 static int	proc_index;
+static int	proc_active;
+
+/* the processes of the last sample, as rows for recording them */
+static struct process_row *rowtable;
+static int	rowtable_size;
 static time_t boottime = -1;
+static unsigned int sample;
+
+/*
+ * these are for finding the postmaster's children that pg_stat_activity does
+ * not list
+ */
+
+struct pidmap
+{
+	pid_t		ospid;			/* pid as seen in /proc */
+	pid_t		nspid;			/* pid as seen by the database */
+};
+
+static pid_t postmaster = -1;
+static pid_t lookup_backend = -1;
+static time_t lookup_time;
+static int	nspidded;
+static struct pidmap *children;
+static struct pidmap *nextchildren;
+static struct pidmap *nsmap;
+static int	children_count;
+static int	children_size;
+
+/* how often to look through every process for a postmaster not found */
+#define POSTMASTER_SCAN_INTERVAL 30
+
+/*
+ * Process titles of the postmaster's children, in the order they are
+ * matched, mapped to the backend_type pg_stat_activity would report.
+ */
+static char *auxtitles[][2] =
+{
+	{"autovacuum launcher", "autovacuum launcher"},
+	{"autovacuum worker", "autovacuum worker"},
+	{"logical replication launcher", "logical replication launcher"},
+	{"logical replication worker", "logical replication worker"},
+	{"parallel worker", "parallel worker"},
+	{"background writer", "background writer"},
+	{"checkpointer", "checkpointer"},
+	{"walwriter", "walwriter"},
+	{"wal writer", "walwriter"},
+	{"walreceiver", "walreceiver"},
+	{"wal receiver", "walreceiver"},
+	{"walsender", "walsender"},
+	{"wal sender", "walsender"},
+	{"walsummarizer", "walsummarizer"},
+	{"startup", "startup"},
+	{"archiver", "archiver"},
+	{"stats collector", "stats collector"},
+	{"logger", "logger"},
+	{NULL, NULL}
+};
 
 /* these are for passing data back to the machine independant portion */
 
-static int64_t cpu_states[NCPUSTATES];
+static int64_t cpu_states[NCPUSTATES + 1];
 static int	process_states[NPROCSTATES];
 static long memory_stats[NMEMSTATS];
 static long swap_stats[NSWAPSTATS];
@@ -250,12 +341,6 @@ static long swap_stats[NSWAPSTATS];
 
 /*======================================================================*/
 
-static inline long long
-diff_stat(long long value[2], int index)
-{
-	return value[index] - value[(index + 1) % 2];
-}
-
 static inline char *
 skip_ws(const char *p)
 {
@@ -359,12 +444,27 @@ machine_init(struct statics *statics)
 			/* we have iowait */
 			show_iowait = 1;
 		}
+
+		/* run queue delays need a kernel built with CONFIG_SCHEDSTATS */
+		if ((fd = open("schedstat", O_RDONLY)) != -1)
+		{
+			show_runq = 1;
+			close(fd);
+		}
 	}
 
 	/* if we aren't showing iowait, then we have to tweak cpustatenames */
 	if (!show_iowait)
 	{
-		cpustatenames[4] = NULL;
+		runq_state = 4;
+		cpustatenames[4] = cpustatenames[CPUSTATE_RUNQ];
+		cpustatenames[CPUSTATE_RUNQ] = NULL;
+	}
+
+	/* and the same again for the run queue, whether or not there is iowait */
+	if (!show_runq)
+	{
+		cpustatenames[runq_state] = NULL;
 	}
 
 	/* fill in the statics information */
@@ -388,6 +488,7 @@ get_system_info(struct system_info *info)
 	int			fd,
 				len;
 	char	   *p;
+	long		total_ticks = 1;
 
 	/* get load averages */
 
@@ -430,11 +531,56 @@ get_system_info(struct system_info *info)
 			}
 
 			/* convert cp_time counts to percentages */
-			percentages(NCPUSTATES, cpu_states, cp_time, cp_old, cp_diff);
+			total_ticks = percentages(NCPUSTATES, cpu_states, cp_time, cp_old,
+									  cp_diff);
 		}
 		close(fd);
 	}
 
+	/*
+	 * Get the time tasks spent waiting on a run queue, summed over all cpus.
+	 * It is shown as a percentage of the total cpu time available, so 100%
+	 * means that on average one task was waiting for every cpu.
+	 */
+	if (show_runq && (fd = open("schedstat", O_RDONLY)) != -1)
+	{
+		long long	delay = 0;
+
+		if ((len = read(fd, buffer, sizeof(buffer) - 1)) > 0)
+		{
+			buffer[len] = '\0';
+			p = buffer - 1;
+
+			/* iterate thru the lines, only the cpu<N> lines are wanted */
+			while (p != NULL)
+			{
+				p++;
+				if (strncmp(p, "cpu", 3) == 0)
+				{
+					p = skip_token(p);	/* cpu<N> */
+					p = skip_token(p);	/* skip yld_count */
+					p = skip_token(p);	/* skip legacy, always 0 */
+					p = skip_token(p);	/* skip sched_count */
+					p = skip_token(p);	/* skip sched_goidle */
+					p = skip_token(p);	/* skip ttwu_count */
+					p = skip_token(p);	/* skip ttwu_local */
+					p = skip_token(p);	/* skip rq_cpu_time */
+					delay += strtoull(p, &p, 10);	/* run_delay */
+				}
+
+				/* move to the next line */
+				p = strchr(p, '\n');
+			}
+		}
+		close(fd);
+
+		runq_activity.delay[runq_activity.index] = delay;
+		cpu_states[runq_state] = (int64_t)
+			(diff_stat(runq_activity.delay, runq_activity.index) *
+			 HZ / 1e9 * 1000 / total_ticks);
+		runq_activity.index = (runq_activity.index + 1) % 2;
+	}
+
 	/* get system wide memory usage */
 	if ((fd = open("meminfo", O_RDONLY)) != -1)
 	{
@@ -615,7 +761,7 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	fullcmd = sel->fullcmd;
 	if (fullcmd == 1)
 	{
-		sprintf(buffer, "%d/cmdline", proc->pid);
+		sprintf(buffer, "%d/cmdline", proc->ospid);
 		if ((fd = open(buffer, O_RDONLY)) != -1)
 		{
 			/* read command line data */
@@ -640,7 +786,7 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	}
 
 	/* grab the proc stat info in one go */
-	sprintf(buffer, "%d/stat", proc->pid);
+	sprintf(buffer, "%d/stat", proc->ospid);
 
 	fd = open(buffer, O_RDONLY);
 	len = read(fd, buffer, sizeof(buffer) - 1);
@@ -701,9 +847,9 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	p = skip_token(p);			/* skip tty nr */
 	p = skip_token(p);			/* skip tty pgrp */
 	p = skip_token(p);			/* skip flags */
-	p = skip_token(p);			/* skip min flt */
+	proc->minflt[proc->index] = strtoll(p, &p, 10);	/* min flt */
 	p = skip_token(p);			/* skip cmin flt */
-	p = skip_token(p);			/* skip maj flt */
+	proc->majflt[proc->index] = strtoll(p, &p, 10);	/* maj flt */
 	p = skip_token(p);			/* skip cmaj flt */
 
 	proc->time = strtoul(p, &p, 10);	/* utime */
@@ -719,8 +865,6 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	proc->size = bytetok(strtoul(p, &p, 10));	/* vsize */
 	proc->rss = pagetok(strtoul(p, &p, 10));	/* rss */
 
-#if 0
-	/* for the record, here are the rest of the fields */
 	p = skip_token(p);			/* skip rlim */
 	p = skip_token(p);			/* skip start_code */
 	p = skip_token(p);			/* skip end_code */
@@ -733,15 +877,50 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	p = skip_token(p);			/* skip sigcatch */
 	p = skip_token(p);			/* skip wchan */
 	p = skip_token(p);			/* skip nswap, not maintained */
-	p = skip_token(p);			/* exit signal */
-	p = skip_token(p);			/* processor */
-	p = skip_token(p);			/* rt_priority */
-	p = skip_token(p);			/* policy */
-	p = skip_token(p);			/* delayacct_blkio_ticks */
-#endif
+	p = skip_token(p);			/* skip cnswap, not maintained */
+	p = skip_token(p);			/* skip exit signal */
+	p = skip_token(p);			/* skip processor */
+	p = skip_token(p);			/* skip rt_priority */
+	p = skip_token(p);			/* skip policy */
+	/* only counts when delay accounting is enabled in the kernel */
+	proc->blkio[proc->index] = strtoll(p, &p, 10);	/* delayacct_blkio_ticks */
+
+	/* Get the time spent waiting on a run queue, in nanoseconds. */
+	sprintf(buffer, "%d/schedstat", proc->ospid);
+	if ((fd = open(buffer, O_RDONLY)) != -1)
+	{
+		if ((len = read(fd, buffer, sizeof(buffer) - 1)) > 0)
+		{
+			buffer[len] = '\0';
+			p = skip_token(buffer);	/* skip sum_exec_runtime */
+			proc->run_delay[proc->index] = strtoll(p, &p, 10);
+		}
+		close(fd);
+	}
+
+	/* Get the context switches. */
+	sprintf(buffer, "%d/status", proc->ospid);
+	if ((fd = open(buffer, O_RDONLY)) != -1)
+	{
+		if ((len = read(fd, buffer, sizeof(buffer) - 1)) > 0)
+		{
+			buffer[len] = '\0';
+			if ((p = strstr(buffer, "\nvoluntary_ctxt_switches:")) != NULL)
+			{
+				GET_VALUE(tmp);
+				proc->nvcsw[proc->index] = tmp;
+			}
+			if ((p = strstr(buffer, "\nnonvoluntary_ctxt_switches:")) != NULL)
+			{
+				GET_VALUE(tmp);
+				proc->nivcsw[proc->index] = tmp;
+			}
+		}
+		close(fd);
+	}
 
 	/* Get the io stats. */
-	sprintf(buffer, "%d/io", proc->pid);
+	sprintf(buffer, "%d/io", proc->ospid);
 	fd = open(buffer, O_RDONLY);
 	if (fd == -1)
 	{
@@ -758,8 +937,11 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	buffer[len] = '\0';
 	p = buffer;
 
-	p = skip_token(p);			/* rchar */
-	p = skip_token(p);			/* wchar */
+	GET_VALUE(tmp);				/* rchar */
+	proc->rchar[proc->index] = tmp;
+
+	GET_VALUE(tmp);				/* wchar */
+	proc->wchar[proc->index] = tmp;
 
 	GET_VALUE(tmp);				/* syscr */
 	proc->syscr[proc->index] = tmp;
@@ -779,6 +961,357 @@ read_one_proc_stat(struct top_proc *proc, struct process_select *sel)
 	proc->write_bytes[proc->index] -= tmp;
 }
 
+/*
+ * Return the parent of a process, or -1 if the process does not exist.  If
+ * comm is not NULL, also return the command name of the process in it.
+ */
+
+static pid_t
+read_ppid(pid_t pid, char *comm, int len)
+{
+	char		buffer[4096];
+	char	   *p,
+			   *q;
+	int			fd,
+				n;
+
+	sprintf(buffer, "%d/stat", pid);
+	if ((fd = open(buffer, O_RDONLY)) == -1)
+		return -1;
+	n = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buffer[n] = '\0';
+
+	if ((p = strchr(buffer, '(')) == NULL ||
+		(q = strrchr(++p, ')')) == NULL)
+		return -1;
+	if (comm != NULL)
+	{
+		*q = '\0';
+		snprintf(comm, len, "%s", p);
+	}
+
+	p = skip_token(q + 1);		/* skip state */
+	return (pid_t) strtol(p, NULL, 10);
+}
+
+static int
+is_postgres(char *comm)
+{
+	return strcmp(comm, "postgres") == 0 || strcmp(comm, "postmaster") == 0;
+}
+
+/*
+ * Return the pid of a process in the innermost pid namespace it belongs to,
+ * from the NSpid line of its status, and how many namespaces deep that is in
+ * levels.  Kernels too old to have NSpid only get the pid back.
+ */
+
+static pid_t
+read_nspid(pid_t pid, int *levels)
+{
+	char		buffer[4096];
+	char	   *p;
+	int			fd,
+				len;
+	pid_t		nspid = pid;
+
+	*levels = 1;
+
+	sprintf(buffer, "%d/status", pid);
+	if ((fd = open(buffer, O_RDONLY)) == -1)
+		return -1;
+	len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buffer[len] = '\0';
+
+	if ((p = strstr(buffer, "\nNSpid:")) == NULL)
+		return pid;
+	p += 7;
+	for (*levels = 0; isdigit(*(p = skip_ws(p))); (*levels)++)
+		nspid = (pid_t) strtol(p, &p, 10);
+
+	return nspid;
+}
+
+/*
+ * Find the postmaster by looking up the parent of the backend serving our
+ * connection.  When the database runs in a container the backend's pid means
+ * something else here, so look for the process whose pid in its own namespace
+ * is the backend's.  Returns -1 if the database is not running on this
+ * system.
+ */
+
+static pid_t
+find_postmaster(PGconn *pgconn)
+{
+	char		comm[64];
+	pid_t		backend,
+				pid,
+				ppid;
+	int			levels;
+	time_t		now;
+	DIR		   *dir;
+	struct dirent *ent;
+
+	/* don't bother looking again while the one found is still there */
+	if (postmaster != -1 && read_ppid(postmaster, comm, sizeof(comm)) != -1 &&
+		is_postgres(comm))
+		return postmaster;
+
+	if (postmaster != -1)
+	{
+		postmaster = -1;
+		children_count = 0;
+	}
+
+	backend = PQbackendPID(pgconn);
+	ppid = read_ppid(backend, comm, sizeof(comm));
+	if (ppid != -1 && is_postgres(comm) && read_nspid(backend, &levels) != -1
+		&& levels == 1)
+	{
+		nspidded = 0;
+		return postmaster = ppid;
+	}
+
+	/*
+	 * Looking through every process is too costly to repeat on every refresh
+	 * when the database is on another system, so only do it again for a new
+	 * connection, and then not too often.
+	 */
+	now = time(NULL);
+	if (backend == lookup_backend ||
+		now - lookup_time < POSTMASTER_SCAN_INTERVAL)
+		return -1;
+	lookup_backend = backend;
+	lookup_time = now;
+
+	if ((dir = opendir(".")) == NULL)
+		return -1;
+	while ((ent = readdir(dir)) != NULL)
+	{
+		if (!isdigit(ent->d_name[0]))
+			continue;
+		pid = (pid_t) atoi(ent->d_name);
+		if (read_nspid(pid, &levels) != backend || levels < 2)
+			continue;
+		ppid = read_ppid(pid, comm, sizeof(comm));
+		if (ppid != -1 && is_postgres(comm))
+		{
+			nspidded = 1;
+			postmaster = ppid;
+			break;
+		}
+	}
+	closedir(dir);
+
+	return postmaster;
+}
+
+static int
+compare_ospid(const void *v1, const void *v2)
+{
+	const struct pidmap *m1 = v1;
+	const struct pidmap *m2 = v2;
+
+	return (m1->ospid > m2->ospid) - (m1->ospid < m2->ospid);
+}
+
+static int
+compare_nspid(const void *v1, const void *v2)
+{
+	const struct pidmap *m1 = v1;
+	const struct pidmap *m2 = v2;
+
+	return (m1->nspid > m2->nspid) - (m1->nspid < m2->nspid);
+}
+
+static int
+add_child(int count, pid_t pid)
+{
+	if (count == children_size)
+	{
+		children_size += PROCBLOCK_SIZE;
+		if ((children = reallocarray(children, children_size,
+									 sizeof(struct pidmap))) == NULL ||
+			(nextchildren = reallocarray(nextchildren, children_size,
+										 sizeof(struct pidmap))) == NULL ||
+			(nsmap = reallocarray(nsmap, children_size,
+								  sizeof(struct pidmap))) == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+	}
+	nextchildren[count].ospid = pid;
+	return count + 1;
+}
+
+/*
+ * Collect the postmaster and its children into the children array and return
+ * how many there are.  The children file needs CONFIG_PROC_CHILDREN, so fall
+ * back to checking the parent of every process if it is not there.
+ *
+ * When the database is in another pid namespace, the pids it reports are
+ * looked up in nsmap.  Only processes that were not there last time have
+ * their status read to find their pid in that namespace, and nsmap is only
+ * rebuilt when the set of processes changed.
+ */
+
+static int
+postmaster_children(pid_t pm)
+{
+	char		buffer[4096];
+	char	   *p;
+	int			count = 0;
+	int			churn;
+	int			fd,
+				len,
+				levels,
+				i;
+	DIR		   *dir;
+	struct dirent *ent;
+	struct pidmap *m;
+	pid_t		pid;
+
+	count = add_child(count, pm);
+
+	sprintf(buffer, "%d/task/%d/children", pm, pm);
+	if ((fd = open(buffer, O_RDONLY)) != -1)
+	{
+		len = read(fd, buffer, sizeof(buffer) - 1);
+		close(fd);
+
+		/* a postmaster with more children than fit will be scanned below */
+		if (len >= 0 && len < sizeof(buffer) - 1)
+		{
+			buffer[len] = '\0';
+			p = buffer;
+			while (*(p = skip_ws(p)) != '\0')
+				count = add_child(count, (pid_t) strtol(p, &p, 10));
+		}
+		else
+			fd = -1;
+	}
+
+	if (fd == -1 && (dir = opendir(".")) != NULL)
+	{
+		while ((ent = readdir(dir)) != NULL)
+		{
+			if (!isdigit(ent->d_name[0]))
+				continue;
+			pid = (pid_t) atoi(ent->d_name);
+			if (read_ppid(pid, NULL, 0) == pm)
+				count = add_child(count, pid);
+		}
+		closedir(dir);
+	}
+
+	qsort(nextchildren, count, sizeof(struct pidmap), compare_ospid);
+	churn = count != children_count;
+	for (i = 0; i < count; i++)
+	{
+		m = bsearch(&nextchildren[i], children, children_count,
+					sizeof(struct pidmap), compare_ospid);
+		if (m != NULL)
+		{
+			nextchildren[i].nspid = m->nspid;
+			continue;
+		}
+		churn = 1;
+		if (nspidded)
+			nextchildren[i].nspid = read_nspid(nextchildren[i].ospid, &levels);
+		else
+			nextchildren[i].nspid = nextchildren[i].ospid;
+	}
+
+	m = children;
+	children = nextchildren;
+	nextchildren = m;
+	children_count = count;
+
+	if (churn)
+	{
+		memcpy(nsmap, children, count * sizeof(struct pidmap));
+		qsort(nsmap, count, sizeof(struct pidmap), compare_nspid);
+	}
+
+	return count;
+}
+
+/*
+ * Translate a pid reported by the database to one in /proc, or -1 if the
+ * process is not one of the postmaster's.
+ */
+
+static pid_t
+proc_pid(pid_t pid)
+{
+	struct pidmap key,
+			   *m;
+
+	if (!nspidded)
+		return pid;
+
+	key.nspid = pid;
+	m = bsearch(&key, nsmap, children_count, sizeof(struct pidmap),
+				compare_nspid);
+	return m == NULL ? -1 : m->ospid;
+}
+
+/*
+ * Determine the role of one of the postmaster's children from its process
+ * title.
+ */
+
+static char *
+aux_backend_type(pid_t pid)
+{
+	char		buffer[MAX_COLS + 1];
+	int			fd,
+				len,
+				i;
+
+	if (pid == postmaster)
+		return "postmaster";
+
+	sprintf(buffer, "%d/cmdline", pid);
+	if ((fd = open(buffer, O_RDONLY)) == -1)
+		return "";
+	len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (len <= 0)
+		return "";
+	buffer[len] = '\0';
+	xfrm_cmdline(buffer, len);
+
+	for (i = 0; auxtitles[i][0] != NULL; i++)
+		if (strstr(buffer, auxtitles[i][0]) != NULL)
+			return auxtitles[i][1];
+	return "";
+}
+
+static void
+calculate_rates(struct top_proc *n, unsigned long otime, double tickdiff)
+{
+	if (tickdiff > 0.0)
+	{
+		if ((n->pcpu = (n->time - otime) / tickdiff) < 0.0001)
+		{
+			n->pcpu = 0;
+		}
+		if ((n->prunq = diff_stat(n->run_delay, n->index) /
+			 (timediff * 1e9)) < 0.0001)
+		{
+			n->prunq = 0;
+		}
+	}
+}
+
 caddr_t
 get_process_info(struct system_info *si,
 				 struct process_select *sel,
@@ -811,24 +1344,21 @@ get_process_info(struct system_info *si,
 
 		int			i;
 		int			rows;
+		int			nchildren = 0;
 		PGresult   *pgresult = NULL;
 
 		struct top_proc *n,
 				   *p;
 
 		memset(process_states, 0, sizeof(process_states));
+		++sample;
 
 		connect_to_db(conninfo);
 		if (conninfo->connection != NULL)
 		{
-			if (mode == MODE_REPLICATION)
-			{
-				pgresult = pg_replication(conninfo->connection);
-			}
-			else
-			{
-				pgresult = pg_processes(conninfo->connection);
-			}
+			pgresult = pg_processes(conninfo->connection);
+			if (find_postmaster(conninfo->connection) != -1)
+				nchildren = postmaster_children(postmaster);
 			rows = PQntuples(pgresult);
 		}
 		else
@@ -836,9 +1366,10 @@ get_process_info(struct system_info *si,
 			rows = 0;
 		}
 
-		if (rows > 0)
+		if (rows + nchildren > 0)
 		{
-			p = reallocarray(pgtable, rows, sizeof(struct top_proc));
+			p = reallocarray(pgtable, rows + nchildren,
+							 sizeof(struct top_proc));
 			if (p == NULL)
 			{
 				fprintf(stderr, "reallocarray error\n");
@@ -877,58 +1408,90 @@ get_process_info(struct system_info *si,
 			}
 
 			otime = n->time;
+			n->sample = sample;
 
-			if (mode == MODE_REPLICATION)
+			if ((n->ospid = proc_pid(n->pid)) != -1)
+				read_one_proc_stat(n, sel);
+			else if (n->name == NULL)
+				update_str(&n->name, "");
+			if (sel->fullcmd == 2)
 			{
-				update_str(&n->usename, PQgetvalue(pgresult, i, REP_USENAME));
-				update_str(&n->application_name,
-						PQgetvalue(pgresult, i, REP_APPLICATION_NAME));
-				update_str(&n->client_addr,
-						PQgetvalue(pgresult, i, REP_CLIENT_ADDR));
-				update_str(&n->repstate, PQgetvalue(pgresult, i, REP_STATE));
-				update_str(&n->primary,
-						PQgetvalue(pgresult, i, REP_WAL_INSERT));
-				update_str(&n->sent, PQgetvalue(pgresult, i, REP_SENT));
-				update_str(&n->write, PQgetvalue(pgresult, i, REP_WRITE));
-				update_str(&n->flush, PQgetvalue(pgresult, i, REP_FLUSH));
-				update_str(&n->replay, PQgetvalue(pgresult, i, REP_REPLAY));
-				n->sent_lag = atol(PQgetvalue(pgresult, i, REP_SENT_LAG));
-				n->write_lag = atol(PQgetvalue(pgresult, i, REP_WRITE_LAG));
-				n->flush_lag = atol(PQgetvalue(pgresult, i, REP_FLUSH_LAG));
-				n->replay_lag = atol(PQgetvalue(pgresult, i, REP_REPLAY_LAG));
-
-				memcpy(&pgtable[active_procs++], n, sizeof(struct top_proc));
+				update_str(&n->name, PQgetvalue(pgresult, i, PROC_QUERY));
+				printable(n->name);
 			}
-			else
+			update_state(&n->pgstate, PQgetvalue(pgresult, i, PROC_STATE));
+			update_str(&n->usename, PQgetvalue(pgresult, i, PROC_USENAME));
+			n->xtime = atol(PQgetvalue(pgresult, i, PROC_XSTART));
+			n->qtime = atol(PQgetvalue(pgresult, i, PROC_QSTART));
+			n->locks = atoi(PQgetvalue(pgresult, i, PROC_LOCKS));
+			if (PQnfields(pgresult) > PROC_BACKEND_TYPE)
+				update_str(&n->backend_type,
+						   PQgetvalue(pgresult, i, PROC_BACKEND_TYPE));
+
+			process_states[n->pgstate]++;
+
+			calculate_rates(n, otime, tickdiff);
+
+			if ((show_idle || n->pgstate != STATE_IDLE) &&
+				(sel->usename[0] == '\0' ||
+				 strcmp(n->usename, sel->usename) == 0))
+				memcpy(&pgtable[active_procs++], n,
+					   sizeof(struct top_proc));
+			n->index = (n->index + 1) % 2;
+			total_procs++;
+		}
+
+		/*
+		 * Add the postmaster and any of its children that pg_stat_activity
+		 * did not list, such as the logger, or the archiver and stats
+		 * collector on older versions.
+		 */
+		for (i = 0; i < nchildren; i++)
+		{
+			struct top_proc key;
+			unsigned long otime;
+
+			if (children[i].nspid == -1)
+				continue;
+			key.pid = children[i].nspid;
+			if ((n = RB_FIND(pgproc, &head_proc, &key)) == NULL)
 			{
-				read_one_proc_stat(n, sel);
-				if (sel->fullcmd == 2)
+				if ((n = malloc(sizeof(struct top_proc))) == NULL)
 				{
-					update_str(&n->name, PQgetvalue(pgresult, i, PROC_QUERY));
-					printable(n->name);
+					fprintf(stderr, "malloc error\n");
+					if (pgresult != NULL)
+						PQclear(pgresult);
+					disconnect_from_db(conninfo);
+					exit(1);
 				}
-				update_state(&n->pgstate, PQgetvalue(pgresult, i, PROC_STATE));
-				update_str(&n->usename, PQgetvalue(pgresult, i, PROC_USENAME));
-				n->xtime = atol(PQgetvalue(pgresult, i, PROC_XSTART));
-				n->qtime = atol(PQgetvalue(pgresult, i, PROC_QSTART));
-				n->locks = atoi(PQgetvalue(pgresult, i, PROC_LOCKS));
+				memset(n, 0, sizeof(struct top_proc));
+				n->pid = children[i].nspid;
+				RB_INSERT(pgproc, &head_proc, n);
+			}
+			else if (n->sample == sample)
+				continue;
 
-				process_states[n->pgstate]++;
+			otime = n->time;
+			n->sample = sample;
+			n->ospid = children[i].ospid;
 
-				if (tickdiff > 0.0)
-				{
-					if ((n->pcpu = (n->time - otime) / tickdiff) < 0.0001)
-					{
-						n->pcpu = 0;
-					}
-				}
+			read_one_proc_stat(n, sel);
+			if (n->state == 0)
+				continue;
+			update_str(&n->backend_type, aux_backend_type(n->ospid));
+			update_str(&n->usename, "");
+			n->pgstate = STATE_UNDEFINED;
+			n->xtime = 0;
+			n->qtime = 0;
+			n->locks = 0;
+
+			process_states[n->pgstate]++;
+
+			calculate_rates(n, otime, tickdiff);
+
+			if (sel->usename[0] == '\0')
+				memcpy(&pgtable[active_procs++], n, sizeof(struct top_proc));
 
-				if ((show_idle || n->pgstate != STATE_IDLE) &&
-					(sel->usename[0] == '\0' ||
-					 strcmp(n->usename, sel->usename) == 0))
-					memcpy(&pgtable[active_procs++], n,
-						   sizeof(struct top_proc));
-			}
 			n->index = (n->index + 1) % 2;
 			total_procs++;
 		}
@@ -936,7 +1499,7 @@ get_process_info(struct system_info *si,
 			PQclear(pgresult);
 		disconnect_from_db(conninfo);
 
-		si->p_active = active_procs;
+		si->p_active = proc_active = active_procs;
 		si->p_total = total_procs;
 		si->procstates = process_states;
 	}
@@ -966,20 +1529,54 @@ format_header(char *uname_field)
 	return fmt_header;
 }
 
+/*
+ * Estimate the percentage of bytes read that were served from the page cache
+ * by comparing the bytes read by system calls to the bytes read from storage.
+ * Returns -1 when nothing was read.
+ */
+
+static double
+io_hit(struct top_proc *p)
+{
+	long long	lread = diff_stat(p->rchar, p->index);
+	long long	pread = diff_stat(p->read_bytes, p->index);
+
+	if (lread <= 0)
+		return -1;
+	if (pread >= lread)
+		return 0;
+	return 100.0 - pread * 100.0 / lread;
+}
+
 char *
 format_next_io(caddr_t handle)
 {
 	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		hit[8];
 	struct top_proc *p = &pgtable[proc_index++];
+	double		value;
+
+	if ((value = io_hit(p)) < 0)
+		strcpy(hit, "-");
+	else
+		snprintf(hit, sizeof(hit), "%5.1f", value);
 
 	snprintf(fmt, sizeof(fmt),
-			"%7d %7.0f %7.0f %7.0f %5s %6s %s",
+			"%7d %5.0f %5.0f %5.0f %5s %6s %5s %6s %5s %5.1f %6.0f %6.0f %5.0f %5.0f %s",
 			p->pid,
-			diff_stat(p->iops, p->index) / timediff,
-			diff_stat(p->syscr, p->index) / timediff,
-			diff_stat(p->syscw, p->index) / timediff,
-			format_b(diff_stat(p->read_bytes, p->index) / timediff),
-			format_b(diff_stat(p->write_bytes, p->index) / timediff),
+			rate_stat(p->iops, p->index, timediff),
+			rate_stat(p->syscr, p->index, timediff),
+			rate_stat(p->syscw, p->index, timediff),
+			format_b(rate_stat(p->rchar, p->index, timediff)),
+			format_b(rate_stat(p->wchar, p->index, timediff)),
+			format_b(rate_stat(p->read_bytes, p->index, timediff)),
+			format_b(rate_stat(p->write_bytes, p->index, timediff)),
+			hit,
+			rate_stat(p->blkio, p->index, timediff) * 100.0 / HZ,
+			rate_stat(p->majflt, p->index, timediff),
+			rate_stat(p->minflt, p->index, timediff),
+			rate_stat(p->nvcsw, p->index, timediff),
+			rate_stat(p->nivcsw, p->index, timediff),
 			p->name);
 
 	return (fmt);
@@ -992,15 +1589,17 @@ format_next_process(caddr_t handle)
 	struct top_proc *p = &pgtable[proc_index++];
 
 	snprintf(fmt, sizeof(fmt),
-			 "%7d %-10.8s %5s %5s %-6s %5s %5s %5.1f %5d %s",
+			 "%7d %-10.8s %5s %5s %-6s %-8.8s %5s %5s %5.1f %5.1f %5d %s",
 			 p->pid,
 			 p->usename,
 			 format_k(p->size),
 			 format_k(p->rss),
 			 backendstatenames[p->pgstate],
+			 backend_type_name(p->backend_type),
 			 format_time(p->xtime),
 			 format_time(p->qtime),
 			 p->pcpu * 100.0,
+			 p->prunq * 100.0,
 			 p->locks,
 			 p->name);
 
@@ -1008,31 +1607,159 @@ format_next_process(caddr_t handle)
 	return (fmt);
 }
 
-char *
-format_next_replication(caddr_t handle)
+/* the same as format_next_process(), as a record of --format */
+void
+output_next_process(caddr_t handle)
 {
-	static char fmt[MAX_COLS];	/* static area where result is built */
 	struct top_proc *p = &pgtable[proc_index++];
 
-	snprintf(fmt, sizeof(fmt),
-			 "%7d %-8.8s %-11.11s %15s %-9.9s %-10.10s %-10.10s %-10.10s %-10.10s %-10.10s %5s %5s %5s %5s",
-			 p->pid,
-			 p->usename,
-			 p->application_name,
-			 p->client_addr,
-			 p->repstate,
-			 p->primary,
-			 p->sent,
-			 p->write,
-			 p->flush,
-			 p->replay,
-			 format_b(p->sent_lag),
-			 format_b(p->write_lag),
-			 format_b(p->flush_lag),
-			 format_b(p->replay_lag));
+	output_record();
+	output_long("pid", p->pid);
+	output_string("username", p->usename);
+	output_long("size_kb", p->size);
+	output_long("res_kb", p->rss);
+	output_string("state", backendstatenames[p->pgstate]);
+	output_string("type", backend_type_name(p->backend_type));
+	output_long("xtime_s", p->xtime);
+	output_long("qtime_s", p->qtime);
+	output_double("cpu_pct", p->pcpu * 100.0);
+	output_double("runq_pct", p->prunq * 100.0);
+	output_long("locks", p->locks);
+	output_string("command", p->name);
+	output_end();
+}
 
-	/* return the result */
-	return (fmt);
+/* What replaying processes recorded here needs, without sampling them. */
+void
+machine_replay_init(struct statics *statics)
+{
+	statics->order_names = ordernames;
+}
+
+/* The processes of the last sample, as rows to be recorded. */
+int
+get_process_rows(struct process_row **rows)
+{
+	struct process_row *r;
+	struct top_proc *p;
+	int			i;
+
+	if (proc_active > rowtable_size)
+	{
+		r = reallocarray(rowtable, proc_active, sizeof(struct process_row));
+		if (r == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		rowtable = r;
+		rowtable_size = proc_active;
+	}
+
+	for (i = 0; i < proc_active; i++)
+	{
+		p = &pgtable[i];
+		r = &rowtable[i];
+		r->pid = p->pid;
+		r->usename = p->usename;
+		r->name = p->name;
+		r->backend_type = p->backend_type;
+		r->pgstate = p->pgstate;
+		r->size = p->size;
+		r->rss = p->rss;
+		r->xtime = p->xtime;
+		r->qtime = p->qtime;
+		r->locks = p->locks;
+		r->pcpu = p->pcpu;
+		r->prunq = p->prunq;
+		r->interval = timediff;
+		r->counter[PC_RCHAR] = diff_stat(p->rchar, p->index);
+		r->counter[PC_WCHAR] = diff_stat(p->wchar, p->index);
+		r->counter[PC_SYSCR] = diff_stat(p->syscr, p->index);
+		r->counter[PC_SYSCW] = diff_stat(p->syscw, p->index);
+		r->counter[PC_IOPS] = diff_stat(p->iops, p->index);
+		r->counter[PC_READ_BYTES] = diff_stat(p->read_bytes, p->index);
+		r->counter[PC_WRITE_BYTES] = diff_stat(p->write_bytes, p->index);
+		r->counter[PC_CANCELLED_WRITE_BYTES] = 0;
+		r->counter[PC_BLKIO] = diff_stat(p->blkio, p->index);
+		r->counter[PC_MAJFLT] = diff_stat(p->majflt, p->index);
+		r->counter[PC_MINFLT] = diff_stat(p->minflt, p->index);
+		r->counter[PC_NVCSW] = diff_stat(p->nvcsw, p->index);
+		r->counter[PC_NIVCSW] = diff_stat(p->nivcsw, p->index);
+	}
+
+	*rows = rowtable;
+	return proc_active;
+}
+
+/*
+ * Show recorded processes as if they were sampled, with those not selected
+ * left out and put in order by compare_index.  Each counter is put back as
+ * its change from a sample of nothing.
+ */
+caddr_t
+put_process_rows(struct system_info *si, struct process_select *sel,
+				 struct process_row *rows, int nrows, int compare_index)
+{
+	struct top_proc *p;
+	struct process_row *r;
+	int			i;
+
+	if (nrows > 0)
+	{
+		p = reallocarray(pgtable, nrows, sizeof(struct top_proc));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		pgtable = p;
+	}
+
+	proc_active = 0;
+	for (i = 0; i < nrows; i++)
+	{
+		r = &rows[i];
+		if ((!sel->idle && r->pgstate == STATE_IDLE) ||
+			(sel->usename[0] != '\0' && strcmp(r->usename, sel->usename) != 0))
+			continue;
+
+		p = &pgtable[proc_active++];
+		memset(p, 0, sizeof(struct top_proc));
+		p->pid = r->pid;
+		p->usename = r->usename;
+		p->name = r->name;
+		p->backend_type = r->backend_type;
+		p->pgstate = r->pgstate;
+		p->size = r->size;
+		p->rss = r->rss;
+		p->xtime = r->xtime;
+		p->qtime = r->qtime;
+		p->locks = r->locks;
+		p->pcpu = r->pcpu;
+		p->prunq = r->prunq;
+		p->rchar[0] = r->counter[PC_RCHAR];
+		p->wchar[0] = r->counter[PC_WCHAR];
+		p->syscr[0] = r->counter[PC_SYSCR];
+		p->syscw[0] = r->counter[PC_SYSCW];
+		p->iops[0] = r->counter[PC_IOPS];
+		p->read_bytes[0] = r->counter[PC_READ_BYTES];
+		p->write_bytes[0] = r->counter[PC_WRITE_BYTES];
+		p->blkio[0] = r->counter[PC_BLKIO];
+		p->majflt[0] = r->counter[PC_MAJFLT];
+		p->minflt[0] = r->counter[PC_MINFLT];
+		p->nvcsw[0] = r->counter[PC_NVCSW];
+		p->nivcsw[0] = r->counter[PC_NIVCSW];
+	}
+	timediff = nrows > 0 ? rows[0].interval : 0;
+
+	si->p_active = proc_active;
+	if (compare_index >= 0 && proc_active > 0)
+		qsort(pgtable, proc_active, sizeof(struct top_proc),
+			  proc_compares[compare_index]);
+
+	proc_index = 0;
+	return (caddr_t) 0;
 }
 
 /* comparison routines for qsort */
@@ -1054,22 +1781,37 @@ format_next_replication(caddr_t handle)
    desired ordering.
  */
 
+#define ORDERKEY_BLKIO  if ((result = diff_stat(p2->blkio, p2->index) - \
+                                       diff_stat(p1->blkio, p1->index)) == 0)
+#define ORDERKEY_HIT     if ((result = (io_hit(p2) > io_hit(p1)) - \
+                                       (io_hit(p2) < io_hit(p1))) == 0)
 #define ORDERKEY_IOPS   if ((result = diff_stat(p2->iops, p2->index) - \
 			                          diff_stat(p1->iops, p1->index)) == 0)
-#define ORDERKEY_LAG_FLUSH  if ((result = p2->flush_lag - p1->flush_lag) == 0)
-#define ORDERKEY_LAG_REPLAY if ((result = p2->replay_lag - \
-                                          p1->replay_lag) == 0)
-#define ORDERKEY_LAG_SENT   if ((result = p2->sent_lag - p1->sent_lag) == 0)
-#define ORDERKEY_LAG_WRITE  if ((result = p2->write_lag - p1->write_lag) == 0)
 #define ORDERKEY_LOCKS   if ((result = p2->locks - p1->locks) == 0)
+#define ORDERKEY_LREAD   if ((result = diff_stat(p2->rchar, p2->index) - \
+                                       diff_stat(p1->rchar, p1->index)) == 0)
+#define ORDERKEY_LWRITE  if ((result = diff_stat(p2->wchar, p2->index) - \
+                                       diff_stat(p1->wchar, p1->index)) == 0)
+#define ORDERKEY_MAJFLT  if ((result = diff_stat(p2->majflt, p2->index) - \
+                                       diff_stat(p1->majflt, p1->index)) == 0)
 #define ORDERKEY_MEM     if ((result = p2->size - p1->size) == 0)
+#define ORDERKEY_MINFLT  if ((result = diff_stat(p2->minflt, p2->index) - \
+                                       diff_stat(p1->minflt, p1->index)) == 0)
 #define ORDERKEY_NAME    if ((result = strcmp(p1->name, p2->name)) == 0)
+#define ORDERKEY_NIVCSW  if ((result = diff_stat(p2->nivcsw, p2->index) - \
+                                       diff_stat(p1->nivcsw, p1->index)) == 0)
+#define ORDERKEY_NVCSW   if ((result = diff_stat(p2->nvcsw, p2->index) - \
+                                       diff_stat(p1->nvcsw, p1->index)) == 0)
 #define ORDERKEY_PCTCPU  if ((result = (int)(p2->pcpu - p1->pcpu)) == 0)
 #define ORDERKEY_QTIME   if ((result = p2->qtime - p1->qtime) == 0)
 #define ORDERKEY_READS   if ((result = diff_stat(p2->read_bytes, p2->index) - \
 			                           diff_stat(p1->read_bytes, p1->index)) == 0)
 #define ORDERKEY_RSSIZE  if ((result = p2->rss - p1->rss) == 0)
+#define ORDERKEY_RUNQ    if ((result = (p2->prunq > p1->prunq) - \
+                                       (p2->prunq < p1->prunq)) == 0)
 #define ORDERKEY_STATE   if ((result = p1->pgstate < p2->pgstate))
+#define ORDERKEY_TYPE    if ((result = strcmp(backend_type_name(p1->backend_type), \
+                                              backend_type_name(p2->backend_type))) == 0)
 #define ORDERKEY_SYSCR   if ((result = diff_stat(p2->syscr, p2->index) - \
                                        diff_stat(p1->syscr, p1->index)) == 0)
 #define ORDERKEY_SYSCW   if ((result = diff_stat(p2->syscw, p2->index) - \
@@ -1078,6 +1820,28 @@ format_next_replication(caddr_t handle)
 			                           diff_stat(p1->write_bytes, p1->index)) == 0)
 #define ORDERKEY_XTIME   if ((result = p2->xtime - p1->xtime) == 0)
 
+/*
+ * compare_blkio - the comparison function for sorting by time spent waiting on
+ * block i/o
+ */
+
+static int
+compare_blkio(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_BLKIO
+		ORDERKEY_READS
+		ORDERKEY_WRITES
+		ORDERKEY_IOPS
+		ORDERKEY_NAME
+		;
+
+	return (result);
+}
+
 /* compare_cmd - the comparison function for sorting by command name */
 
 static int
@@ -1115,6 +1879,27 @@ compare_cpu(const void *v1, const void *v2)
 	return (result);
 }
 
+/*
+ * compare_hit - the comparison function for sorting by the estimated page
+ * cache hit percentage
+ */
+
+static int
+compare_hit(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_HIT
+		ORDERKEY_LREAD
+		ORDERKEY_READS
+		ORDERKEY_NAME
+		;
+
+	return (result);
+}
+
 /* compare_iops - the comparison function for sorting by iops */
 
 static int
@@ -1135,14 +1920,19 @@ compare_iops(const void *v1, const void *v2)
 	return (result);
 }
 
+/*
+ * compare_locks - the comparison function for sorting by total locks ancquired
+ */
+
 static int
-compare_lag_flush(const void *v1, const void *v2)
+compare_locks(const void *v1, const void *v2)
 {
 	struct top_proc *p1 = (struct top_proc *) v1;
 	struct top_proc *p2 = (struct top_proc *) v2;
 	int			result;
 
-	ORDERKEY_LAG_FLUSH
+	ORDERKEY_LOCKS
+		ORDERKEY_QTIME
 		ORDERKEY_PCTCPU
 		ORDERKEY_STATE
 		ORDERKEY_MEM
@@ -1152,74 +1942,121 @@ compare_lag_flush(const void *v1, const void *v2)
 	return (result);
 }
 
+/* compare_lread - the comparison function for sorting by bytes read */
+
 static int
-compare_lag_replay(const void *v1, const void *v2)
+compare_lread(const void *v1, const void *v2)
 {
 	struct top_proc *p1 = (struct top_proc *) v1;
 	struct top_proc *p2 = (struct top_proc *) v2;
 	int			result;
 
-	ORDERKEY_LAG_REPLAY
-		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
+	ORDERKEY_LREAD
+		ORDERKEY_READS
+		ORDERKEY_SYSCR
+		ORDERKEY_IOPS
+		ORDERKEY_NAME
+		;
+
+	return (result);
+}
+
+/* compare_lwrite - the comparison function for sorting by bytes written */
+
+static int
+compare_lwrite(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_LWRITE
+		ORDERKEY_WRITES
+		ORDERKEY_SYSCW
+		ORDERKEY_IOPS
+		ORDERKEY_NAME
 		;
 
 	return (result);
 }
 
+/* compare_majflt - the comparison function for sorting by major page faults */
+
 static int
-compare_lag_sent(const void *v1, const void *v2)
+compare_majflt(const void *v1, const void *v2)
 {
 	struct top_proc *p1 = (struct top_proc *) v1;
 	struct top_proc *p2 = (struct top_proc *) v2;
 	int			result;
 
-	ORDERKEY_LAG_SENT
+	ORDERKEY_MAJFLT
+		ORDERKEY_MINFLT
+		ORDERKEY_READS
 		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
+		ORDERKEY_NAME
+		;
+
+	return (result);
+}
+
+/* compare_minflt - the comparison function for sorting by minor page faults */
+
+static int
+compare_minflt(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_MINFLT
+		ORDERKEY_MAJFLT
 		ORDERKEY_RSSIZE
+		ORDERKEY_PCTCPU
+		ORDERKEY_NAME
 		;
 
 	return (result);
 }
 
+/*
+ * compare_nivcsw - the comparison function for sorting by involuntary context
+ * switches
+ */
+
 static int
-compare_lag_write(const void *v1, const void *v2)
+compare_nivcsw(const void *v1, const void *v2)
 {
 	struct top_proc *p1 = (struct top_proc *) v1;
 	struct top_proc *p2 = (struct top_proc *) v2;
 	int			result;
 
-	ORDERKEY_LAG_WRITE
+	ORDERKEY_NIVCSW
+		ORDERKEY_NVCSW
 		ORDERKEY_PCTCPU
 		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
+		ORDERKEY_NAME
 		;
 
 	return (result);
 }
 
 /*
- * compare_locks - the comparison function for sorting by total locks ancquired
+ * compare_nvcsw - the comparison function for sorting by voluntary context
+ * switches
  */
 
 static int
-compare_locks(const void *v1, const void *v2)
+compare_nvcsw(const void *v1, const void *v2)
 {
 	struct top_proc *p1 = (struct top_proc *) v1;
 	struct top_proc *p2 = (struct top_proc *) v2;
 	int			result;
 
-	ORDERKEY_LOCKS
-		ORDERKEY_QTIME
+	ORDERKEY_NVCSW
+		ORDERKEY_NIVCSW
 		ORDERKEY_PCTCPU
 		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
+		ORDERKEY_NAME
 		;
 
 	return (result);
@@ -1280,6 +2117,28 @@ compare_res(const void *v1, const void *v2)
 	return (result);
 }
 
+/*
+ * compare_runq - the comparison function for sorting by time spent waiting for
+ * a cpu
+ */
+
+static int
+compare_runq(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_RUNQ
+		ORDERKEY_PCTCPU
+		ORDERKEY_STATE
+		ORDERKEY_RSSIZE
+		ORDERKEY_MEM
+		;
+
+	return (result);
+}
+
 /* compare_size - the comparison function for sorting by total memory usage */
 
 static int
@@ -1334,6 +2193,25 @@ compare_syscw(const void *v1, const void *v2)
 	return (result);
 }
 
+/* compare_type - the comparison function for sorting by backend type */
+
+static int
+compare_type(const void *v1, const void *v2)
+{
+	struct top_proc *p1 = (struct top_proc *) v1;
+	struct top_proc *p2 = (struct top_proc *) v2;
+	int			result;
+
+	ORDERKEY_TYPE
+		ORDERKEY_PCTCPU
+		ORDERKEY_STATE
+		ORDERKEY_RSSIZE
+		ORDERKEY_MEM
+		;
+
+	return (result);
+}
+
 /* compare_xtime - the comparison function for sorting by total cpu xtime */
 
 static int
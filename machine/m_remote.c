@@ -6,6 +6,7 @@
 #define _GNU_SOURCE
 #endif /* __linux__ */
 
+#include <ctype.h>
 #include <stdlib.h>
 #if defined(__FreeBSD__) || defined(__OpenBSD__)
 #include <sys/tree.h>
@@ -21,21 +22,34 @@
 
 #include "pg.h"
 
+#include "delta.h"
+#include "output.h"
 #include "remote.h"
 #include "utils.h"
 
-#define QUERY_CPUTIME \
-		"SELECT user, nice, system, idle, iowait\n" \
-		"FROM pg_cputime()"
-
-#define QUERY_LOADAVG \
-		"SELECT load1, load5, load15, last_pid\n" \
-		"FROM pg_loadavg()"
-
-#define QUERY_MEMUSAGE \
-		"SELECT memused, memfree, memshared, membuffers, memcached,\n" \
-		"       swapused, swapfree, swapcached\n" \
-		"FROM pg_memusage()"
+/*
+ * The load averages, processor time and memory usage of the system, in one
+ * row, from whichever of pg_loadavg(), pg_cputime() and pg_memusage() are
+ * installed.  The columns of those that are not are NULL.  It is sampled
+ * just before the processes, followed by the disks where pg_diskusage() is
+ * installed, in a round trip of its own so that an error in the functions
+ * cannot lose the processes.
+ */
+#define QUERY_SYSTEM "SELECT %s,\n       %s,\n       %s%s;\n"
+
+#define SYSTEM_LOADAVG "load1, load5, load15, last_pid"
+#define SYSTEM_NO_LOADAVG "NULL, NULL, NULL, NULL"
+#define SYSTEM_CPUTIME "c.\"user\", nice, system, idle, iowait"
+#define SYSTEM_NO_CPUTIME "NULL, NULL, NULL, NULL, NULL"
+#define SYSTEM_MEMUSAGE \
+		"memused, memfree, memshared, membuffers, memcached,\n" \
+		"       swapused, swapfree, swapcached"
+#define SYSTEM_NO_MEMUSAGE "NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL"
+
+#define QUERY_DISKUSAGE \
+		"SELECT devname, reads_completed, sectors_read, writes_completed,\n" \
+		"       sectors_written, iotime\n" \
+		"FROM pg_diskusage();\n"
 
 #define QUERY_PROCTAB \
 		"WITH lock_activity AS\n" \
@@ -78,24 +92,57 @@
 		"     LEFT OUTER JOIN lock_activity c\n" \
 		"  ON a.pid = c.pid;"
 
+/*
+ * The sessions without their operating system statistics, for when
+ * pg_proctab() is not installed.
+ */
+#define QUERY_ACTIVITY \
+		"WITH lock_activity AS\n" \
+		"(\n" \
+		"     SELECT pid, count(*) AS lock_count\n" \
+		"     FROM pg_locks\n" \
+		"     WHERE relation IS NOT NULL\n" \
+		"     GROUP BY pid\n" \
+		")\n" \
+		"SELECT a.pid, 'postgres', query, 'S', 0, 0,\n" \
+		"       0, 0, 0, usename, 0, 0,\n" \
+		"       0, 0, 0, 0, 0, a.state,\n" \
+		"       extract(EPOCH FROM age(clock_timestamp(),\n" \
+		"                              xact_start))::BIGINT,\n" \
+		"       extract(EPOCH FROM age(clock_timestamp(),\n" \
+		"                              query_start))::BIGINT,\n" \
+		"       coalesce(lock_count, 0) AS lock_count\n" \
+		"FROM pg_stat_activity a LEFT OUTER JOIN lock_activity c\n" \
+		"  ON a.pid = c.pid;"
+
 #define QUERY_PG_PROC \
 		"SELECT COUNT(*)\n" \
 		"FROM pg_catalog.pg_proc\n" \
-		"WHERE proname = '%s'"
+		"WHERE proname = '%s'\n" \
+		"  AND has_function_privilege(oid, 'EXECUTE')"
 
-enum column_cputime
+enum column_system
 {
+	c_load1, c_load5, c_load15, c_last_pid,
 	c_cpu_user, c_cpu_nice, c_cpu_system, c_cpu_idle,
-	c_cpu_iowait
+	c_cpu_iowait,
+	c_memused, c_memfree, c_memshared, c_membuffers,
+	c_memcached, c_swapused, c_swapfree, c_swapcached
 };
-enum column_loadavg
+
+enum column_diskusage
 {
-	c_load1, c_load5, c_load15, c_last_pid
+	c_devname, c_disk_reads, c_disk_sectors_read, c_disk_writes,
+	c_disk_sectors_written, c_disk_iotime
 };
-enum column_memusage
+
+/*
+ * The results of the round trip sampling the system.  There is no
+ * r_diskusage result when pg_diskusage() is not installed.
+ */
+enum system_result
 {
-	c_memused, c_memfree, c_memshared, c_membuffers,
-	c_memcached, c_swapused, c_swapfree, c_swapcached
+	r_system, r_diskusage, r_count
 };
 enum column_proctab
 {
@@ -142,42 +189,36 @@ struct top_proc_r
 	unsigned int locks;
 	double		pcpu;
 
-	/* The change in the previous values and current values. */
-	long long	rchar_diff;
-	long long	wchar_diff;
-	long long	syscr_diff;
-	long long	syscw_diff;
-	long long	read_bytes_diff;
-	long long	write_bytes_diff;
-	long long	cancelled_write_bytes_diff;
-
-	/* The absolute values. */
-	long long	rchar;
-	long long	wchar;
-	long long	syscr;
-	long long	syscw;
-	long long	read_bytes;
-	long long	write_bytes;
-	long long	cancelled_write_bytes;
-
-	/* Replication data */
-	char	   *application_name;
-	char	   *client_addr;
-	char	   *repstate;
-	char	   *primary;
-	char	   *sent;
-	char	   *write;
-	char	   *flush;
-	char	   *replay;
-	long long	sent_lag;
-	long long	write_lag;
-	long long	flush_lag;
-	long long	replay_lag;
+	/* index for which element is current in data arrays */
+	int			index;
+
+	/* the last sample this process was seen in */
+	unsigned int sample;
+
+	/* the number of samples of this process */
+	int			samples;
+
+	/* when each sample was taken, from sample_time() */
+	double		sampled[2];
+
+	long long	rchar[2];
+	long long	wchar[2];
+	long long	syscr[2];
+	long long	syscw[2];
+	long long	read_bytes[2];
+	long long	write_bytes[2];
+	long long	cancelled_write_bytes[2];
 };
 
 static time_t boottime = -1;
 static struct top_proc_r *pgrtable;
 static int	proc_r_index;
+static int	proc_r_active;
+static unsigned int proc_r_sample;
+
+/* the processes of the last sample, as rows for recording them */
+static struct process_row *rowtable;
+static int	rowtable_size;
 
 int			topprocrcmp(struct top_proc_r *, struct top_proc_r *);
 
@@ -185,6 +226,58 @@ RB_HEAD(pgprocr, top_proc_r) head_proc_r = RB_INITIALIZER(&head_proc_r);
 RB_PROTOTYPE(pgprocr, top_proc_r, entry, topprocrcmp)
 RB_GENERATE(pgprocr, top_proc_r, entry, topprocrcmp)
 
+struct disk_r
+{
+	RB_ENTRY(disk_r) entry;
+	char	   *name;
+
+	/* index for which element is current in data arrays */
+	int			index;
+
+	/* the last sample this disk was seen in */
+	unsigned int sample;
+
+	/* the number of samples of this disk */
+	int			samples;
+
+	/* when each sample was taken, from sample_time() */
+	double		sampled[2];
+
+	long long	reads[2];
+	long long	sectors_read[2];
+	long long	writes[2];
+	long long	sectors_written[2];
+	long long	iotime[2];		/* milliseconds */
+};
+
+int			diskrcmp(struct disk_r *, struct disk_r *);
+
+RB_HEAD(pgdiskr, disk_r) head_disk_r = RB_INITIALIZER(&head_disk_r);
+RB_PROTOTYPE(pgdiskr, disk_r, entry, diskrcmp)
+RB_GENERATE(pgdiskr, disk_r, entry, diskrcmp)
+
+static struct disk_info disk_info;
+static unsigned int disk_sample;
+
+/*
+ * Which of the functions pg_proctab provides are installed, found by
+ * machine_init_r().
+ */
+static int	has_cputime;
+static int	has_diskusage;
+static int	has_loadavg;
+static int	has_memusage;
+static int	has_proctab;
+
+/*
+ * The query for the system and the number of results it gives, and those for
+ * the processes, showing their command lines or their queries.
+ */
+static char *system_query;
+static int	system_results;
+static char *sample_query;
+static char *sample_query_query;
+
 static char *cpustatenames[NCPUSTATES + 1] =
 {
 	"user", "nice", "system", "idle", "iowait", NULL
@@ -199,8 +292,7 @@ static char *memorynames[NMEMSTATS + 1] =
 static char *ordernames[] =
 {
 	"cpu", "size", "res", "xtime", "qtime", "rchar", "wchar", "syscr",
-	"syscw", "reads", "writes", "cwrites", "locks", "command", "flag",
-	"rlag", "slag", "wlag", NULL
+	"syscw", "reads", "writes", "cwrites", "locks", "command", NULL
 };
 
 static char *swapnames[NSWAPSTATS + 1] =
@@ -214,9 +306,6 @@ static char fmt_header[] =
 char		fmt_header_io_r[] =
 "    PID RCHAR WCHAR   SYSCR   SYSCW READS WRITES CWRITES COMMAND";
 
-char		fmt_header_replication_r[] =
-"    PID USERNAME APPLICATION          CLIENT STATE     PRIMARY    SENT       WRITE      FLUSH      REPLAY      SLAG  WLAG  FLAG  RLAG";
-
 /* Now the array that maps process state to a weight. */
 
 unsigned char sort_state_r[] =
@@ -235,8 +324,6 @@ static long memory_stats[NMEMSTATS];
 static int	process_states[NPROCSTATES];
 static long swap_stats[NSWAPSTATS];
 
-static struct timeval lasttime;
-
 static int64_t cp_time[NCPUSTATES];
 static int64_t cp_old[NCPUSTATES];
 static int64_t cp_diff[NCPUSTATES];
@@ -244,32 +331,28 @@ static int64_t cp_diff[NCPUSTATES];
 #define ORDERKEY_PCTCPU  if ((result = (int)(p2->pcpu - p1->pcpu)) == 0)
 #define ORDERKEY_STATE	 if ((result = p1->pgstate < p2->pgstate))
 #define ORDERKEY_RSSIZE  if ((result = p2->rss - p1->rss) == 0)
-#define ORDERKEY_LAG_FLUSH  if ((result = p2->flush_lag - p1->flush_lag) == 0)
-#define ORDERKEY_LAG_REPLAY if ((result = p2->replay_lag - \
-                                          p1->replay_lag) == 0)
-#define ORDERKEY_LAG_SENT   if ((result = p2->sent_lag - p1->sent_lag) == 0)
-#define ORDERKEY_LAG_WRITE  if ((result = p2->write_lag - p1->write_lag) == 0)
 #define ORDERKEY_MEM	 if ((result = p2->size - p1->size) == 0)
 #define ORDERKEY_NAME	if ((result = strcmp(p1->name, p2->name)) == 0)
-#define ORDERKEY_RCHAR	 if ((result = p1->rchar - p2->rchar) == 0)
-#define ORDERKEY_WCHAR	 if ((result = p1->wchar - p2->wchar) == 0)
-#define ORDERKEY_SYSCR	 if ((result = p1->syscr - p2->syscr) == 0)
-#define ORDERKEY_SYSCW	 if ((result = p1->syscw - p2->syscw) == 0)
-#define ORDERKEY_READS	 if ((result = p1->read_bytes - p2->read_bytes) == 0)
-#define ORDERKEY_WRITES	 if ((result = p1->write_bytes - p2->write_bytes) == 0)
-#define ORDERKEY_CWRITES if ((result = p1->cancelled_write_bytes - p2->cancelled_write_bytes) == 0)
+#define ORDERKEY_IO(field) \
+	if ((result = (io_rate(p2, p2->field) > io_rate(p1, p1->field)) - \
+				  (io_rate(p2, p2->field) < io_rate(p1, p1->field))) == 0)
+#define ORDERKEY_RCHAR	 ORDERKEY_IO(rchar)
+#define ORDERKEY_WCHAR	 ORDERKEY_IO(wchar)
+#define ORDERKEY_SYSCR	 ORDERKEY_IO(syscr)
+#define ORDERKEY_SYSCW	 ORDERKEY_IO(syscw)
+#define ORDERKEY_READS	 ORDERKEY_IO(read_bytes)
+#define ORDERKEY_WRITES	 ORDERKEY_IO(write_bytes)
+#define ORDERKEY_CWRITES ORDERKEY_IO(cancelled_write_bytes)
 #define ORDERKEY_XTIME if ((result = p2->xtime - p1->xtime) == 0)
 #define ORDERKEY_QTIME if ((result = p2->qtime - p1->qtime) == 0)
 #define ORDERKEY_LOCKS if ((result = p2->locks - p1->locks) == 0)
 
 int			check_for_function(PGconn *, char *);
+static void build_sample_queries(void);
+static double io_rate(struct top_proc_r *, long long *);
 static int	compare_cmd_r(const void *, const void *);
 static int	compare_cpu_r(const void *, const void *);
 static int	compare_cwrites_r(const void *, const void *);
-static int	compare_lag_flush(const void *, const void *);
-static int	compare_lag_replay(const void *, const void *);
-static int	compare_lag_sent(const void *, const void *);
-static int	compare_lag_write(const void *, const void *);
 static int	compare_locks_r(const void *, const void *);
 static int	compare_qtime_r(const void *, const void *);
 static int	compare_rchar_r(const void *, const void *);
@@ -282,6 +365,10 @@ static int	compare_wchar_r(const void *, const void *);
 static int	compare_writes_r(const void *, const void *);
 static int	compare_xtime_r(const void *, const void *);
 
+/*
+ * Whether a stored function is installed and can be run, returning 1 if it
+ * is, 0 if it is not or -1 on error.
+ */
 int
 check_for_function(PGconn *pgconn, char *procname)
 {
@@ -293,21 +380,75 @@ check_for_function(PGconn *pgconn, char *procname)
 	sprintf(sql, QUERY_PG_PROC, procname);
 	pgresult = PQexec(pgconn, sql);
 	rows = PQntuples(pgresult);
-	/* Don't need to clean up on error, the program will exit shortly after. */
 	if (rows == 0)
 	{
 		fprintf(stderr, "Error executing '%s'.\n", sql);
+		PQclear(pgresult);
 		return -1;
 	}
 	count = atoi(PQgetvalue(pgresult, 0, 0));
-	if (count == 0)
+	PQclear(pgresult);
+	return count > 0;
+}
+
+static char *
+concat_query(const char *first, const char *second)
+{
+	char	   *sql;
+
+	sql = malloc(strlen(first) + strlen(second) + 1);
+	if (sql == NULL)
 	{
-		fprintf(stderr, "Stored function '%s' is missing.\n", procname);
-		return -1;
+		fprintf(stderr, "malloc error\n");
+		exit(1);
 	}
-	if (pgresult != NULL)
-		PQclear(pgresult);
-	return 0;
+	strcpy(sql, first);
+	strcat(sql, second);
+	return sql;
+}
+
+/*
+ * Put together the queries for a sample from the functions that are
+ * installed.
+ */
+static void
+build_sample_queries(void)
+{
+	char		from[sizeof("\nFROM pg_loadavg(), pg_cputime() c, pg_memusage()")];
+	char		system[sizeof(QUERY_SYSTEM SYSTEM_LOADAVG SYSTEM_CPUTIME
+							  SYSTEM_MEMUSAGE) + sizeof(from)];
+	const char *disk = has_diskusage ? QUERY_DISKUSAGE : "";
+	const char *separator = "\nFROM ";
+
+	from[0] = '\0';
+	if (has_loadavg)
+	{
+		strcat(from, separator);
+		strcat(from, "pg_loadavg()");
+		separator = ", ";
+	}
+	if (has_cputime)
+	{
+		strcat(from, separator);
+		strcat(from, "pg_cputime() c");
+		separator = ", ";
+	}
+	if (has_memusage)
+	{
+		strcat(from, separator);
+		strcat(from, "pg_memusage()");
+	}
+
+	snprintf(system, sizeof(system), QUERY_SYSTEM,
+			 has_loadavg ? SYSTEM_LOADAVG : SYSTEM_NO_LOADAVG,
+			 has_cputime ? SYSTEM_CPUTIME : SYSTEM_NO_CPUTIME,
+			 has_memusage ? SYSTEM_MEMUSAGE : SYSTEM_NO_MEMUSAGE,
+			 from);
+
+	system_query = concat_query(system, disk);
+	system_results = has_diskusage ? r_count : r_count - 1;
+	sample_query = has_proctab ? QUERY_PROCTAB : QUERY_ACTIVITY;
+	sample_query_query = has_proctab ? QUERY_PROCTAB_QUERY : QUERY_ACTIVITY;
 }
 
 int			(*proc_compares_r[]) () =
@@ -326,10 +467,6 @@ int			(*proc_compares_r[]) () =
 		compare_cwrites_r,
 		compare_locks_r,
 		compare_cmd_r,
-		compare_lag_flush,
-		compare_lag_replay,
-		compare_lag_sent,
-		compare_lag_write,
 		NULL
 };
 
@@ -390,74 +527,6 @@ compare_cwrites_r(const void *v1, const void *v2)
 	return (result);
 }
 
-static int
-compare_lag_flush(const void *v1, const void *v2)
-{
-	struct top_proc_r *p1 = (struct top_proc_r *) v1;
-	struct top_proc_r *p2 = (struct top_proc_r *) v2;
-	int			result;
-
-	ORDERKEY_LAG_FLUSH
-		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
-		;
-
-	return (result);
-}
-
-static int
-compare_lag_replay(const void *v1, const void *v2)
-{
-	struct top_proc_r *p1 = (struct top_proc_r *) v1;
-	struct top_proc_r *p2 = (struct top_proc_r *) v2;
-	int			result;
-
-	ORDERKEY_LAG_REPLAY
-		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
-		;
-
-	return (result);
-}
-
-static int
-compare_lag_sent(const void *v1, const void *v2)
-{
-	struct top_proc_r *p1 = (struct top_proc_r *) v1;
-	struct top_proc_r *p2 = (struct top_proc_r *) v2;
-	int			result;
-
-	ORDERKEY_LAG_SENT
-		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
-		;
-
-	return (result);
-}
-
-static int
-compare_lag_write(const void *v1, const void *v2)
-{
-	struct top_proc_r *p1 = (struct top_proc_r *) v1;
-	struct top_proc_r *p2 = (struct top_proc_r *) v2;
-	int			result;
-
-	ORDERKEY_LAG_WRITE
-		ORDERKEY_PCTCPU
-		ORDERKEY_STATE
-		ORDERKEY_MEM
-		ORDERKEY_RSSIZE
-		;
-
-	return (result);
-}
-
 /*
  * compare_locks_r - the comparison function for sorting by total locks
  * acquired
@@ -686,6 +755,19 @@ format_header_r(char *uname_field)
 	return fmt_header;
 }
 
+/*
+ * A counter of a process per second, over the time between its last two
+ * samples, or 0 before it has been sampled twice.
+ */
+static double
+io_rate(struct top_proc_r *p, long long *value)
+{
+	if (p->samples < 2)
+		return 0;
+	return rate_stat(value, p->index,
+					 p->sampled[p->index] - p->sampled[(p->index + 1) % 2]);
+}
+
 char *
 format_next_io_r(caddr_t handler)
 {
@@ -693,15 +775,15 @@ format_next_io_r(caddr_t handler)
 	struct top_proc_r *p = &pgrtable[proc_r_index++];
 
 	snprintf(fmt, sizeof(fmt),
-			"%7d %5s %5s %7lld %7lld %5s %6s %7s %s",
+			"%7d %5s %5s %7.0f %7.0f %5s %6s %7s %s",
 			(int) p->pid,
-			format_b(p->rchar_diff),
-			format_b(p->wchar_diff),
-			p->syscr_diff,
-			p->syscw_diff,
-			format_b(p->read_bytes_diff),
-			format_b(p->write_bytes_diff),
-			format_b(p->cancelled_write_bytes_diff),
+			format_b(io_rate(p, p->rchar)),
+			format_b(io_rate(p, p->wchar)),
+			io_rate(p, p->syscr),
+			io_rate(p, p->syscw),
+			format_b(io_rate(p, p->read_bytes)),
+			format_b(io_rate(p, p->write_bytes)),
+			format_b(io_rate(p, p->cancelled_write_bytes)),
 			p->name);
 
 	return (fmt);
@@ -729,48 +811,178 @@ format_next_process_r(caddr_t handler)
 	return (fmt);
 }
 
-char *
-format_next_replication_r(caddr_t handle)
+/* the same as format_next_process_r(), as a record of --format */
+void
+output_next_process_r(caddr_t handler)
 {
-	static char fmt[MAX_COLS];	/* static area where result is built */
 	struct top_proc_r *p = &pgrtable[proc_r_index++];
 
-	snprintf(fmt, sizeof(fmt),
-			 "%7d %-8.8s %-11.11s %15s %-9.9s %9s %9s %9s %9s %9s %5s %5s %5s %5s",
-			 p->pid,
-			 p->usename,
-			 p->application_name,
-			 p->client_addr,
-			 p->repstate,
-			 p->primary,
-			 p->sent,
-			 p->write,
-			 p->flush,
-			 p->replay,
-			 format_b(p->sent_lag),
-			 format_b(p->write_lag),
-			 format_b(p->flush_lag),
-			 format_b(p->replay_lag));
-
-	/* return the result */
-	return (fmt);
+	output_record();
+	output_long("pid", p->pid);
+	output_string("username", p->usename);
+	output_long("size_kb", p->size);
+	output_long("res_kb", p->rss);
+	output_string("state", backendstatenames[p->pgstate]);
+	/* pg_proctab reports neither, so they are written as unknown */
+	output_null("type");
+	output_long("xtime_s", p->xtime);
+	output_long("qtime_s", p->qtime);
+	output_double("cpu_pct", p->pcpu * 100.0);
+	output_null("runq_pct");
+	output_long("locks", p->locks);
+	output_string("command", p->name);
+	output_end();
 }
 
+/* What replaying processes recorded in remote mode needs, without a server. */
 void
-get_system_info_r(struct system_info *info, struct pg_conninfo_ctx *conninfo)
+machine_replay_init_r(struct statics *statics)
 {
-	PGresult   *pgresult = NULL;
-	int			rows = 0;
+	statics->order_names = ordernames;
+}
 
-	connect_to_db(conninfo);
-	if (conninfo->connection != NULL)
+/* The processes of the last sample, as rows to be recorded. */
+int
+get_process_rows_r(struct process_row **rows)
+{
+	struct process_row *r;
+	struct top_proc_r *p;
+	int			i;
+
+	if (proc_r_active > rowtable_size)
 	{
-		pgresult = PQexec(conninfo->connection, QUERY_LOADAVG);
-		rows = PQntuples(pgresult);
+		r = reallocarray(rowtable, proc_r_active, sizeof(struct process_row));
+		if (r == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		rowtable = r;
+		rowtable_size = proc_r_active;
 	}
 
-	/* Get load averages. */
-	if (rows > 0)
+	for (i = 0; i < proc_r_active; i++)
+	{
+		p = &pgrtable[i];
+		r = &rowtable[i];
+		memset(r, 0, sizeof(struct process_row));
+		r->pid = p->pid;
+		r->usename = p->usename;
+		r->name = p->name;
+		r->pgstate = p->pgstate;
+		r->size = p->size;
+		r->rss = p->rss;
+		r->xtime = p->xtime;
+		r->qtime = p->qtime;
+		r->locks = p->locks;
+		r->pcpu = p->pcpu;
+
+		/* a process seen for the first time has no changes yet */
+		if (p->samples < 2)
+			continue;
+		r->interval = p->sampled[p->index] - p->sampled[(p->index + 1) % 2];
+		r->counter[PC_RCHAR] = diff_stat(p->rchar, p->index);
+		r->counter[PC_WCHAR] = diff_stat(p->wchar, p->index);
+		r->counter[PC_SYSCR] = diff_stat(p->syscr, p->index);
+		r->counter[PC_SYSCW] = diff_stat(p->syscw, p->index);
+		r->counter[PC_READ_BYTES] = diff_stat(p->read_bytes, p->index);
+		r->counter[PC_WRITE_BYTES] = diff_stat(p->write_bytes, p->index);
+		r->counter[PC_CANCELLED_WRITE_BYTES] =
+			diff_stat(p->cancelled_write_bytes, p->index);
+	}
+
+	*rows = rowtable;
+	return proc_r_active;
+}
+
+/*
+ * Show recorded processes as if they were sampled, with those not selected
+ * left out and put in order by compare_index.  Each counter is put back as
+ * its change from a sample of nothing.
+ */
+caddr_t
+put_process_rows_r(struct system_info *si, struct process_select *sel,
+				   struct process_row *rows, int nrows, int compare_index)
+{
+	struct top_proc_r *p;
+	struct process_row *r;
+	int			i;
+
+	if (nrows > 0)
+	{
+		p = reallocarray(pgrtable, nrows, sizeof(struct top_proc_r));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		pgrtable = p;
+	}
+
+	proc_r_active = 0;
+	for (i = 0; i < nrows; i++)
+	{
+		r = &rows[i];
+		if ((!sel->idle && r->pgstate == STATE_IDLE) ||
+			(sel->usename[0] != '\0' && strcmp(r->usename, sel->usename) != 0))
+			continue;
+
+		p = &pgrtable[proc_r_active++];
+		memset(p, 0, sizeof(struct top_proc_r));
+		p->pid = r->pid;
+		p->usename = r->usename;
+		p->name = r->name;
+		p->pgstate = r->pgstate;
+		p->size = r->size;
+		p->rss = r->rss;
+		p->xtime = r->xtime;
+		p->qtime = r->qtime;
+		p->locks = r->locks;
+		p->pcpu = r->pcpu;
+		p->samples = r->interval > 0 ? 2 : 1;
+		p->sampled[0] = r->interval;
+		p->rchar[0] = r->counter[PC_RCHAR];
+		p->wchar[0] = r->counter[PC_WCHAR];
+		p->syscr[0] = r->counter[PC_SYSCR];
+		p->syscw[0] = r->counter[PC_SYSCW];
+		p->read_bytes[0] = r->counter[PC_READ_BYTES];
+		p->write_bytes[0] = r->counter[PC_WRITE_BYTES];
+		p->cancelled_write_bytes[0] = r->counter[PC_CANCELLED_WRITE_BYTES];
+	}
+
+	si->p_active = proc_r_active;
+	if (compare_index >= 0 && proc_r_active > 0)
+		qsort(pgrtable, proc_r_active, sizeof(struct top_proc_r),
+			  proc_compares_r[compare_index]);
+
+	proc_r_index = 0;
+	return (caddr_t) 0;
+}
+
+/*
+ * The system information is sampled together with the processes, by
+ * get_process_info_r(), which is always called right after this.
+ */
+void
+get_system_info_r(struct system_info *info, struct pg_conninfo_ctx *conninfo)
+{
+	info->cpustates = cpu_states;
+	info->memory = memory_stats;
+	info->swap = swap_stats;
+}
+
+/*
+ * Fill in the system information from its row of a sample, where the
+ * functions that are installed gave it.
+ */
+static void
+update_system_info_r(struct system_info *info, PGresult *pgresult)
+{
+	int			known = PQresultStatus(pgresult) == PGRES_TUPLES_OK &&
+		PQntuples(pgresult) > 0;
+	int			i;
+
+	if (known && !PQgetisnull(pgresult, 0, c_load1))
 	{
 		info->load_avg[0] = atof(PQgetvalue(pgresult, 0, c_load1));
 		info->load_avg[1] = atof(PQgetvalue(pgresult, 0, c_load5));
@@ -779,19 +991,14 @@ get_system_info_r(struct system_info *info, struct pg_conninfo_ctx *conninfo)
 	}
 	else
 	{
-		info->load_avg[0] = 0;
-		info->load_avg[1] = 0;
-		info->load_avg[2] = 0;
-		info->last_pid = 0;
+		/* not known, and without pg_loadavg() there is no last pid at all */
+		info->load_avg[0] = -1;
+		info->load_avg[1] = -1;
+		info->load_avg[2] = -1;
+		info->last_pid = has_loadavg ? 0 : -1;
 	}
 
-	/* Get processor time info. */
-	if (conninfo->connection != NULL)
-	{
-		pgresult = PQexec(conninfo->connection, QUERY_CPUTIME);
-		rows = PQntuples(pgresult);
-	}
-	if (rows > 0)
+	if (known && !PQgetisnull(pgresult, 0, c_cpu_user))
 	{
 		cp_time[0] = atol(PQgetvalue(pgresult, 0, c_cpu_user));
 		cp_time[1] = atol(PQgetvalue(pgresult, 0, c_cpu_nice));
@@ -804,20 +1011,12 @@ get_system_info_r(struct system_info *info, struct pg_conninfo_ctx *conninfo)
 	}
 	else
 	{
-		cpu_states[0] = 0;
-		cpu_states[1] = 0;
-		cpu_states[2] = 0;
-		cpu_states[3] = 0;
-		cpu_states[4] = 0;
+		/* not known, shown as "-" */
+		for (i = 0; i < NCPUSTATES; i++)
+			cpu_states[i] = -1;
 	}
 
-	/* Get system wide memory usage. */
-	if (conninfo->connection != NULL)
-	{
-		pgresult = PQexec(conninfo->connection, QUERY_MEMUSAGE);
-		rows = PQntuples(pgresult);
-	}
-	if (rows > 0)
+	if (known && !PQgetisnull(pgresult, 0, c_memused))
 	{
 		memory_stats[MEMUSED] = atol(PQgetvalue(pgresult, 0, c_memused));
 		memory_stats[MEMFREE] = atol(PQgetvalue(pgresult, 0, c_memfree));
@@ -830,23 +1029,166 @@ get_system_info_r(struct system_info *info, struct pg_conninfo_ctx *conninfo)
 	}
 	else
 	{
-		memory_stats[MEMUSED] = 0;
-		memory_stats[MEMFREE] = 0;
-		memory_stats[MEMSHARED] = 0;
-		memory_stats[MEMBUFFERS] = 0;
-		memory_stats[MEMCACHED] = 0;
-		swap_stats[SWAPUSED] = 0;
-		swap_stats[SWAPFREE] = 0;
-		swap_stats[SWAPCACHED] = 0;
+		/* not known, shown as "-" */
+		for (i = 0; i < NMEMSTATS; i++)
+			memory_stats[i] = -1;
+		for (i = 0; i < NSWAPSTATS; i++)
+			swap_stats[i] = -1;
 	}
 
 	info->cpustates = cpu_states;
 	info->memory = memory_stats;
 	info->swap = swap_stats;
+}
 
-	if (pgresult != NULL)
-		PQclear(pgresult);
-	disconnect_from_db(conninfo);
+/*
+ * Whether name is a partition of disk: the disk's name followed by a number,
+ * as sda1, or by "p" and a number when the disk's name ends in one, as
+ * nvme0n1p1.  Another disk whose name only starts with it, as sdaa or
+ * nvme0n10, is not.
+ */
+static int
+is_partition(const char *name, const char *disk)
+{
+	size_t		len = strlen(disk);
+	const char *p = name + len;
+
+	if (len == 0 || strncmp(name, disk, len) != 0)
+		return 0;
+	if (isdigit((unsigned char) disk[len - 1]) && *p++ != 'p')
+		return 0;
+	if (*p == '\0')
+		return 0;
+	for (; *p != '\0'; p++)
+		if (!isdigit((unsigned char) *p))
+			return 0;
+	return 1;
+}
+
+/*
+ * Whether a device of pg_diskusage() is a whole disk, rather than a partition
+ * of one, which is named after its disk, or a loop or RAM device.
+ */
+static int
+is_whole_disk(PGresult *pgresult, int row)
+{
+	char	   *name = PQgetvalue(pgresult, row, c_devname);
+	int			rows = PQntuples(pgresult);
+	int			i;
+
+	if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0)
+		return 0;
+	for (i = 0; i < rows; i++)
+		if (i != row && is_partition(name, PQgetvalue(pgresult, i, c_devname)))
+			return 0;
+	return 1;
+}
+
+/*
+ * Add up the activity of the whole disks since their last samples, from the
+ * disks' row of a sample.
+ */
+static void
+update_disk_info_r(PGresult *pgresult, double now)
+{
+	struct disk_r *n,
+			   *p,
+			   *tmp;
+	int			rows = 0;
+	int			disks = 0;
+	double		seconds;
+	double		busy;
+	int			i;
+
+	++disk_sample;
+	disk_info.reads = 0;
+	disk_info.writes = 0;
+	disk_info.read_bytes = 0;
+	disk_info.write_bytes = 0;
+	disk_info.busy = -1;
+	disk_info.busiest = NULL;
+
+	if (PQresultStatus(pgresult) == PGRES_TUPLES_OK)
+		rows = PQntuples(pgresult);
+
+	for (i = 0; i < rows; i++)
+	{
+		if (!is_whole_disk(pgresult, i))
+			continue;
+
+		n = malloc(sizeof(struct disk_r));
+		if (n == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			exit(1);
+		}
+		memset(n, 0, sizeof(struct disk_r));
+		n->name = PQgetvalue(pgresult, i, c_devname);
+		p = RB_INSERT(pgdiskr, &head_disk_r, n);
+		if (p != NULL)
+		{
+			free(n);
+			n = p;
+		}
+		else
+		{
+			n->name = strdup(n->name);
+		}
+		n->index = (n->index + 1) % 2;
+		n->sample = disk_sample;
+		n->samples++;
+		n->sampled[n->index] = now;
+		n->reads[n->index] = atoll(PQgetvalue(pgresult, i, c_disk_reads));
+		n->sectors_read[n->index] =
+			atoll(PQgetvalue(pgresult, i, c_disk_sectors_read));
+		n->writes[n->index] = atoll(PQgetvalue(pgresult, i, c_disk_writes));
+		n->sectors_written[n->index] =
+			atoll(PQgetvalue(pgresult, i, c_disk_sectors_written));
+		n->iotime[n->index] = atoll(PQgetvalue(pgresult, i, c_disk_iotime));
+
+		if (n->samples < 2)
+			continue;
+		seconds = n->sampled[n->index] - n->sampled[(n->index + 1) % 2];
+		if (seconds <= 0)
+			continue;
+		disks++;
+
+		/* sectors are 512 bytes, whatever the size of the disk's blocks */
+		disk_info.reads += rate_stat(n->reads, n->index, seconds);
+		disk_info.writes += rate_stat(n->writes, n->index, seconds);
+		disk_info.read_bytes +=
+			rate_stat(n->sectors_read, n->index, seconds) * 512;
+		disk_info.write_bytes +=
+			rate_stat(n->sectors_written, n->index, seconds) * 512;
+
+		busy = rate_stat(n->iotime, n->index, seconds) / 10;
+		if (busy > 100)
+			busy = 100;
+		if (busy > disk_info.busy)
+		{
+			disk_info.busy = busy;
+			disk_info.busiest = n->name;
+		}
+	}
+
+	/* forget the disks that went away */
+	RB_FOREACH_SAFE(n, pgdiskr, &head_disk_r, tmp)
+	{
+		if (n->sample != disk_sample)
+		{
+			RB_REMOVE(pgdiskr, &head_disk_r, n);
+			free(n->name);
+			free(n);
+		}
+	}
+
+	if (disks == 0)
+	{
+		disk_info.reads = -1;
+		disk_info.writes = -1;
+		disk_info.read_bytes = -1;
+		disk_info.write_bytes = -1;
+	}
 }
 
 caddr_t
@@ -855,11 +1197,12 @@ get_process_info_r(struct system_info *si, struct process_select *sel,
 {
 	int			i;
 
+	PGresult   *results[r_count];
 	PGresult   *pgresult = NULL;
 	int			rows;
 
-	struct timeval thistime;
-	double		timediff;
+	double		now;
+	double		seconds;
 
 	int			active_procs = 0;
 	int			total_procs = 0;
@@ -867,49 +1210,38 @@ get_process_info_r(struct system_info *si, struct process_select *sel,
 	int			show_idle = sel->idle;
 
 	struct top_proc_r *n,
-			   *p;
+			   *p,
+			   *tmp;
 
 	memset(process_states, 0, sizeof(process_states));
-
-	/* Calculate the time difference since our last check. */
-	gettimeofday(&thistime, 0);
-	if (lasttime.tv_sec)
-	{
-		timediff = ((thistime.tv_sec - lasttime.tv_sec) +
-					(thistime.tv_usec - lasttime.tv_usec) * 1e-6);
-	}
-	else
-	{
-		timediff = 0;
-	}
-	lasttime = thistime;
-
-	timediff *= HZ;				/* Convert to ticks. */
+	++proc_r_sample;
 
 	connect_to_db(conninfo);
 	if (conninfo->connection != NULL)
 	{
-		switch (mode)
+		pg_timed_results(conninfo->connection, system_query, system_results,
+						 results);
+		now = sample_time();
+		update_system_info_r(si, results[r_system]);
+		PQclear(results[r_system]);
+		if (has_diskusage)
 		{
-			case MODE_REPLICATION:
-				pgresult = pg_replication(conninfo->connection);
-				break;
-			default:
-				if (sel->fullcmd == 2)
-				{
-					pgresult = PQexec(conninfo->connection, QUERY_PROCTAB_QUERY);
-				}
-				else
-				{
-					pgresult = PQexec(conninfo->connection, QUERY_PROCTAB);
-				}
+			update_disk_info_r(results[r_diskusage], now);
+			PQclear(results[r_diskusage]);
 		}
+		pgresult = pg_sample(conninfo->connection, sel->fullcmd == 2 ?
+							 sample_query_query : sample_query);
 		rows = PQntuples(pgresult);
 	}
 	else
 	{
+		now = sample_time();
+		update_system_info_r(si, NULL);
+		if (has_diskusage)
+			update_disk_info_r(NULL, now);
 		rows = 0;
 	}
+	si->disk = has_diskusage ? &disk_info : NULL;
 
 	if (rows > 0)
 	{
@@ -928,7 +1260,7 @@ get_process_info_r(struct system_info *si, struct process_select *sel,
 	for (i = 0; i < rows; i++)
 	{
 		unsigned long otime;
-		long long	value;
+		unsigned long start_time;
 
 		n = malloc(sizeof(struct top_proc_r));
 		if (n == NULL)
@@ -951,124 +1283,116 @@ get_process_info_r(struct system_info *si, struct process_select *sel,
 		{
 			n->time = 0;
 		}
+		n->sample = proc_r_sample;
+
+		/* a pid taken by a new process starts over */
+		start_time = (unsigned long)
+			atol(PQgetvalue(pgresult, i, c_starttime));
+		if (n->samples > 0 && n->start_time != start_time)
+		{
+			n->samples = 0;
+			n->time = 0;
+		}
+		n->start_time = start_time;
 
 		otime = n->time;
 
-		switch (mode)
+		if (sel->fullcmd && PQgetvalue(pgresult, i, c_fullcomm))
+			update_str(&n->name, PQgetvalue(pgresult, i, c_fullcomm));
+		else
+			update_str(&n->name, PQgetvalue(pgresult, i, c_comm));
+
+		switch (PQgetvalue(pgresult, i, c_state)[0])
 		{
-			case MODE_REPLICATION:
-				update_str(&n->usename, PQgetvalue(pgresult, i, 1));
-				update_str(&n->application_name, PQgetvalue(pgresult, i, 2));
-				update_str(&n->client_addr, PQgetvalue(pgresult, i, 3));
-				update_str(&n->repstate, PQgetvalue(pgresult, i, 4));
-				update_str(&n->primary, PQgetvalue(pgresult, i, 5));
-				update_str(&n->sent, PQgetvalue(pgresult, i, 6));
-				update_str(&n->write, PQgetvalue(pgresult, i, 7));
-				update_str(&n->flush, PQgetvalue(pgresult, i, 8));
-				update_str(&n->replay, PQgetvalue(pgresult, i, 9));
-				n->sent_lag = atol(PQgetvalue(pgresult, i, 10));
-				n->write_lag = atol(PQgetvalue(pgresult, i, 11));
-				n->flush_lag = atol(PQgetvalue(pgresult, i, 12));
-				n->replay_lag = atol(PQgetvalue(pgresult, i, 13));
-
-				memcpy(&pgrtable[active_procs++], n, sizeof(struct top_proc_r));
+			case 'R':
+				n->state = 1;
+				break;
+			case 'S':
+				n->state = 2;
 				break;
-			default:
-				if (sel->fullcmd && PQgetvalue(pgresult, i, c_fullcomm))
-					update_str(&n->name, PQgetvalue(pgresult, i, c_fullcomm));
-				else
-					update_str(&n->name, PQgetvalue(pgresult, i, c_comm));
-
-				switch (PQgetvalue(pgresult, i, c_state)[0])
-				{
-					case 'R':
-						n->state = 1;
-						break;
-					case 'S':
-						n->state = 2;
-						break;
-					case 'D':
-						n->state = 3;
-						break;
-					case 'Z':
-						n->state = 4;
-						break;
-					case 'T':
-						n->state = 5;
-						break;
-					case 'W':
-						n->state = 6;
-						break;
-					case '\0':
-						continue;
-				}
-				update_state(&n->pgstate, PQgetvalue(pgresult, i, c_pgstate));
-
-				n->time = (unsigned long) atol(PQgetvalue(pgresult, i, c_utime));
-				n->time += (unsigned long) atol(PQgetvalue(pgresult, i, c_stime));
-				n->start_time = (unsigned long)
-					atol(PQgetvalue(pgresult, i, c_starttime));
-				n->size = bytetok((unsigned long)
-								  atol(PQgetvalue(pgresult, i, c_vsize)));
-				n->rss = bytetok((unsigned long)
-								 atol(PQgetvalue(pgresult, i, c_rss)));
-
-				update_str(&n->usename, PQgetvalue(pgresult, i, c_username));
-
-				n->xtime = atol(PQgetvalue(pgresult, i, c_xtime));
-				n->qtime = atol(PQgetvalue(pgresult, i, c_qtime));
-
-				n->locks = atol(PQgetvalue(pgresult, i, c_locks));
-
-				value = atoll(PQgetvalue(pgresult, i, c_rchar));
-				n->rchar_diff = value - n->rchar;
-				n->rchar = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_wchar));
-				n->wchar_diff = value - n->wchar;
-				n->wchar = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_syscr));
-				n->syscr_diff = value - n->syscr;
-				n->syscr = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_syscw));
-				n->syscw_diff = value - n->syscw;
-				n->syscw = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_reads));
-				n->read_bytes_diff = value - n->read_bytes;
-				n->read_bytes = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_writes));
-				n->write_bytes_diff = value - n->write_bytes;
-				n->write_bytes = value;
-
-				value = atoll(PQgetvalue(pgresult, i, c_cwrites));
-				n->cancelled_write_bytes_diff = value - n->cancelled_write_bytes;
-				n->cancelled_write_bytes = value;
-
-				++total_procs;
-				++process_states[n->pgstate];
-
-				if (timediff > 0.0)
-				{
-					if ((n->pcpu = (n->time - otime) / timediff) < 0.0001)
-						n->pcpu = 0;
-				}
-
-				if ((show_idle || n->pgstate != STATE_IDLE) &&
-					(sel->usename[0] == '\0' ||
-					 strcmp(n->usename, sel->usename) == 0))
-					memcpy(&pgrtable[active_procs++], n, sizeof(struct top_proc_r));
+			case 'D':
+				n->state = 3;
+				break;
+			case 'Z':
+				n->state = 4;
+				break;
+			case 'T':
+				n->state = 5;
+				break;
+			case 'W':
+				n->state = 6;
+				break;
+			case '\0':
+				continue;
 		}
+		update_state(&n->pgstate, PQgetvalue(pgresult, i, c_pgstate));
+
+		n->time = (unsigned long) atol(PQgetvalue(pgresult, i, c_utime));
+		n->time += (unsigned long) atol(PQgetvalue(pgresult, i, c_stime));
+		n->size = bytetok((unsigned long)
+						  atol(PQgetvalue(pgresult, i, c_vsize)));
+		n->rss = bytetok((unsigned long)
+						 atol(PQgetvalue(pgresult, i, c_rss)));
+
+		update_str(&n->usename, PQgetvalue(pgresult, i, c_username));
+
+		n->xtime = atol(PQgetvalue(pgresult, i, c_xtime));
+		n->qtime = atol(PQgetvalue(pgresult, i, c_qtime));
+
+		n->locks = atol(PQgetvalue(pgresult, i, c_locks));
+
+		n->index = (n->index + 1) % 2;
+		n->samples++;
+		n->sampled[n->index] = now;
+		n->rchar[n->index] = atoll(PQgetvalue(pgresult, i, c_rchar));
+		n->wchar[n->index] = atoll(PQgetvalue(pgresult, i, c_wchar));
+		n->syscr[n->index] = atoll(PQgetvalue(pgresult, i, c_syscr));
+		n->syscw[n->index] = atoll(PQgetvalue(pgresult, i, c_syscw));
+		n->read_bytes[n->index] = atoll(PQgetvalue(pgresult, i, c_reads));
+		n->write_bytes[n->index] = atoll(PQgetvalue(pgresult, i, c_writes));
+		n->cancelled_write_bytes[n->index] =
+			atoll(PQgetvalue(pgresult, i, c_cwrites));
+
+		++total_procs;
+		++process_states[n->pgstate];
+
+		/* a process seen for the first time has no rates yet */
+		seconds = n->samples > 1 ?
+			n->sampled[n->index] - n->sampled[(n->index + 1) % 2] : 0;
+		if (seconds > 0.0)
+		{
+			if ((n->pcpu = (n->time - otime) / (seconds * HZ)) < 0.0001)
+				n->pcpu = 0;
+		}
+		else
+			n->pcpu = 0;
+
+		if (mode == MODE_IO_STATS && n->samples < 2)
+			continue;
+
+		if ((show_idle || n->pgstate != STATE_IDLE) &&
+			(sel->usename[0] == '\0' ||
+			 strcmp(n->usename, sel->usename) == 0))
+			memcpy(&pgrtable[active_procs++], n, sizeof(struct top_proc_r));
 	}
 
 	if (pgresult != NULL)
 		PQclear(pgresult);
 	disconnect_from_db(conninfo);
 
-	si->p_active = active_procs;
+	/* forget the processes that went away */
+	RB_FOREACH_SAFE(n, pgprocr, &head_proc_r, tmp)
+	{
+		if (n->sample != proc_r_sample)
+		{
+			RB_REMOVE(pgprocr, &head_proc_r, n);
+			free(n->name);
+			free(n->usename);
+			free(n);
+		}
+	}
+
+	si->p_active = proc_r_active = active_procs;
 	si->p_total = total_procs;
 	si->procstates = process_states;
 
@@ -1085,7 +1409,10 @@ get_process_info_r(struct system_info *si, struct process_select *sel,
 int
 machine_init_r(struct statics *statics, struct pg_conninfo_ctx *conninfo)
 {
-	/* Make sure the remote system has the stored function installed. */
+	/*
+	 * Find out which of the stored functions the remote system has installed
+	 * and can be run.  What the others would show is left out.
+	 */
 	connect_to_db(conninfo);
 	if (conninfo->connection == NULL)
 	{
@@ -1093,15 +1420,22 @@ machine_init_r(struct statics *statics, struct pg_conninfo_ctx *conninfo)
 		return -1;
 	}
 
-	if (check_for_function(conninfo->connection, "pg_cputime") != 0)
-		return -1;
-	if (check_for_function(conninfo->connection, "pg_loadavg") != 0)
-		return -1;
-	if (check_for_function(conninfo->connection, "pg_memusage") != 0)
-		return -1;
-	if (check_for_function(conninfo->connection, "pg_proctab") != 0)
+	if ((has_cputime = check_for_function(conninfo->connection,
+										  "pg_cputime")) == -1 ||
+		(has_diskusage = check_for_function(conninfo->connection,
+											"pg_diskusage")) == -1 ||
+		(has_loadavg = check_for_function(conninfo->connection,
+										  "pg_loadavg")) == -1 ||
+		(has_memusage = check_for_function(conninfo->connection,
+										   "pg_memusage")) == -1 ||
+		(has_proctab = check_for_function(conninfo->connection,
+										  "pg_proctab")) == -1)
+	{
+		disconnect_from_db(conninfo);
 		return -1;
+	}
 	disconnect_from_db(conninfo);
+	build_sample_queries();
 
 	/* fill in the statics information */
 	statics->procstate_names = procstatenames;
@@ -1112,10 +1446,17 @@ machine_init_r(struct statics *statics, struct pg_conninfo_ctx *conninfo)
 	statics->boottime = boottime;
 	statics->flags.fullcmds = 1;
 	statics->flags.warmup = 1;
+	statics->flags.diskstats = has_diskusage;
 
 	return 0;
 }
 
+int
+diskrcmp(struct disk_r *e1, struct disk_r *e2)
+{
+	return strcmp(e1->name, e2->name);
+}
+
 int
 topprocrcmp(struct top_proc_r *e1, struct top_proc_r *e2)
 {
@@ -0,0 +1,252 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Streaming output: instead of the screen, every sample is written as one
+ * record per backend, either a JSON object a line (JSON Lines) or a row of
+ * comma separated values with a header row first.  Numbers are written as
+ * numbers, in the units named by their fields, and every record starts with
+ * the time of its sample, so that nothing has to be parsed back out of the
+ * columns of the display.
+ *
+ * A record is built in one buffer that is kept from one record to the next,
+ * and written out whole, so that a sample of thousands of backends costs no
+ * more than the formatting of their fields.
+ */
+
+#include "os.h"
+#include <math.h>
+#include <sys/time.h>
+#include <bsd/stdlib.h>
+
+#include "output.h"
+#include "utils.h"
+
+static int	format = OUTPUT_TEXT;
+
+/* the record being built, and the CSV header built along with the first */
+static char *buffer;
+static size_t used;
+static size_t size;
+static char *header;
+static size_t header_used;
+static size_t header_size;
+static int	header_done;
+
+/* how many fields of the record being built there are so far */
+static int	fields;
+
+/* the time of the sample, at the start of every record */
+static char sample_time[32];
+
+static char *format_names[] = {"text", "jsonl", "csv", NULL};
+
+static void
+grow(char **b, size_t *bsize, size_t need)
+{
+	char	   *a;
+	size_t		n = *bsize == 0 ? 4096 : *bsize;
+
+	while (n < need)
+		n *= 2;
+	a = reallocarray(*b, n, sizeof(char));
+	if (a == NULL)
+	{
+		fprintf(stderr, "reallocarray error\n");
+		exit(1);
+	}
+	*b = a;
+	*bsize = n;
+}
+
+static void
+append(char *s, size_t len)
+{
+	if (used + len > size)
+		grow(&buffer, &size, used + len);
+	memcpy(buffer + used, s, len);
+	used += len;
+}
+
+static void
+append_char(char c)
+{
+	if (used == size)
+		grow(&buffer, &size, used + 1);
+	buffer[used++] = c;
+}
+
+/* write a string as JSON, or as a CSV field quoted when it has to be */
+static void
+append_quoted(char *s)
+{
+	char		escape[8];
+	unsigned char c;
+
+	if (format == OUTPUT_CSV)
+	{
+		if (strpbrk(s, ",\"\r\n") == NULL)
+		{
+			append(s, strlen(s));
+			return;
+		}
+		append_char('"');
+		for (; *s != '\0'; s++)
+		{
+			if (*s == '"')
+				append_char('"');
+			append_char(*s);
+		}
+		append_char('"');
+		return;
+	}
+
+	append_char('"');
+	for (; (c = *s) != '\0'; s++)
+	{
+		if (c == '"' || c == '\\')
+		{
+			append_char('\\');
+			append_char(c);
+		}
+		else if (c < 0x20)
+		{
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			append(escape, 6);
+		}
+		else
+			append_char(c);
+	}
+	append_char('"');
+}
+
+/* start the next field, remembering its name for the CSV header */
+static void
+field(char *name)
+{
+	size_t		len;
+
+	if (format == OUTPUT_CSV)
+	{
+		if (fields > 0)
+			append_char(',');
+		if (!header_done)
+		{
+			len = strlen(name);
+			if (header_used + len + 2 > header_size)
+				grow(&header, &header_size, header_used + len + 2);
+			if (header_used > 0)
+				header[header_used++] = ',';
+			memcpy(header + header_used, name, len);
+			header_used += len;
+		}
+	}
+	else
+	{
+		append_char(fields > 0 ? ',' : '{');
+		append_quoted(name);
+		append_char(':');
+	}
+	fields++;
+}
+
+/*
+ * Set the format named, returning it, or -1 when there is no such format.
+ */
+int
+output_init(char *name)
+{
+	int			i;
+
+	if ((i = string_index(name, format_names)) == -1)
+		return -1;
+	format = i;
+	return format;
+}
+
+/*
+ * Start a sample: the records that follow are stamped with the time now, in
+ * UTC to the millisecond.
+ */
+void
+output_begin(void)
+{
+	struct timeval now;
+	struct tm	tm;
+	size_t		len;
+
+	gettimeofday(&now, NULL);
+	gmtime_r(&now.tv_sec, &tm);
+	len = strftime(sample_time, sizeof(sample_time), "%Y-%m-%dT%H:%M:%S",
+				   &tm);
+	snprintf(sample_time + len, sizeof(sample_time) - len, ".%03dZ",
+			 (int) (now.tv_usec / 1000));
+}
+
+void
+output_record(void)
+{
+	used = 0;
+	fields = 0;
+	output_string("time", sample_time);
+}
+
+void
+output_string(char *name, char *value)
+{
+	field(name);
+	append_quoted(value);
+}
+
+void
+output_long(char *name, long long value)
+{
+	char		number[24];
+
+	field(name);
+	append(number, snprintf(number, sizeof(number), "%lld", value));
+}
+
+void
+output_double(char *name, double value)
+{
+	char		number[32];
+
+	if (!isfinite(value))
+	{
+		output_null(name);
+		return;
+	}
+	field(name);
+	append(number, snprintf(number, sizeof(number), "%.2f", value));
+}
+
+/* a field with no value: null in JSON, empty in CSV */
+void
+output_null(char *name)
+{
+	field(name);
+	if (format != OUTPUT_CSV)
+		append("null", 4);
+}
+
+/*
+ * Finish the record and write it, after the header row when it is the first
+ * CSV record.
+ */
+void
+output_end(void)
+{
+	if (format == OUTPUT_CSV)
+	{
+		if (!header_done)
+		{
+			header[header_used] = '\n';
+			fwrite(header, 1, header_used + 1, stdout);
+			header_done = 1;
+		}
+	}
+	else
+		append_char('}');
+	append_char('\n');
+	fwrite(buffer, 1, used, stdout);
+}
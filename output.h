@@ -0,0 +1,23 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+/* what --format writes */
+enum OutputFormat
+{
+	OUTPUT_TEXT = 0,
+	OUTPUT_JSONL,
+	OUTPUT_CSV
+};
+
+int			output_init(char *);
+void		output_begin(void);
+void		output_record(void);
+void		output_string(char *, char *);
+void		output_long(char *, long long);
+void		output_double(char *, double);
+void		output_null(char *);
+void		output_end(void);
+
+#endif							/* _OUTPUT_H_ */
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <strings.h>
 
+#include "delta.h"
 #include "display.h"
 #include "pg.h"
 #include "pg_top.h"
@@ -21,7 +22,26 @@
 		"                              xact_start))::BIGINT,\n" \
 		"       extract(EPOCH FROM age(clock_timestamp(),\n" \
 		"                              query_start))::BIGINT,\n" \
-		"       coalesce(lock_count, 0) AS lock_count\n" \
+		"       coalesce(lock_count, 0) AS lock_count,\n" \
+		"       backend_type\n" \
+		"FROM pg_stat_activity a LEFT OUTER JOIN lock_activity b\n" \
+		"  ON a.pid = b.pid;"
+
+#define QUERY_PROCESSES_9_6 \
+		"WITH lock_activity AS\n" \
+		"(\n" \
+		"     SELECT pid, count(*) AS lock_count\n" \
+		"     FROM pg_locks\n" \
+		"     WHERE relation IS NOT NULL\n" \
+		"     GROUP BY pid\n" \
+		")\n" \
+		"SELECT a.pid, query, state, usename,\n" \
+		"       extract(EPOCH FROM age(clock_timestamp(),\n" \
+		"                              xact_start))::BIGINT,\n" \
+		"       extract(EPOCH FROM age(clock_timestamp(),\n" \
+		"                              query_start))::BIGINT,\n" \
+		"       coalesce(lock_count, 0) AS lock_count,\n" \
+		"       'client backend' AS backend_type\n" \
 		"FROM pg_stat_activity a LEFT OUTER JOIN lock_activity b\n" \
 		"  ON a.pid = b.pid;"
 
@@ -39,35 +59,250 @@
 		"FROM pg_stat_activity\n" \
 		"WHERE procpid = %d;"
 
+/*
+ * The positions in WAL of each standby and of the server they replicate from,
+ * which is the position replayed up to when that server is itself a standby,
+ * and from 10 how long ago the WAL was written that each standby has written,
+ * flushed and replayed.
+ */
 #define REPLICATION \
 		"SELECT pid, usename, application_name, client_addr, state,\n" \
-		"       pg_current_wal_insert_lsn() AS primary,\n" \
-		"       sent_lsn, write_lsn, flush_lsn,\n" \
-		"       replay_lsn, \n" \
-		"       pg_wal_lsn_diff(pg_current_wal_insert_lsn(),\n" \
-		"                       sent_lsn) as sent_lag,\n" \
-		"       pg_wal_lsn_diff(pg_current_wal_insert_lsn(),\n" \
-		"                       write_lsn) as write_lag,\n" \
-		"       pg_wal_lsn_diff(pg_current_wal_insert_lsn(),\n" \
-		"                       flush_lsn) as flush_lag,\n" \
-		"       pg_wal_lsn_diff(pg_current_wal_insert_lsn(),\n" \
-		"                       replay_lsn) as replay_lag\n" \
-		"       FROM pg_stat_replication;"
+		"       CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()\n" \
+		"            ELSE pg_current_wal_insert_lsn() END,\n" \
+		"       sent_lsn, write_lsn, flush_lsn, replay_lsn,\n" \
+		"       extract(EPOCH FROM write_lag),\n" \
+		"       extract(EPOCH FROM flush_lag),\n" \
+		"       extract(EPOCH FROM replay_lag)\n" \
+		"FROM pg_stat_replication;"
 
 #define REPLICATION_9_6 \
 		"SELECT pid, usename, application_name, client_addr, state,\n" \
-		"       pg_current_xlog_insert_location() AS primary,\n" \
+		"       CASE WHEN pg_is_in_recovery()\n" \
+		"            THEN pg_last_xlog_replay_location()\n" \
+		"            ELSE pg_current_xlog_insert_location() END,\n" \
 		"       sent_location, write_location, flush_location,\n" \
-		"       replay_location, \n" \
-		"       pg_xlog_location_diff(pg_current_xlog_insert_location(),\n" \
-		"                             sent_location) as sent_lag,\n" \
-		"       pg_xlog_location_diff(pg_current_xlog_insert_location(),\n" \
-		"                             write_location) as write_lag,\n" \
-		"       pg_xlog_location_diff(pg_current_xlog_insert_location(),\n" \
-		"                             flush_location) as flush_lag,\n" \
-		"       pg_xlog_location_diff(pg_current_xlog_insert_location(),\n" \
-		"                             replay_location) as replay_lag\n" \
-		"       FROM pg_stat_replication;"
+		"       replay_location, NULL, NULL, NULL\n" \
+		"FROM pg_stat_replication;"
+
+/*
+ * What a standby is doing: the state of its WAL receiver and where it
+ * receives WAL from, the positions in WAL received and replayed up to, how
+ * long ago the last transaction replayed was committed on the primary, and
+ * the queries cancelled because of conflicts with recovery.  The fragments
+ * chosen for the server's version fill in STANDBY.
+ */
+#define STANDBY \
+		"SELECT pg_is_in_recovery(),\n" \
+		"       %s,\n" \
+		"       %s,\n" \
+		"       extract(EPOCH FROM now() - pg_last_xact_replay_timestamp()),\n" \
+		"       c.*\n" \
+		"FROM (SELECT sum(confl_tablespace), sum(confl_lock),\n" \
+		"             sum(confl_snapshot), sum(confl_bufferpin),\n" \
+		"             sum(confl_deadlock), %s\n" \
+		"      FROM pg_stat_database_conflicts) c%s;"
+
+#define STANDBY_RECEIVER "r.status, r.sender_host, r.sender_port, r.slot_name"
+#define STANDBY_RECEIVER_10 "r.status, NULL, NULL, r.slot_name"
+#define STANDBY_RECEIVER_9_5 "NULL, NULL, NULL, NULL"
+
+#define STANDBY_LSN \
+		"pg_wal_lsn_diff(pg_last_wal_receive_lsn(), '0/0'),\n" \
+		"       pg_wal_lsn_diff(pg_last_wal_replay_lsn(), '0/0')"
+#define STANDBY_LSN_9_6 \
+		"pg_xlog_location_diff(pg_last_xlog_receive_location(), '0/0'),\n" \
+		"       pg_xlog_location_diff(pg_last_xlog_replay_location(), '0/0')"
+
+#define STANDBY_CONFLICTS "sum(confl_active_logicalslot)"
+#define STANDBY_CONFLICTS_15 "NULL"
+
+#define STANDBY_JOIN " LEFT OUTER JOIN pg_stat_wal_receiver r ON true"
+
+/*
+ * One row summing up a server for the fleet display: its client sessions and
+ * how many are active, the transactions it has committed and rolled back, the
+ * wait event the most active sessions are waiting on, the bytes of WAL the
+ * furthest behind standby has yet to replay, or a standby has received but not
+ * replayed, whether it is a standby, and the cpu time from pg_proctab's
+ * pg_cputime() where that is installed.  For the topology display, it also
+ * gives the position in WAL written, or replayed on a standby, and what a
+ * standby replicating from it may be known by: its cluster_name and the
+ * address it was connected to on.  FLEET_DOWNSTREAM follows with the standbys
+ * replicating from it.  The fragments chosen for the server's version fill in
+ * FLEET.
+ */
+#define FLEET \
+		"SELECT (SELECT count(*) FROM pg_stat_activity%s),\n" \
+		"       (SELECT count(*) FROM pg_stat_activity\n" \
+		"        WHERE state = 'active' AND pid <> pg_backend_pid()%s),\n" \
+		"       (SELECT sum(xact_commit + xact_rollback)\n" \
+		"        FROM pg_stat_database),\n" \
+		"       %s,\n" \
+		"       %s,\n" \
+		"       pg_is_in_recovery(),\n" \
+		"       %s,\n" \
+		"       (SELECT setting FROM pg_settings\n" \
+		"        WHERE name = 'cluster_name'),\n" \
+		"       host(inet_server_addr()), c.*\n" \
+		"FROM %s c;\n" \
+		"%s"
+
+#define FLEET_CLIENTS " WHERE backend_type = 'client backend'"
+#define FLEET_CLIENTS_AND " AND backend_type = 'client backend'"
+
+#define FLEET_WAIT \
+		"(SELECT wait_event_type || ':' || wait_event\n" \
+		"        FROM pg_stat_activity\n" \
+		"        WHERE state = 'active' AND wait_event IS NOT NULL\n" \
+		"        GROUP BY 1 ORDER BY count(*) DESC, 1 LIMIT 1)"
+#define FLEET_WAIT_9_5 \
+		"(SELECT 'Lock' FROM pg_stat_activity\n" \
+		"        WHERE state = 'active' AND waiting LIMIT 1)"
+
+#define FLEET_LAG \
+		"CASE WHEN pg_is_in_recovery()\n" \
+		"            THEN pg_wal_lsn_diff(pg_last_wal_receive_lsn(),\n" \
+		"                                 pg_last_wal_replay_lsn())\n" \
+		"            ELSE (SELECT max(pg_wal_lsn_diff(pg_current_wal_lsn(),\n" \
+		"                                             replay_lsn))\n" \
+		"                  FROM pg_stat_replication) END"
+#define FLEET_LAG_9_6 \
+		"CASE WHEN pg_is_in_recovery()\n" \
+		"            THEN pg_xlog_location_diff(pg_last_xlog_receive_location(),\n" \
+		"                                       pg_last_xlog_replay_location())\n" \
+		"            ELSE (SELECT max(pg_xlog_location_diff(\n" \
+		"                                 pg_current_xlog_location(),\n" \
+		"                                 replay_location))\n" \
+		"                  FROM pg_stat_replication) END"
+
+#define FLEET_POSITION \
+		"pg_wal_lsn_diff(CASE WHEN pg_is_in_recovery()\n" \
+		"                            THEN pg_last_wal_replay_lsn()\n" \
+		"                            ELSE pg_current_wal_lsn() END, '0/0')"
+#define FLEET_POSITION_9_6 \
+		"pg_xlog_location_diff(CASE WHEN pg_is_in_recovery()\n" \
+		"                            THEN pg_last_xlog_replay_location()\n" \
+		"                            ELSE pg_current_xlog_location() END, '0/0')"
+
+#define FLEET_CPUTIME \
+		"(SELECT \"user\" + nice + system,\n" \
+		"             \"user\" + nice + system + idle + iowait\n" \
+		"      FROM pg_cputime())"
+#define FLEET_NO_CPUTIME "(SELECT NULL, NULL)"
+
+/*
+ * How far behind each standby is, as seen from the server it replicates from,
+ * and from 10 how long ago the WAL was written that it has just replayed.
+ */
+#define FLEET_DOWNSTREAM \
+		"SELECT application_name, host(client_addr), state,\n" \
+		"       pg_wal_lsn_diff(CASE WHEN pg_is_in_recovery()\n" \
+		"                            THEN pg_last_wal_replay_lsn()\n" \
+		"                            ELSE pg_current_wal_lsn() END,\n" \
+		"                       replay_lsn),\n" \
+		"       pg_wal_lsn_diff(replay_lsn, '0/0'),\n" \
+		"       extract(EPOCH FROM replay_lag)\n" \
+		"FROM pg_stat_replication;"
+
+#define FLEET_DOWNSTREAM_9_6 \
+		"SELECT application_name, host(client_addr), state,\n" \
+		"       pg_xlog_location_diff(CASE WHEN pg_is_in_recovery()\n" \
+		"                            THEN pg_last_xlog_replay_location()\n" \
+		"                            ELSE pg_current_xlog_location() END,\n" \
+		"                             replay_location),\n" \
+		"       pg_xlog_location_diff(replay_location, '0/0'),\n" \
+		"       NULL\n" \
+		"FROM pg_stat_replication;"
+
+#define FLEET_PROBE \
+		"SELECT count(*)\n" \
+		"FROM pg_catalog.pg_proc\n" \
+		"WHERE proname = 'pg_cputime';"
+
+/*
+ * pgbouncer's admin console, the pgbouncer database of a pgbouncer, only
+ * answers its own SHOW commands.  The columns they give change between
+ * releases of pgbouncer, so they are looked up by name.
+ */
+#define PGBOUNCER_POOLS "SHOW POOLS;"
+#define PGBOUNCER_STATS "SHOW STATS;"
+#define PGBOUNCER_CLIENTS "SHOW CLIENTS;"
+
+/*
+ * Replication slots: how far behind the current position in WAL, or the
+ * position replayed up to on a standby, each slot's restart_lsn and
+ * confirmed_flush_lsn are.  wal_status and safe_wal_size came in 13, and the
+ * bytes logical decoding spilled to disk and streamed in 14.
+ */
+#define SLOTS \
+		"SELECT s.slot_name, s.slot_type, s.active_pid,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.restart_lsn),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.confirmed_flush_lsn),\n" \
+		"       s.wal_status, s.safe_wal_size, t.spill_bytes, t.stream_bytes\n" \
+		"FROM pg_replication_slots s\n" \
+		"     LEFT JOIN pg_stat_replication_slots t\n" \
+		"               ON t.slot_name = s.slot_name\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_wal_replay_lsn()\n" \
+		"                             ELSE pg_current_wal_lsn() END AS lsn) l;"
+
+#define SLOTS_13 \
+		"SELECT s.slot_name, s.slot_type, s.active_pid,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.restart_lsn),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.confirmed_flush_lsn),\n" \
+		"       s.wal_status, s.safe_wal_size, NULL, NULL\n" \
+		"FROM pg_replication_slots s\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_wal_replay_lsn()\n" \
+		"                             ELSE pg_current_wal_lsn() END AS lsn) l;"
+
+#define SLOTS_12 \
+		"SELECT s.slot_name, s.slot_type, s.active_pid,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.restart_lsn),\n" \
+		"       pg_wal_lsn_diff(l.lsn, s.confirmed_flush_lsn),\n" \
+		"       '', NULL, NULL, NULL\n" \
+		"FROM pg_replication_slots s\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_wal_replay_lsn()\n" \
+		"                             ELSE pg_current_wal_lsn() END AS lsn) l;"
+
+#define SLOTS_9_6 \
+		"SELECT s.slot_name, s.slot_type, s.active_pid,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_xlog_location_diff(l.lsn, s.restart_lsn),\n" \
+		"       pg_xlog_location_diff(l.lsn, s.confirmed_flush_lsn),\n" \
+		"       '', NULL, NULL, NULL\n" \
+		"FROM pg_replication_slots s\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_xlog_replay_location()\n" \
+		"                             ELSE pg_current_xlog_location() END\n" \
+		"                 AS lsn) l;"
+
+#define SLOTS_9_5 \
+		"SELECT s.slot_name, s.slot_type, s.active_pid,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_xlog_location_diff(l.lsn, s.restart_lsn),\n" \
+		"       NULL, '', NULL, NULL, NULL\n" \
+		"FROM pg_replication_slots s\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_xlog_replay_location()\n" \
+		"                             ELSE pg_current_xlog_location() END\n" \
+		"                 AS lsn) l;"
+
+/* 9.4 does not say which process uses a slot */
+#define SLOTS_9_4 \
+		"SELECT s.slot_name, s.slot_type, NULL,\n" \
+		"       coalesce(s.database, ''),\n" \
+		"       pg_xlog_location_diff(l.lsn, s.restart_lsn),\n" \
+		"       NULL, '', NULL, NULL, NULL\n" \
+		"FROM pg_replication_slots s\n" \
+		"     CROSS JOIN (SELECT CASE WHEN pg_is_in_recovery()\n" \
+		"                             THEN pg_last_xlog_replay_location()\n" \
+		"                             ELSE pg_current_xlog_location() END\n" \
+		"                 AS lsn) l;"
 
 #define GET_LOCKS \
 		"SELECT datname, nspname, r.relname, i.relname, mode, granted\n" \
@@ -99,7 +334,388 @@
 		"  AND procpid = pid\n" \
 		"  AND relation IS NOT NULL;"
 
+/*
+ * The sessions waiting on a lock and the sessions blocking them, followed by
+ * the number of granted and waiting locks by mode, all from one read of
+ * pg_locks.
+ */
+#define BLOCKING \
+		"WITH l AS\n" \
+		"(\n" \
+		"     SELECT pid, locktype, relation, mode, granted, waitstart\n" \
+		"     FROM pg_locks\n" \
+		"),\n" \
+		"w AS\n" \
+		"(\n" \
+		"     SELECT DISTINCT ON (pid) pid, locktype, relation, mode,\n" \
+		"            extract(EPOCH FROM clock_timestamp() - waitstart) AS wait,\n" \
+		"            pg_blocking_pids(pid) AS blockers\n" \
+		"     FROM l\n" \
+		"     WHERE NOT granted\n" \
+		"     ORDER BY pid\n" \
+		"),\n" \
+		"p AS\n" \
+		"(\n" \
+		"     SELECT pid FROM w\n" \
+		"     UNION\n" \
+		"     SELECT unnest(blockers) FROM w\n" \
+		")\n" \
+		"SELECT p.pid, w.blockers, w.wait, w.mode,\n" \
+		"       CASE WHEN w.relation IS NOT NULL\n" \
+		"            THEN w.relation::REGCLASS::TEXT\n" \
+		"            ELSE w.locktype END,\n" \
+		"       a.state, a.query, NULL::BIGINT, NULL::BIGINT\n" \
+		"FROM p LEFT OUTER JOIN w USING (pid)\n" \
+		"     LEFT OUTER JOIN pg_stat_activity a USING (pid)\n" \
+		"UNION ALL\n" \
+		"SELECT NULL, NULL, NULL, mode, NULL, NULL, NULL,\n" \
+		"       sum(CASE WHEN granted THEN 1 ELSE 0 END),\n" \
+		"       sum(CASE WHEN granted THEN 0 ELSE 1 END)\n" \
+		"FROM l\n" \
+		"GROUP BY mode;"
+
+#define BLOCKING_13 \
+		"WITH l AS\n" \
+		"(\n" \
+		"     SELECT pid, locktype, relation, mode, granted\n" \
+		"     FROM pg_locks\n" \
+		"),\n" \
+		"w AS\n" \
+		"(\n" \
+		"     SELECT DISTINCT ON (pid) pid, locktype, relation, mode,\n" \
+		"            NULL::DOUBLE PRECISION AS wait,\n" \
+		"            pg_blocking_pids(pid) AS blockers\n" \
+		"     FROM l\n" \
+		"     WHERE NOT granted\n" \
+		"     ORDER BY pid\n" \
+		"),\n" \
+		"p AS\n" \
+		"(\n" \
+		"     SELECT pid FROM w\n" \
+		"     UNION\n" \
+		"     SELECT unnest(blockers) FROM w\n" \
+		")\n" \
+		"SELECT p.pid, w.blockers, w.wait, w.mode,\n" \
+		"       CASE WHEN w.relation IS NOT NULL\n" \
+		"            THEN w.relation::REGCLASS::TEXT\n" \
+		"            ELSE w.locktype END,\n" \
+		"       a.state, a.query, NULL::BIGINT, NULL::BIGINT\n" \
+		"FROM p LEFT OUTER JOIN w USING (pid)\n" \
+		"     LEFT OUTER JOIN pg_stat_activity a USING (pid)\n" \
+		"UNION ALL\n" \
+		"SELECT NULL, NULL, NULL, mode, NULL, NULL, NULL,\n" \
+		"       sum(CASE WHEN granted THEN 1 ELSE 0 END),\n" \
+		"       sum(CASE WHEN granted THEN 0 ELSE 1 END)\n" \
+		"FROM l\n" \
+		"GROUP BY mode;"
+
+/*
+ * Progress of long running commands, one view at a time, in the same shape:
+ * pid, command, phase, relation, amount done, total amount and whether the
+ * amount is in bytes or tuples.  Blocks are turned into bytes.
+ */
+#define BLOCK_BYTES "current_setting('block_size')::BIGINT"
+
+#define PROGRESS_VACUUM \
+		"SELECT pid, 'VACUUM'::TEXT, phase, relid::REGCLASS::TEXT,\n" \
+		"       CASE phase WHEN 'vacuuming heap' THEN heap_blks_vacuumed\n" \
+		"                  ELSE heap_blks_scanned END * " BLOCK_BYTES ",\n" \
+		"       heap_blks_total * " BLOCK_BYTES ", 'bytes'::TEXT\n" \
+		"FROM pg_stat_progress_vacuum\n"
+
+#define PROGRESS_CLUSTER \
+		"SELECT pid, command, phase, relid::REGCLASS::TEXT,\n" \
+		"       heap_blks_scanned * " BLOCK_BYTES ",\n" \
+		"       heap_blks_total * " BLOCK_BYTES ", 'bytes'\n" \
+		"FROM pg_stat_progress_cluster\n"
+
+#define PROGRESS_CREATE_INDEX \
+		"SELECT pid, command, phase, relid::REGCLASS::TEXT,\n" \
+		"       CASE WHEN blocks_total > 0\n" \
+		"            THEN blocks_done * " BLOCK_BYTES "\n" \
+		"            ELSE tuples_done END,\n" \
+		"       CASE WHEN blocks_total > 0\n" \
+		"            THEN blocks_total * " BLOCK_BYTES "\n" \
+		"            ELSE tuples_total END,\n" \
+		"       CASE WHEN blocks_total > 0 THEN 'bytes' ELSE 'tuples' END\n" \
+		"FROM pg_stat_progress_create_index\n"
+
+#define PROGRESS_ANALYZE \
+		"SELECT pid, 'ANALYZE'::TEXT, phase, relid::REGCLASS::TEXT,\n" \
+		"       sample_blks_scanned * " BLOCK_BYTES ",\n" \
+		"       sample_blks_total * " BLOCK_BYTES ", 'bytes'\n" \
+		"FROM pg_stat_progress_analyze\n"
+
+#define PROGRESS_BASEBACKUP \
+		"SELECT pid, 'BASE BACKUP'::TEXT, phase, NULL::TEXT,\n" \
+		"       backup_streamed, backup_total, 'bytes'\n" \
+		"FROM pg_stat_progress_basebackup\n"
+
+#define PROGRESS_COPY \
+		"SELECT pid, command, type, relid::REGCLASS::TEXT,\n" \
+		"       CASE WHEN bytes_total > 0 THEN bytes_processed\n" \
+		"            ELSE tuples_processed END,\n" \
+		"       CASE WHEN bytes_total > 0 THEN bytes_total END,\n" \
+		"       CASE WHEN bytes_total > 0 THEN 'bytes' ELSE 'tuples' END\n" \
+		"FROM pg_stat_progress_copy\n"
+
+#define PROGRESS_BEGIN \
+		"SELECT p.*,\n" \
+		"       extract(EPOCH FROM clock_timestamp() - a.query_start)\n" \
+		"FROM (\n"
+
+#define PROGRESS_END \
+		") AS p (pid, command, phase, relation, done, total, unit)\n" \
+		"LEFT OUTER JOIN pg_stat_activity a USING (pid);"
+
+#define ASH_SAMPLE \
+		"SELECT pid, wait_event_type, wait_event, query_id\n" \
+		"FROM pg_stat_activity\n" \
+		"WHERE state = 'active'\n" \
+		"  AND pid <> pg_backend_pid();"
+
+#define ASH_SAMPLE_13 \
+		"SELECT pid, wait_event_type, wait_event, NULL::BIGINT\n" \
+		"FROM pg_stat_activity\n" \
+		"WHERE state = 'active'\n" \
+		"  AND pid <> pg_backend_pid();"
+
+#define ASH_SAMPLE_9_5 \
+		"SELECT pid, CASE WHEN waiting THEN 'Lock' END, NULL, NULL::BIGINT\n" \
+		"FROM pg_stat_activity\n" \
+		"WHERE state = 'active'\n" \
+		"  AND pid <> pg_backend_pid();"
+
+#define ASH_QUERIES \
+		"SELECT DISTINCT ON (query_id) query_id, query\n" \
+		"FROM pg_stat_activity\n" \
+		"WHERE query_id IS NOT NULL\n" \
+		"  AND query_id <> 0;"
+
+#define RELATIONS \
+		"SELECT t.relid, t.schemaname, t.relname, t.seq_scan, t.seq_tup_read,\n" \
+		"       coalesce(t.idx_scan, 0), coalesce(t.idx_tup_fetch, 0),\n" \
+		"       t.n_tup_ins, t.n_tup_upd, t.n_tup_del,\n" \
+		"       coalesce(s.heap_blks_read, 0), coalesce(s.idx_blks_read, 0)\n" \
+		"FROM pg_stat_user_tables t, pg_statio_user_tables s\n" \
+		"WHERE t.relid = s.relid;"
+
+/*
+ * Counters of the statements in pg_stat_statements, summed by query id.  What
+ * changed since the last sample is worked out by pg_top.
+ */
+#define STATEMENTS \
+		"SELECT queryid, sum(calls)::BIGINT, sum(total_exec_time),\n" \
+		"       sum(rows)::BIGINT, sum(shared_blks_hit)::BIGINT,\n" \
+		"       sum(shared_blks_read)::BIGINT,\n" \
+		"       sum(temp_blks_read + temp_blks_written)::BIGINT\n" \
+		"FROM pg_stat_statements(false)\n" \
+		"WHERE queryid IS NOT NULL\n" \
+		"GROUP BY queryid;"
+
+#define STATEMENTS_12 \
+		"SELECT queryid, sum(calls)::BIGINT, sum(total_time),\n" \
+		"       sum(rows)::BIGINT, sum(shared_blks_hit)::BIGINT,\n" \
+		"       sum(shared_blks_read)::BIGINT,\n" \
+		"       sum(temp_blks_read + temp_blks_written)::BIGINT\n" \
+		"FROM pg_stat_statements(false)\n" \
+		"WHERE queryid IS NOT NULL\n" \
+		"GROUP BY queryid;"
+
+/*
+ * The calls of each statement last seen by a connection, kept on the server
+ * so that only the statements called since are transferred.
+ */
+#define STATEMENTS_TRACK \
+		"CREATE TEMPORARY TABLE IF NOT EXISTS pg_top_statements\n" \
+		"(queryid BIGINT PRIMARY KEY, calls BIGINT);"
+
+/*
+ * Counters of the statements called since the calls kept in
+ * pg_top_statements, which are brought up to date, and the query ids of
+ * those that are gone, with null counters.  Formatted with the column of the
+ * execution time.
+ */
+#define STATEMENTS_CHANGED \
+		"WITH s AS (SELECT queryid, sum(calls)::BIGINT AS calls,\n" \
+		"                  sum(%s) AS total_time,\n" \
+		"                  sum(rows)::BIGINT AS rows,\n" \
+		"                  sum(shared_blks_hit)::BIGINT AS shared_blks_hit,\n" \
+		"                  sum(shared_blks_read)::BIGINT AS shared_blks_read,\n" \
+		"                  sum(temp_blks_read + temp_blks_written)::BIGINT\n" \
+		"                      AS temp_blks\n" \
+		"           FROM pg_stat_statements(false)\n" \
+		"           WHERE queryid IS NOT NULL\n" \
+		"           GROUP BY queryid),\n" \
+		"     changed AS (SELECT s.*\n" \
+		"                 FROM s\n" \
+		"                      LEFT OUTER JOIN pg_temp.pg_top_statements p\n" \
+		"                      USING (queryid)\n" \
+		"                 WHERE s.calls IS DISTINCT FROM p.calls),\n" \
+		"     kept AS (INSERT INTO pg_temp.pg_top_statements\n" \
+		"              SELECT queryid, calls FROM changed\n" \
+		"              ON CONFLICT (queryid)\n" \
+		"              DO UPDATE SET calls = excluded.calls),\n" \
+		"     gone AS (DELETE FROM pg_temp.pg_top_statements p\n" \
+		"              WHERE NOT EXISTS (SELECT 1 FROM s\n" \
+		"                                WHERE s.queryid = p.queryid)\n" \
+		"              RETURNING p.queryid)\n" \
+		"SELECT queryid, calls, total_time, rows, shared_blks_hit,\n" \
+		"       shared_blks_read, temp_blks\n" \
+		"FROM changed\n" \
+		"UNION ALL\n" \
+		"SELECT queryid, NULL, NULL, NULL, NULL, NULL, NULL\n" \
+		"FROM gone;"
+
+#define STATEMENT_TEXTS \
+		"SELECT DISTINCT ON (queryid) queryid, query\n" \
+		"FROM pg_stat_statements\n" \
+		"WHERE queryid = ANY ($1::BIGINT[]);"
+
+#define DATABASE_STATS \
+		"SELECT sum(xact_commit), sum(xact_rollback), sum(tup_returned),\n" \
+		"       sum(tup_fetched),\n" \
+		"       sum(tup_inserted + tup_updated + tup_deleted),\n" \
+		"       sum(blks_hit), sum(blks_read), sum(temp_bytes),\n" \
+		"       sum(deadlocks)\n" \
+		"FROM pg_stat_database%s;"
+
+#define DATABASE_STATS_9_1 \
+		"SELECT sum(xact_commit), sum(xact_rollback), sum(tup_returned),\n" \
+		"       sum(tup_fetched),\n" \
+		"       sum(tup_inserted + tup_updated + tup_deleted),\n" \
+		"       sum(blks_hit), sum(blks_read), 0, 0\n" \
+		"FROM pg_stat_database%s;"
+
+/*
+ * WAL statistics: the position WAL has been written up to, or replayed up to
+ * on a standby, the counters of pg_stat_wal, and where the redo of the last
+ * checkpoint starts, when we are allowed to see it.  Writes and syncs moved
+ * to pg_stat_io in 18.
+ */
+#define WAL_REDO_LSN \
+		"       CASE WHEN has_function_privilege('pg_control_checkpoint()',\n" \
+		"                                        'EXECUTE')\n" \
+		"            THEN (SELECT redo_lsn - '0/0'\n" \
+		"                  FROM pg_control_checkpoint()) END\n"
+
+#define WAL_STATS \
+		"SELECT CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()\n" \
+		"            ELSE pg_current_wal_lsn() END - '0/0',\n" \
+		"       wal_records, wal_fpi, wal_buffers_full,\n" \
+		"       (SELECT sum(writes) FROM pg_stat_io WHERE object = 'wal'),\n" \
+		"       (SELECT sum(fsyncs) FROM pg_stat_io WHERE object = 'wal'),\n" \
+		"       (SELECT sum(write_time) FROM pg_stat_io\n" \
+		"        WHERE object = 'wal'),\n" \
+		"       (SELECT sum(fsync_time) FROM pg_stat_io\n" \
+		"        WHERE object = 'wal'),\n" \
+		WAL_REDO_LSN \
+		"FROM pg_stat_wal;"
+
+#define WAL_STATS_17 \
+		"SELECT CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()\n" \
+		"            ELSE pg_current_wal_lsn() END - '0/0',\n" \
+		"       wal_records, wal_fpi, wal_buffers_full, wal_write, wal_sync,\n" \
+		"       wal_write_time, wal_sync_time,\n" \
+		WAL_REDO_LSN \
+		"FROM pg_stat_wal;"
+
+#define WAL_STATS_13 \
+		"SELECT CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()\n" \
+		"            ELSE pg_current_wal_lsn() END - '0/0',\n" \
+		"       NULL, NULL, NULL, NULL, NULL, NULL, NULL,\n" \
+		WAL_REDO_LSN ";"
+
+#define WAL_STATS_9_6 \
+		"SELECT pg_xlog_location_diff(\n" \
+		"           CASE WHEN pg_is_in_recovery()\n" \
+		"                THEN pg_last_xlog_replay_location()\n" \
+		"                ELSE pg_current_xlog_location() END, '0/0'),\n" \
+		"       NULL, NULL, NULL, NULL, NULL, NULL, NULL,\n" \
+		"       CASE WHEN has_function_privilege('pg_control_checkpoint()',\n" \
+		"                                        'EXECUTE')\n" \
+		"            THEN (SELECT pg_xlog_location_diff(redo_location, '0/0')\n" \
+		"                  FROM pg_control_checkpoint()) END;"
+
+#define WAL_STATS_9_5 \
+		"SELECT pg_xlog_location_diff(\n" \
+		"           CASE WHEN pg_is_in_recovery()\n" \
+		"                THEN pg_last_xlog_replay_location()\n" \
+		"                ELSE pg_current_xlog_location() END, '0/0'),\n" \
+		"       NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL;"
+
+#define WAL_STATS_9_1 \
+		"SELECT NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL;"
+
+/*
+ * Checkpointer and background writer statistics: the checkpoints started on
+ * schedule and on request, the time spent writing and syncing their buffers,
+ * and the buffers written by the checkpointer, the background writer and the
+ * backends.  The checkpointer got its own view in 17, where the buffers
+ * written by backends are only found in pg_stat_io.
+ */
+#define BGWRITER_STATS \
+		"SELECT c.num_timed, c.num_requested, c.write_time, c.sync_time,\n" \
+		"       c.buffers_written, b.buffers_clean, b.maxwritten_clean,\n" \
+		"       (SELECT sum(writes) FROM pg_stat_io\n" \
+		"        WHERE object = 'relation'\n" \
+		"          AND backend_type NOT IN ('checkpointer',\n" \
+		"                                   'background writer'))\n" \
+		"FROM pg_stat_checkpointer c, pg_stat_bgwriter b;"
+
+#define BGWRITER_STATS_16 \
+		"SELECT checkpoints_timed, checkpoints_req, checkpoint_write_time,\n" \
+		"       checkpoint_sync_time, buffers_checkpoint, buffers_clean,\n" \
+		"       maxwritten_clean, buffers_backend\n" \
+		"FROM pg_stat_bgwriter;"
+
+#define BGWRITER_STATS_9_1 \
+		"SELECT checkpoints_timed, checkpoints_req, NULL, NULL,\n" \
+		"       buffers_checkpoint, buffers_clean, maxwritten_clean,\n" \
+		"       buffers_backend\n" \
+		"FROM pg_stat_bgwriter;"
+
+#define SAMPLE_BEGIN \
+		"BEGIN;\n" \
+		"SET statement_timeout = '2s';\n"
+
+#define SAMPLE_END "ROLLBACK;"
+#define SAMPLE_COMMIT "COMMIT;"
+
+/*
+ * Which of the results of a sample are the process, database, WAL and
+ * checkpointer statistics, when the query for the processes is a single
+ * statement.  Each further statement moves the statistics one result later.
+ */
+#define SAMPLE_RESULT 2
+#define SAMPLE_DBSTATS 3
+#define SAMPLE_WALSTATS 4
+#define SAMPLE_BGWSTATS 5
+
 int			pg_version(PGconn *);
+static PGresult *pg_timed(PGconn *, const char *);
+static void run_timed(PGconn *, const char *, const char *, int, PGresult **);
+static void update_stats(struct delta_stats *, PGresult *, int);
+
+/* the database to show statistics for, or NULL for all of them */
+static char *dbstats_datname = NULL;
+
+/* database statistics from the last two samples */
+static struct delta_stats dbstats;
+
+/* WAL statistics from the last two samples, -1 when not known */
+static struct delta_stats walstats;
+
+/* checkpointer statistics from the last two samples, -1 when not known */
+static struct delta_stats bgwstats;
+
+static void
+set_session(PGconn *pgconn)
+{
+	PQclear(PQexec(pgconn,
+				   "SET SESSION CHARACTERISTICS AS TRANSACTION ISOLATION " \
+				   "LEVEL READ UNCOMMITTED;"));
+}
 
 void
 connect_to_db(struct pg_conninfo_ctx *conninfo)
@@ -108,8 +724,27 @@ connect_to_db(struct pg_conninfo_ctx *conninfo)
 	const char *keywords[6] = {"host", "port", "user", "password", "dbname",
 	NULL};
 
-	if (conninfo->persistent && PQsocket(conninfo->connection) >= 0)
+	/*
+	 * A connection that is kept is only made again when it was lost, with
+	 * the settings libpq kept, since a persistent one freed ours.
+	 */
+	if (conninfo->kept != NULL)
+	{
+		if (PQstatus(conninfo->kept) != CONNECTION_OK)
+		{
+			PQreset(conninfo->kept);
+			if (PQstatus(conninfo->kept) != CONNECTION_OK)
+			{
+				new_message(MT_standout | MT_delayed, " %s",
+							PQerrorMessage(conninfo->kept));
+				conninfo->connection = NULL;
+				return;
+			}
+			set_session(conninfo->kept);
+		}
+		conninfo->connection = conninfo->kept;
 		return;
+	}
 
 	conninfo->connection = PQconnectdbParams(keywords, conninfo->values, 1);
 	if (PQstatus(conninfo->connection) != CONNECTION_OK)
@@ -122,24 +757,108 @@ connect_to_db(struct pg_conninfo_ctx *conninfo)
 		return;
 	}
 
+	if (conninfo->persistent || conninfo->keep)
+		conninfo->kept = conninfo->connection;
 	if (conninfo->persistent)
 		for (i = 0; i < 5; i++)
 			if (conninfo->values[i] != NULL)
 				free((void *) conninfo->values[i]);
 
-	PQexec(conninfo->connection,
-			"SET SESSION CHARACTERISTICS AS TRANSACTION ISOLATION LEVEL " \
-			"READ UNCOMMITTED;");
+	set_session(conninfo->connection);
 }
 
 void
 disconnect_from_db(struct pg_conninfo_ctx *conninfo)
 {
-	if (conninfo->persistent)
+	if (conninfo->kept != NULL)
 		return;
 	PQfinish(conninfo->connection);
 }
 
+/*
+ * Keep the connection made next until release_db(), so that the queries of
+ * an update share one connection rather than each making their own.
+ */
+void
+hold_db(struct pg_conninfo_ctx *conninfo)
+{
+	if (conninfo->keep)
+		return;
+	conninfo->keep = 1;
+	conninfo->held = 1;
+}
+
+void
+release_db(struct pg_conninfo_ctx *conninfo)
+{
+	if (!conninfo->held)
+		return;
+	conninfo->keep = 0;
+	conninfo->held = 0;
+	if (conninfo->kept != NULL && !conninfo->persistent)
+	{
+		PQfinish(conninfo->kept);
+		conninfo->kept = NULL;
+	}
+	conninfo->connection = NULL;
+}
+
+/*
+ * Prepare the statement the session history sampler runs, returning 0 on
+ * success.  Versions before 9.2 do not report the state of a backend and
+ * cannot be sampled.
+ */
+int
+pg_ash_prepare(PGconn *pgconn)
+{
+	char	   *sql;
+	PGresult   *pgresult;
+	int			ok;
+
+	if (pg_version(pgconn) >= 1400)
+		sql = ASH_SAMPLE;
+	else if (pg_version(pgconn) >= 906)
+		sql = ASH_SAMPLE_13;
+	else if (pg_version(pgconn) >= 902)
+		sql = ASH_SAMPLE_9_5;
+	else
+		return -1;
+
+	pgresult = PQprepare(pgconn, "ash_sample", sql, 0, NULL);
+	ok = PQresultStatus(pgresult) == PGRES_COMMAND_OK;
+	PQclear(pgresult);
+	return ok ? 0 : -1;
+}
+
+PGresult *
+pg_ash_sample(PGconn *pgconn)
+{
+	return PQexecPrepared(pgconn, "ash_sample", 0, NULL, NULL, NULL, 0);
+}
+
+PGresult *
+pg_ash_queries(PGconn *pgconn)
+{
+	if (pg_version(pgconn) < 1400)
+		return NULL;
+	return PQexec(pgconn, ASH_QUERIES);
+}
+
+/*
+ * Sample the sessions waiting on locks and who blocks them.  Versions before
+ * 9.6 cannot tell which sessions block another.
+ */
+PGresult *
+pg_blocking(PGconn *pgconn)
+{
+	if (pg_version(pgconn) >= 1400)
+		return pg_timed(pgconn, BLOCKING);
+	else if (pg_version(pgconn) >= 906)
+		return pg_timed(pgconn, BLOCKING_13);
+	else
+		return NULL;
+}
+
 PGresult *
 pg_locks(PGconn *pgconn, int procpid)
 {
@@ -164,38 +883,479 @@ pg_locks(PGconn *pgconn, int procpid)
 PGresult *
 pg_processes(PGconn *pgconn)
 {
-	PGresult   *pgresult;
-
-	PQexec(pgconn, "BEGIN;");
-	PQexec(pgconn, "SET statement_timeout = '2s';");
-	if (pg_version(pgconn) >= 902)
+	if (pg_version(pgconn) >= 1000)
 	{
-		pgresult = PQexec(pgconn, QUERY_PROCESSES);
+		return pg_sample(pgconn, QUERY_PROCESSES);
+	}
+	else if (pg_version(pgconn) >= 902)
+	{
+		return pg_sample(pgconn, QUERY_PROCESSES_9_6);
 	}
 	else
 	{
-		pgresult = PQexec(pgconn, QUERY_PROCESSES_9_1);
+		return pg_sample(pgconn, QUERY_PROCESSES_9_1);
 	}
-	PQexec(pgconn, "ROLLBACK;;");
-	return pgresult;
 }
 
 PGresult *
-pg_replication(PGconn *pgconn)
+pg_standby(PGconn *pgconn)
 {
+	char		sql[sizeof(STANDBY STANDBY_RECEIVER STANDBY_LSN_9_6
+						   STANDBY_CONFLICTS STANDBY_JOIN)];
+	int			version = pg_version(pgconn);
+
+	snprintf(sql, sizeof(sql), STANDBY,
+			 version >= 1100 ? STANDBY_RECEIVER :
+			 version >= 906 ? STANDBY_RECEIVER_10 : STANDBY_RECEIVER_9_5,
+			 version >= 1000 ? STANDBY_LSN : STANDBY_LSN_9_6,
+			 version >= 1600 ? STANDBY_CONFLICTS : STANDBY_CONFLICTS_15,
+			 version >= 906 ? STANDBY_JOIN : "");
+
+	return pg_timed(pgconn, sql);
+}
+
+/*
+ * Send the queries of the fleet display without waiting for the results,
+ * returning 0 if they could not be sent, as PQsendQuery() does.  The probe
+ * finds out whether pg_cputime() can be sampled.  A sample has two results,
+ * the server's row and its standbys.  Versions before 9.2 cannot be sampled.
+ */
+int
+pg_fleet_probe(PGconn *pgconn)
+{
+	return PQsendQuery(pgconn, FLEET_PROBE);
+}
+
+int
+pg_fleet_sample(PGconn *pgconn, int cputime)
+{
+	char		sql[sizeof(FLEET FLEET_CLIENTS FLEET_CLIENTS_AND FLEET_WAIT
+						   FLEET_LAG_9_6 FLEET_POSITION_9_6 FLEET_CPUTIME
+						   FLEET_DOWNSTREAM_9_6)];
+	int			version = pg_version(pgconn);
+
+	if (version < 902)
+		return 0;
+
+	snprintf(sql, sizeof(sql), FLEET,
+			 version >= 1000 ? FLEET_CLIENTS : "",
+			 version >= 1000 ? FLEET_CLIENTS_AND : "",
+			 version >= 906 ? FLEET_WAIT : FLEET_WAIT_9_5,
+			 version >= 1000 ? FLEET_LAG : FLEET_LAG_9_6,
+			 version >= 1000 ? FLEET_POSITION : FLEET_POSITION_9_6,
+			 cputime ? FLEET_CPUTIME : FLEET_NO_CPUTIME,
+			 version >= 1000 ? FLEET_DOWNSTREAM : FLEET_DOWNSTREAM_9_6);
+
+	return PQsendQuery(pgconn, sql);
+}
+
+PGresult *
+pg_pgbouncer_clients(PGconn *pgconn)
+{
+	return PQexec(pgconn, PGBOUNCER_CLIENTS);
+}
+
+PGresult *
+pg_pgbouncer_pools(PGconn *pgconn)
+{
+	return PQexec(pgconn, PGBOUNCER_POOLS);
+}
+
+PGresult *
+pg_pgbouncer_stats(PGconn *pgconn)
+{
+	return PQexec(pgconn, PGBOUNCER_STATS);
+}
+
+/*
+ * Sample the replication slots under the statement timeout of a sample.
+ * Versions before 9.4 do not have replication slots.
+ */
+PGresult *
+pg_slots(PGconn *pgconn)
+{
+	if (pg_version(pgconn) >= 1400)
+		return pg_timed(pgconn, SLOTS);
+	else if (pg_version(pgconn) >= 1300)
+		return pg_timed(pgconn, SLOTS_13);
+	else if (pg_version(pgconn) >= 1000)
+		return pg_timed(pgconn, SLOTS_12);
+	else if (pg_version(pgconn) >= 906)
+		return pg_timed(pgconn, SLOTS_9_6);
+	else if (pg_version(pgconn) >= 905)
+		return pg_timed(pgconn, SLOTS_9_5);
+	else if (pg_version(pgconn) >= 904)
+		return pg_timed(pgconn, SLOTS_9_4);
+	else
+		return NULL;
+}
+
+PGresult *
+pg_relations(PGconn *pgconn)
+{
+	return pg_timed(pgconn, RELATIONS);
+}
+
+/*
+ * Sample pg_stat_statements under the statement timeout of a sample, only
+ * the statements called since the last sample when changed is set.  Versions
+ * before 9.4 do not report query ids.
+ */
+PGresult *
+pg_statements(PGconn *pgconn, int changed)
+{
+	char		sql[sizeof(STATEMENTS_CHANGED) + sizeof("total_exec_time")];
 	PGresult   *pgresult;
 
-	PQexec(pgconn, "BEGIN;");
-	PQexec(pgconn, "SET statement_timeout = '2s';");
-	if (pg_version(pgconn) >= 1000) {
-		pgresult = PQexec(pgconn, REPLICATION);
-	} else {
-		pgresult = PQexec(pgconn, REPLICATION_9_6);
+	if (changed)
+	{
+		snprintf(sql, sizeof(sql), STATEMENTS_CHANGED,
+				 pg_version(pgconn) >= 1300 ? "total_exec_time" :
+				 "total_time");
+		run_timed(pgconn, sql, SAMPLE_COMMIT, 1, &pgresult);
+		return pgresult;
 	}
-	PQexec(pgconn, "ROLLBACK;");
+	else if (pg_version(pgconn) >= 1300)
+		return pg_timed(pgconn, STATEMENTS);
+	else if (pg_version(pgconn) >= 904)
+		return pg_timed(pgconn, STATEMENTS_12);
+	else
+		return NULL;
+}
+
+/*
+ * Keep the calls of the statements last seen by this connection on the
+ * server, returning 0 on success.  Versions before 9.5 cannot bring them up
+ * to date in one statement, and a standby cannot keep them.
+ */
+int
+pg_statements_track(PGconn *pgconn)
+{
+	PGresult   *pgresult;
+	int			ok;
+
+	if (pg_version(pgconn) < 905)
+		return -1;
+
+	run_timed(pgconn, STATEMENTS_TRACK, SAMPLE_COMMIT, 1, &pgresult);
+	ok = PQresultStatus(pgresult) == PGRES_COMMAND_OK;
+	PQclear(pgresult);
+	return ok ? 0 : -1;
+}
+
+/* Get the text of the statements with the query ids in an array literal. */
+PGresult *
+pg_statement_texts(PGconn *pgconn, const char *queryids)
+{
+	return PQexecParams(pgconn, STATEMENT_TEXTS, 1, NULL, &queryids, NULL,
+						NULL, 0);
+}
+
+/* Sample the standbys under the statement timeout of a sample. */
+PGresult *
+pg_replication(PGconn *pgconn)
+{
+	if (pg_version(pgconn) >= 1000)
+		return pg_timed(pgconn, REPLICATION);
+	else
+		return pg_timed(pgconn, REPLICATION_9_6);
+}
+
+/*
+ * Run the query for a sample of processes together with the one for the
+ * database statistics, in a single round trip.  The result of the query is
+ * returned, and the database statistics are kept for pg_database_info().
+ */
+PGresult *
+pg_sample(PGconn *pgconn, const char *query)
+{
+	PGresult   *pgresult;
+
+	pg_sample_results(pgconn, query, 1, &pgresult);
+	return pgresult;
+}
+
+/*
+ * Run a query on its own under the statement timeout of a sample, so that a
+ * slow catalog cannot hold up the display.  The result of the query is
+ * returned, an error when it did not run.
+ */
+static PGresult *
+pg_timed(PGconn *pgconn, const char *query)
+{
+	PGresult   *pgresult;
+
+	pg_timed_results(pgconn, query, 1, &pgresult);
 	return pgresult;
 }
 
+/*
+ * Like pg_timed(), for a query of as many statements as there are results.
+ * Every result is set, to an error when the statement did not run, and is
+ * the caller's to clear.
+ */
+void
+pg_timed_results(PGconn *pgconn, const char *query, int nresults,
+				 PGresult **results)
+{
+	run_timed(pgconn, query, SAMPLE_END, nresults, results);
+}
+
+/*
+ * Run a query under the statement timeout of a sample, ending the transaction
+ * with end, so that what it writes can be kept.
+ */
+static void
+run_timed(PGconn *pgconn, const char *query, const char *end, int nresults,
+		  PGresult **results)
+{
+	char	   *sql;
+	PGresult   *r;
+	int			i;
+
+	for (i = 0; i < nresults; i++)
+		results[i] = NULL;
+	i = 0;
+
+	sql = (char *) malloc(strlen(SAMPLE_BEGIN) + strlen(query) + 1 +
+						  strlen(end) + 1);
+	strcpy(sql, SAMPLE_BEGIN);
+	strcat(sql, query);
+	strcat(sql, "\n");
+	strcat(sql, end);
+
+	if (PQsendQuery(pgconn, sql))
+	{
+		while ((r = PQgetResult(pgconn)) != NULL)
+		{
+			if (i >= SAMPLE_RESULT && i < SAMPLE_RESULT + nresults)
+				results[i - SAMPLE_RESULT] = r;
+			else
+				PQclear(r);
+			i++;
+		}
+	}
+	free(sql);
+
+	/* the end was skipped if the query failed */
+	if (PQtransactionStatus(pgconn) != PQTRANS_IDLE)
+		PQclear(PQexec(pgconn, SAMPLE_END));
+
+	for (i = 0; i < nresults; i++)
+		if (results[i] == NULL)
+			results[i] = PQmakeEmptyPGresult(pgconn, PGRES_FATAL_ERROR);
+}
+
+/*
+ * Like pg_sample(), for a query of as many statements as there are results.
+ * Every result is set, to an error when the statement did not run, and is
+ * the caller's to clear.  All the other results of the round trip are
+ * cleared here.
+ */
+void
+pg_sample_results(PGconn *pgconn, const char *query, int nresults,
+				  PGresult **results)
+{
+	char	   *sql;
+	char	   *where;
+	char	   *literal = NULL;
+	const char *dbstats_query;
+	const char *walstats_query;
+	const char *bgwstats_query;
+	PGresult   *r;
+	int			i = 0;
+	int			stats;
+
+	for (i = 0; i < nresults; i++)
+		results[i] = NULL;
+	i = 0;
+
+	if (dbstats_datname != NULL &&
+		(literal = PQescapeLiteral(pgconn, dbstats_datname,
+								   strlen(dbstats_datname))) != NULL)
+	{
+		where = (char *) malloc(strlen(literal) + 18);
+		sprintf(where, " WHERE datname = %s", literal);
+		PQfreemem(literal);
+	}
+	else
+	{
+		where = strdup("");
+	}
+
+	dbstats_query = pg_version(pgconn) >= 902 ?
+		DATABASE_STATS : DATABASE_STATS_9_1;
+	if (pg_version(pgconn) >= 1800)
+		walstats_query = WAL_STATS;
+	else if (pg_version(pgconn) >= 1400)
+		walstats_query = WAL_STATS_17;
+	else if (pg_version(pgconn) >= 1000)
+		walstats_query = WAL_STATS_13;
+	else if (pg_version(pgconn) >= 906)
+		walstats_query = WAL_STATS_9_6;
+	else if (pg_version(pgconn) >= 902)
+		walstats_query = WAL_STATS_9_5;
+	else
+		walstats_query = WAL_STATS_9_1;
+	if (pg_version(pgconn) >= 1700)
+		bgwstats_query = BGWRITER_STATS;
+	else if (pg_version(pgconn) >= 902)
+		bgwstats_query = BGWRITER_STATS_16;
+	else
+		bgwstats_query = BGWRITER_STATS_9_1;
+	sql = (char *) malloc(strlen(SAMPLE_BEGIN) + strlen(query) + 1 +
+						  strlen(dbstats_query) + strlen(where) + 1 +
+						  strlen(walstats_query) + 1 +
+						  strlen(bgwstats_query) + 1 +
+						  strlen(SAMPLE_END) + 1);
+	strcpy(sql, SAMPLE_BEGIN);
+	strcat(sql, query);
+	strcat(sql, "\n");
+	sprintf(sql + strlen(sql), dbstats_query, where);
+	strcat(sql, "\n");
+	strcat(sql, walstats_query);
+	strcat(sql, "\n");
+	strcat(sql, bgwstats_query);
+	strcat(sql, "\n");
+	strcat(sql, SAMPLE_END);
+	free(where);
+
+	if (PQsendQuery(pgconn, sql))
+	{
+		while ((r = PQgetResult(pgconn)) != NULL)
+		{
+			/* where the statistics would be after a single statement */
+			stats = i - nresults + 1;
+			if (i >= SAMPLE_RESULT && i < SAMPLE_RESULT + nresults)
+				results[i - SAMPLE_RESULT] = r;
+			else if (stats == SAMPLE_DBSTATS)
+				update_stats(&dbstats, r, DBSTATS_TYPES);
+			else if (stats == SAMPLE_WALSTATS)
+				update_stats(&walstats, r, WALSTATS_TYPES);
+			else if (stats == SAMPLE_BGWSTATS)
+				update_stats(&bgwstats, r, BGWSTATS_TYPES);
+			else
+				PQclear(r);
+			i++;
+		}
+	}
+	free(sql);
+
+	/* the rest of the statements were skipped if one of them failed */
+	if (PQtransactionStatus(pgconn) != PQTRANS_IDLE)
+		PQclear(PQexec(pgconn, SAMPLE_END));
+
+	for (i = 0; i < nresults; i++)
+		if (results[i] == NULL)
+			results[i] = PQmakeEmptyPGresult(pgconn, PGRES_FATAL_ERROR);
+}
+
+/*
+ * Keep the one row of n statistics of a result as their latest sample, -1
+ * for those that are null.
+ */
+static void
+update_stats(struct delta_stats *d, PGresult *pgresult, int n)
+{
+	double	   *values;
+	int			i;
+
+	if (PQresultStatus(pgresult) == PGRES_TUPLES_OK &&
+		PQntuples(pgresult) == 1 && PQnfields(pgresult) == n &&
+		n <= DELTA_STATS)
+	{
+		values = delta_next(d);
+		for (i = 0; i < n; i++)
+			values[i] = PQgetisnull(pgresult, 0, i) ? -1 :
+				strtod(PQgetvalue(pgresult, 0, i), NULL);
+	}
+	PQclear(pgresult);
+}
+
+/*
+ * Select the database to show statistics for, or all of them if datname is
+ * NULL.
+ */
+void
+pg_database_stats(char *datname)
+{
+	if (dbstats_datname != NULL)
+		free(dbstats_datname);
+	dbstats_datname = datname != NULL ? strdup(datname) : NULL;
+	dbstats.samples = 0;
+}
+
+/* Forget the samples taken, as when connecting to another server. */
+void
+pg_reset_stats(void)
+{
+	dbstats.samples = 0;
+	walstats.samples = 0;
+	bgwstats.samples = 0;
+}
+
+/* Calculate the database statistics over the time between the last samples. */
+void
+pg_database_info(struct db_info *info)
+{
+	double		delta[DBSTATS_TYPES];
+	double		timediff;
+	int			i;
+
+	memset(info, 0, sizeof(struct db_info));
+	info->datname = dbstats_datname;
+	info->hit = -1;
+	if ((timediff = delta_diff(&dbstats, delta, DBSTATS_TYPES)) == 0)
+		return;
+
+	/* every database counter is reported, a null one has not counted yet */
+	for (i = 0; i < DBSTATS_TYPES; i++)
+		if (delta[i] < 0)
+			delta[i] = 0;
+
+	info->commits = delta[DBSTATS_COMMIT] / timediff;
+	info->rollbacks = delta[DBSTATS_ROLLBACK] / timediff;
+	info->returned = delta[DBSTATS_RETURNED] / timediff;
+	info->fetched = delta[DBSTATS_FETCHED] / timediff;
+	info->modified = delta[DBSTATS_MODIFIED] / timediff;
+	if (delta[DBSTATS_HIT] + delta[DBSTATS_READ] > 0)
+		info->hit = delta[DBSTATS_HIT] * 100.0 /
+			(delta[DBSTATS_HIT] + delta[DBSTATS_READ]);
+	info->temp_bytes = delta[DBSTATS_TEMP_BYTES] / timediff;
+	info->deadlocks = delta[DBSTATS_DEADLOCKS];
+}
+
+/*
+ * Sample the progress of the commands that report it on the server's version:
+ * VACUUM from 9.6, CLUSTER and CREATE INDEX from 12, ANALYZE and base backups
+ * from 13, and COPY from 14.
+ */
+PGresult *
+pg_progress(PGconn *pgconn)
+{
+	char		sql[sizeof(PROGRESS_BEGIN PROGRESS_VACUUM PROGRESS_CLUSTER
+						   PROGRESS_CREATE_INDEX PROGRESS_ANALYZE
+						   PROGRESS_BASEBACKUP PROGRESS_COPY PROGRESS_END) +
+					6 * sizeof("UNION ALL\n")];
+	int			version = pg_version(pgconn);
+
+	if (version < 906)
+		return NULL;
+
+	strcpy(sql, PROGRESS_BEGIN PROGRESS_VACUUM);
+	if (version >= 1200)
+		strcat(sql, "UNION ALL\n" PROGRESS_CLUSTER
+			   "UNION ALL\n" PROGRESS_CREATE_INDEX);
+	if (version >= 1300)
+		strcat(sql, "UNION ALL\n" PROGRESS_ANALYZE
+			   "UNION ALL\n" PROGRESS_BASEBACKUP);
+	if (version >= 1400)
+		strcat(sql, "UNION ALL\n" PROGRESS_COPY);
+	strcat(sql, PROGRESS_END);
+
+	return pg_timed(pgconn, sql);
+}
+
 PGresult *
 pg_query(PGconn *pgconn, int procpid)
 {
@@ -223,3 +1383,84 @@ pg_version(PGconn *pgconn)
 {
 	return PQserverVersion(pgconn) / 100;
 }
+
+/*
+ * Calculate the WAL statistics over the time between the last samples.  What
+ * the server does not report is left at -1.
+ */
+void
+pg_wal_info(struct wal_info *info)
+{
+	double		delta[WALSTATS_TYPES];
+	double		timediff;
+
+	info->bytes = -1;
+	info->records = -1;
+	info->fpi = -1;
+	info->buffers_full = -1;
+	info->writes = -1;
+	info->syncs = -1;
+	info->write_time = -1;
+	info->sync_time = -1;
+	info->checkpoint = 0;
+	if ((timediff = delta_diff(&walstats, delta, WALSTATS_TYPES)) == 0)
+		return;
+
+	if (delta[WALSTATS_LSN] >= 0)
+		info->bytes = delta[WALSTATS_LSN] / timediff;
+	if (delta[WALSTATS_RECORDS] >= 0)
+		info->records = delta[WALSTATS_RECORDS] / timediff;
+	if (delta[WALSTATS_RECORDS] > 0 && delta[WALSTATS_FPI] >= 0)
+		info->fpi = delta[WALSTATS_FPI] * 100.0 / delta[WALSTATS_RECORDS];
+	if (delta[WALSTATS_BUFFERS_FULL] >= 0)
+		info->buffers_full = delta[WALSTATS_BUFFERS_FULL] / timediff;
+	if (delta[WALSTATS_WRITE] >= 0)
+		info->writes = delta[WALSTATS_WRITE] / timediff;
+	if (delta[WALSTATS_SYNC] >= 0)
+		info->syncs = delta[WALSTATS_SYNC] / timediff;
+
+	/* the times are only counted when track_wal_io_timing is on */
+	if (delta[WALSTATS_WRITE] > 0 && delta[WALSTATS_WRITE_TIME] > 0)
+		info->write_time = delta[WALSTATS_WRITE_TIME] / delta[WALSTATS_WRITE];
+	if (delta[WALSTATS_SYNC] > 0 && delta[WALSTATS_SYNC_TIME] > 0)
+		info->sync_time = delta[WALSTATS_SYNC_TIME] / delta[WALSTATS_SYNC];
+
+	/* a new redo point means a checkpoint started since the last sample */
+	info->checkpoint = delta[WALSTATS_REDO_LSN] > 0;
+}
+
+/*
+ * Calculate the checkpointer and background writer statistics over the time
+ * between the last samples.  Checkpoints and their times are counted over
+ * the interval, buffers per second.  What the server does not report is left
+ * at -1.
+ */
+void
+pg_bgwriter_info(struct bgwriter_info *info)
+{
+	double		delta[BGWSTATS_TYPES];
+	double		timediff;
+
+	info->timed = -1;
+	info->requested = -1;
+	info->write_time = -1;
+	info->sync_time = -1;
+	info->checkpointer = -1;
+	info->bgwriter = -1;
+	info->maxwritten = -1;
+	info->backend = -1;
+	if ((timediff = delta_diff(&bgwstats, delta, BGWSTATS_TYPES)) == 0)
+		return;
+
+	info->timed = delta[BGWSTATS_TIMED];
+	info->requested = delta[BGWSTATS_REQUESTED];
+	info->write_time = delta[BGWSTATS_WRITE_TIME];
+	info->sync_time = delta[BGWSTATS_SYNC_TIME];
+	info->maxwritten = delta[BGWSTATS_MAXWRITTEN];
+	if (delta[BGWSTATS_CHECKPOINTER] >= 0)
+		info->checkpointer = delta[BGWSTATS_CHECKPOINTER] / timediff;
+	if (delta[BGWSTATS_BGWRITER] >= 0)
+		info->bgwriter = delta[BGWSTATS_BGWRITER] / timediff;
+	if (delta[BGWSTATS_BACKEND] >= 0)
+		info->backend = delta[BGWSTATS_BACKEND] / timediff;
+}
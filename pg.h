@@ -9,16 +9,89 @@ struct pg_conninfo_ctx
 {
 	PGconn	   *connection;
 	int			persistent;
+	int			keep;			/* keep the connection between updates */
+	int			held;			/* kept only until release_db() */
+	PGconn	   *kept;			/* the connection kept, or NULL */
 	const char *values[6];
 };
 
+/* Database activity over the time between the last two samples. */
+struct db_info
+{
+	char	   *datname;		/* NULL for all databases */
+	double		commits;		/* per second */
+	double		rollbacks;		/* per second */
+	double		returned;		/* rows per second */
+	double		fetched;		/* rows per second */
+	double		modified;		/* rows per second */
+	double		hit;			/* percentage of blocks, -1 if none */
+	double		temp_bytes;		/* per second */
+	long long	deadlocks;
+};
+
+/* WAL activity over the time between the last two samples, -1 if unknown. */
+struct wal_info
+{
+	double		bytes;			/* per second */
+	double		records;		/* per second */
+	double		fpi;			/* full page images, percentage of records */
+	double		buffers_full;	/* per second */
+	double		writes;			/* per second */
+	double		syncs;			/* per second */
+	double		write_time;		/* milliseconds per write */
+	double		sync_time;		/* milliseconds per sync */
+	int			checkpoint;		/* whether a checkpoint started */
+};
+
+/*
+ * Checkpointer and background writer activity over the time between the last
+ * two samples, -1 if unknown.
+ */
+struct bgwriter_info
+{
+	double		timed;			/* checkpoints started on schedule */
+	double		requested;		/* checkpoints started on request */
+	double		write_time;		/* milliseconds writing checkpoints */
+	double		sync_time;		/* milliseconds syncing checkpoints */
+	double		checkpointer;	/* buffers written per second */
+	double		bgwriter;		/* buffers written per second */
+	double		maxwritten;		/* background writer rounds cut short */
+	double		backend;		/* buffers written per second */
+};
+
 void		connect_to_db(struct pg_conninfo_ctx *);
 void		disconnect_from_db(struct pg_conninfo_ctx *);
+void		hold_db(struct pg_conninfo_ctx *);
+void		release_db(struct pg_conninfo_ctx *);
 
+int			pg_ash_prepare(PGconn *);
+PGresult   *pg_ash_queries(PGconn *);
+PGresult   *pg_ash_sample(PGconn *);
+PGresult   *pg_blocking(PGconn *);
+int			pg_fleet_probe(PGconn *);
+int			pg_fleet_sample(PGconn *, int);
 PGresult   *pg_locks(PGconn *, int);
+PGresult   *pg_pgbouncer_clients(PGconn *);
+PGresult   *pg_pgbouncer_pools(PGconn *);
+PGresult   *pg_pgbouncer_stats(PGconn *);
 PGresult   *pg_processes(PGconn *);
+PGresult   *pg_progress(PGconn *);
+PGresult   *pg_relations(PGconn *);
 PGresult   *pg_replication(PGconn *);
 PGresult   *pg_query(PGconn *, int);
+PGresult   *pg_sample(PGconn *, const char *);
+void		pg_sample_results(PGconn *, const char *, int, PGresult **);
+PGresult   *pg_slots(PGconn *);
+PGresult   *pg_standby(PGconn *);
+PGresult   *pg_statement_texts(PGconn *, const char *);
+PGresult   *pg_statements(PGconn *, int);
+int			pg_statements_track(PGconn *);
+void		pg_timed_results(PGconn *, const char *, int, PGresult **);
+void		pg_database_info(struct db_info *);
+void		pg_database_stats(char *);
+void		pg_reset_stats(void);
+void		pg_wal_info(struct wal_info *);
+void		pg_bgwriter_info(struct bgwriter_info *);
 
 enum BackendState
 {
@@ -39,7 +112,173 @@ enum pg_stat_activity
 	PROC_USENAME,
 	PROC_XSTART,
 	PROC_QSTART,
-	PROC_LOCKS
+	PROC_LOCKS,
+	PROC_BACKEND_TYPE
+};
+
+enum pg_ash_sample
+{
+	ASH_PID = 0,
+	ASH_WAIT_EVENT_TYPE,
+	ASH_WAIT_EVENT,
+	ASH_QUERY_ID
+};
+
+enum pg_blocking
+{
+	BLOCK_PID = 0,
+	BLOCK_BLOCKERS,
+	BLOCK_WAIT,
+	BLOCK_MODE,
+	BLOCK_RELATION,
+	BLOCK_STATE,
+	BLOCK_QUERY,
+	BLOCK_GRANTED,
+	BLOCK_WAITING
+};
+
+enum pg_standby
+{
+	STANDBY_IN_RECOVERY = 0,
+	STANDBY_STATUS,
+	STANDBY_SENDER_HOST,
+	STANDBY_SENDER_PORT,
+	STANDBY_SLOT,
+	STANDBY_RECEIVED,
+	STANDBY_REPLAYED,
+	STANDBY_DELAY,
+	STANDBY_CONFL_TABLESPACE,
+	STANDBY_CONFL_LOCK,
+	STANDBY_CONFL_SNAPSHOT,
+	STANDBY_CONFL_BUFFERPIN,
+	STANDBY_CONFL_DEADLOCK,
+	STANDBY_CONFL_LOGICALSLOT,
+	STANDBY_TYPES				/* number of columns */
+};
+
+enum pg_fleet
+{
+	FLEET_SESSIONS = 0,
+	FLEET_ACTIVE,
+	FLEET_XACTS,
+	FLEET_WAIT_EVENT,
+	FLEET_LAG_BYTES,
+	FLEET_IN_RECOVERY,
+	FLEET_POSITION,
+	FLEET_CLUSTER_NAME,
+	FLEET_ADDRESS,
+	FLEET_CPU_BUSY,
+	FLEET_CPU_TOTAL
+};
+
+enum pg_fleet_downstream
+{
+	DOWNSTREAM_APPLICATION_NAME = 0,
+	DOWNSTREAM_CLIENT_ADDR,
+	DOWNSTREAM_STATE,
+	DOWNSTREAM_LAG,
+	DOWNSTREAM_REPLAYED,
+	DOWNSTREAM_LAG_TIME
+};
+
+enum pg_replication_slots
+{
+	SLOT_NAME = 0,
+	SLOT_TYPE,
+	SLOT_PID,
+	SLOT_DATABASE,
+	SLOT_RETAINED,
+	SLOT_UNCONFIRMED,
+	SLOT_WAL_STATUS,
+	SLOT_SAFE_WAL_SIZE,
+	SLOT_SPILL_BYTES,
+	SLOT_STREAM_BYTES
+};
+
+enum pg_stat_progress
+{
+	PROGRESS_PID = 0,
+	PROGRESS_COMMAND,
+	PROGRESS_PHASE,
+	PROGRESS_RELATION,
+	PROGRESS_DONE,
+	PROGRESS_TOTAL,
+	PROGRESS_UNIT,
+	PROGRESS_ELAPSED
+};
+
+enum pg_stat_user_tables
+{
+	REL_RELID = 0,
+	REL_SCHEMANAME,
+	REL_RELNAME,
+	REL_SEQ_SCAN,
+	REL_SEQ_TUP_READ,
+	REL_IDX_SCAN,
+	REL_IDX_TUP_FETCH,
+	REL_N_TUP_INS,
+	REL_N_TUP_UPD,
+	REL_N_TUP_DEL,
+	REL_HEAP_BLKS_READ,
+	REL_IDX_BLKS_READ
+};
+
+enum pg_stat_statements
+{
+	STMT_QUERYID = 0,
+	STMT_CALLS,
+	STMT_TOTAL_TIME,
+	STMT_ROWS,
+	STMT_SHARED_BLKS_HIT,
+	STMT_SHARED_BLKS_READ,
+	STMT_TEMP_BLKS
+};
+
+enum pg_statement_texts
+{
+	STMT_TEXT_QUERYID = 0,
+	STMT_TEXT_QUERY
+};
+
+enum pg_stat_database
+{
+	DBSTATS_COMMIT = 0,
+	DBSTATS_ROLLBACK,
+	DBSTATS_RETURNED,
+	DBSTATS_FETCHED,
+	DBSTATS_MODIFIED,
+	DBSTATS_HIT,
+	DBSTATS_READ,
+	DBSTATS_TEMP_BYTES,
+	DBSTATS_DEADLOCKS,
+	DBSTATS_TYPES				/* number of statistics */
+};
+
+enum pg_stat_wal
+{
+	WALSTATS_LSN = 0,
+	WALSTATS_RECORDS,
+	WALSTATS_FPI,
+	WALSTATS_BUFFERS_FULL,
+	WALSTATS_WRITE,
+	WALSTATS_SYNC,
+	WALSTATS_WRITE_TIME,
+	WALSTATS_SYNC_TIME,
+	WALSTATS_REDO_LSN,
+	WALSTATS_TYPES				/* number of statistics */
+};
+
+enum pg_stat_bgwriter
+{
+	BGWSTATS_TIMED = 0,
+	BGWSTATS_REQUESTED,
+	BGWSTATS_WRITE_TIME,
+	BGWSTATS_SYNC_TIME,
+	BGWSTATS_CHECKPOINTER,
+	BGWSTATS_BGWRITER,
+	BGWSTATS_MAXWRITTEN,
+	BGWSTATS_BACKEND,
+	BGWSTATS_TYPES				/* number of statistics */
 };
 
 enum pg_stat_replication
@@ -49,15 +288,14 @@ enum pg_stat_replication
 	REP_APPLICATION_NAME,
 	REP_CLIENT_ADDR,
 	REP_STATE,
-	REP_WAL_INSERT,
+	REP_PRIMARY,
 	REP_SENT,
 	REP_WRITE,
 	REP_FLUSH,
 	REP_REPLAY,
-	REP_SENT_LAG,
-	REP_WRITE_LAG,
-	REP_FLUSH_LAG,
-	REP_REPLAY_LAG
+	REP_WRITE_TIME,
+	REP_FLUSH_TIME,
+	REP_REPLAY_TIME
 };
 
 #endif							/* _PG_H_ */
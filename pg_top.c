@@ -35,6 +35,7 @@ char	   *copyright =
 #include <ctype.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <limits.h>
 
 /* determine which type of signal functions to use */
 #ifdef HAVE_SIGACTION
@@ -48,6 +49,19 @@ char	   *copyright =
 /* includes specific to top */
 
 #include "pg_top.h"
+#include "ash.h"
+#include "blocking.h"
+#include "fleet.h"
+#include "output.h"
+#include "progress.h"
+#include "record.h"
+#include "relations.h"
+#include "replication.h"
+#include "serve.h"
+#include "slots.h"
+#include "statements.h"
+#include "pgbouncer.h"
+#include "topology.h"
 #include "remote.h"
 #include "commands.h"
 #include "display.h"			/* interface to display package */
@@ -91,18 +105,41 @@ static const char *progname = "pg_top";
 void		process_commands(struct pg_top_context *);
 static void usage(const char *progname);
 
+/* Options that have no letter */
+enum LongOptions
+{
+	OPT_ATTACH = 256,
+	OPT_FORMAT,
+	OPT_RECORD,
+	OPT_REPLAY,
+	OPT_SERVE
+};
+
 /* List of all the options available */
 static struct option long_options[] = {
+	{"attach", required_argument, NULL, OPT_ATTACH},
 	{"batch", no_argument, NULL, 'b'},
+	{"blocking", no_argument, NULL, 'B'},
 	{"show-command", no_argument, NULL, 'c'},
+	{"session-history", no_argument, NULL, 'H'},
 	{"color-mode", no_argument, NULL, 'C'},
+	{"fleet", required_argument, NULL, 'F'},
+	{"format", required_argument, NULL, OPT_FORMAT},
 	{"interactive", no_argument, NULL, 'i'},
 	{"hide-idle", no_argument, NULL, 'I'},
 	{"non-interactive", no_argument, NULL, 'n'},
 	{"order-field", required_argument, NULL, 'o'},
+	{"pgbouncer", required_argument, NULL, 'K'},
+	{"record", required_argument, NULL, OPT_RECORD},
 	{"remote-mode", no_argument, NULL, 'r'},
+	{"replay", required_argument, NULL, OPT_REPLAY},
+	{"serve", required_argument, NULL, OPT_SERVE},
 	{"set-delay", required_argument, NULL, 's'},
+	{"statements", no_argument, NULL, 'S'},
+	{"table-activity", no_argument, NULL, 't'},
+	{"topology", no_argument, NULL, 'G'},
 	{"show-tags", no_argument, NULL, 'T'},
+	{"slots", no_argument, NULL, 'O'},
 	{"version", no_argument, NULL, 'V'},
 	{"set-display", required_argument, NULL, 'x'},
 	{"show-username", required_argument, NULL, 'z'},
@@ -110,6 +147,7 @@ static struct option long_options[] = {
 	{"dbname", required_argument, NULL, 'd'},
 	{"host", required_argument, NULL, 'h'},
 	{"port", required_argument, NULL, 'p'},
+	{"progress", no_argument, NULL, 'P'},
 	{"username", required_argument, NULL, 'U'},
 	{"password", no_argument, NULL, 'W'},
 	{NULL, 0, NULL, 0}
@@ -124,6 +162,10 @@ void		(*d_procstates) (int, int *) = i_procstates;
 void		(*d_cpustates) (int64_t *) = i_cpustates;
 void		(*d_memory) (long *) = i_memory;
 void		(*d_swap) (long *) = i_swap;
+void		(*d_diskstats) (struct disk_info *) = i_diskstats;
+void		(*d_dbstats) (struct db_info *) = i_dbstats;
+void		(*d_walstats) (struct wal_info *) = i_walstats;
+void		(*d_bgwstats) (struct bgwriter_info *) = i_bgwstats;
 void		(*d_message) () = i_message;
 void		(*d_process) (int, char *) = i_process;
 
@@ -137,16 +179,31 @@ usage(const char *progname)
 	printf("Usage:\n");
 	printf("  %s [OPTION]... [COUNT]\n", progname);
 	printf("\nGeneral options:\n");
+	printf("      --attach=FILE         display the updates of pg_top --serve\n");
 	printf("  -b, --batch               use batch mode\n");
+	printf("  -B, --blocking            display sessions blocked by locks\n");
 	printf("  -c, --show-command        display command name of each process\n");
 	printf("  -C, --color-mode          turn off color mode\n");
+	printf("  -F, --fleet=FILE          display the servers listed in FILE\n");
+	printf("      --format=FORMAT       write processes as text, jsonl or csv records\n");
+	printf("  -G, --topology            display the replication topology\n");
+	printf("  -H, --session-history     display active session history\n");
 	printf("  -i, --interactive         use interactive mode\n");
 	printf("  -I, --hide-idle           hide idle processes\n");
+	printf("  -K, --pgbouncer=CONNINFO  display the pools of pgbouncer\n");
 	printf("  -n, --non-interactive     use non-interactive mode\n");
 	printf("  -o, --order-field=FIELD   select sort order\n");
+	printf("  -O, --slots               display replication slots\n");
+	printf("  -P, --progress            display progress of long running commands\n");
+	printf("      --record=FILE         record every update in FILE\n");
 	printf("  -r, --remote-mode         activate remote mode\n");
+	printf("      --replay=FILE         display the updates recorded in FILE\n");
 	printf("  -R                        display replication stats\n");
-	printf("  -s, --set-delay=SECOND    set delay between screen updates\n");
+	printf("  -s, --set-delay=SECOND    set delay between screen updates, may be\n");
+	printf("                            a fraction of a second\n");
+	printf("  -S, --statements          display top statements\n");
+	printf("      --serve=FILE          sample for pg_top --attach, publishing in FILE\n");
+	printf("  -t, --table-activity      display table activity\n");
 	printf("  -T, --show-tags           show color tags\n");
 	printf("  -V, --version             output version information, then exit\n");
 	printf("  -x, --set-display=COUNT   set maximum number of displays\n");
@@ -171,15 +228,29 @@ onalrm(int i)					/* SIGALRM handler */
 	/* return; */
 }
 
-void
-do_display(struct pg_top_context *pgtctx)
-{
-	register int i = 0;
-	register int active_procs;
+/*
+ *	sample_display() - get the current stats, and the processes or other
+ *	statistics of the display shown.
+ */
 
+static caddr_t
+sample_display(struct pg_top_context *pgtctx)
+{
 	caddr_t		processes;
-	time_t		curr_time;
-	static struct ext_decl exts = {NULL, NULL};
+	struct timeval delay;
+	struct system_info scratch;
+
+	delay.tv_sec = pgtctx->delay;
+	delay.tv_usec = pgtctx->delay_usec;
+
+	/* only sample session history while it is being looked at */
+	if (pgtctx->mode == MODE_ASH && !ash_running())
+		ash_start(&pgtctx->conninfo);
+	else if (pgtctx->mode != MODE_ASH && ash_running())
+		ash_stop();
+
+	/* the queries of the update share one connection */
+	hold_db(&pgtctx->conninfo);
 
 	/* get the current stats and processes */
 	if (pgtctx->mode_remote == 0)
@@ -195,12 +266,303 @@ do_display(struct pg_top_context *pgtctx)
 		processes = get_process_info_r(&pgtctx->system_info, &pgtctx->ps,
 									   pgtctx->order_index, &pgtctx->conninfo, pgtctx->mode);
 	}
+	if (pgtctx->mode == MODE_ASH)
+		processes = get_ash_info(&pgtctx->system_info, &pgtctx->conninfo,
+								 pgtctx->topn < max_topn ?
+								 pgtctx->topn : max_topn);
+	else if (pgtctx->mode == MODE_RELATIONS)
+		processes = get_relation_info(&pgtctx->system_info, &pgtctx->conninfo,
+									  pgtctx->relation_order_index);
+	else if (pgtctx->mode == MODE_REPLICATION)
+		processes = get_replication_info(&pgtctx->system_info,
+										 &pgtctx->conninfo,
+										 pgtctx->replication_order_index);
+	else if (pgtctx->mode == MODE_SLOTS)
+		processes = get_slot_info(&pgtctx->system_info, &pgtctx->conninfo,
+								  pgtctx->slot_order_index);
+	else if (pgtctx->mode == MODE_FLEET)
+		processes = get_fleet_info(&pgtctx->system_info,
+								   pgtctx->fleet_order_index, &delay);
+	else if (pgtctx->mode == MODE_TOPOLOGY)
+		processes = get_topology_info(&pgtctx->system_info, &delay);
+	else if (pgtctx->mode == MODE_PGBOUNCER)
+		processes = get_pgbouncer_info(&pgtctx->system_info,
+									   pgtctx->pool_order_index);
+	else if (pgtctx->mode == MODE_BLOCKING)
+		processes = get_blocking_info(&pgtctx->system_info, &pgtctx->conninfo);
+	else if (pgtctx->mode == MODE_PROGRESS)
+		processes = get_progress_info(&pgtctx->system_info, &pgtctx->conninfo);
+	else if (pgtctx->mode == MODE_STATEMENTS)
+		processes = get_statement_info(&pgtctx->system_info, &pgtctx->conninfo,
+									   pgtctx->statement_order_index,
+									   pgtctx->topn < max_topn ?
+									   pgtctx->topn : max_topn);
+
+	/* the standbys and locks are recorded whichever display is shown */
+	if (pgtctx->record != NULL)
+	{
+		if (pgtctx->mode != MODE_REPLICATION)
+			(void) get_replication_info(&scratch, &pgtctx->conninfo,
+										pgtctx->replication_order_index);
+		if (pgtctx->mode != MODE_BLOCKING)
+			(void) get_blocking_info(&scratch, &pgtctx->conninfo);
+	}
+
+	/*
+	 * The statements shown are compared on the server with those the
+	 * connection last saw, so it is kept while they are.
+	 */
+	if (pgtctx->mode != MODE_STATEMENTS)
+		release_db(&pgtctx->conninfo);
+
+	return processes;
+}
+
+/*
+ *	replay_display() - get the update of a recording that is due, and the
+ *	processes or other statistics of the display shown from it.
+ */
+
+static caddr_t
+replay_display(struct pg_top_context *pgtctx, struct db_info *db,
+			   struct wal_info *wal, struct bgwriter_info *bgwriter)
+{
+	caddr_t		processes;
+
+	pgtctx->header_text =
+		pgtctx->header_options[pgtctx->mode_remote][pgtctx->mode];
+	processes = get_replayed_info(&pgtctx->system_info, db, wal, bgwriter,
+								  &pgtctx->header_text, pgtctx->mode);
+
+	if (pgtctx->mode == MODE_PROCESSES || pgtctx->mode == MODE_IO_STATS)
+		processes = get_replayed_processes(&pgtctx->system_info, &pgtctx->ps,
+										   pgtctx->order_index);
+	else if (pgtctx->mode == MODE_REPLICATION)
+		processes = get_replayed_replication(&pgtctx->system_info,
+											 pgtctx->replication_order_index);
+	else if (pgtctx->mode == MODE_BLOCKING)
+		processes = get_replayed_blocking(&pgtctx->system_info);
+
+	return processes;
+}
+
+/*
+ *	format_next() - the next line of the processes or other statistics of the
+ *	display shown.
+ */
+
+static char *
+format_next(struct pg_top_context *pgtctx, caddr_t processes)
+{
+	if (pgtctx->attach != NULL)
+		return format_next_served(processes);
+	if (pgtctx->replay != NULL && !record_rows(pgtctx->mode))
+		return format_next_replayed(processes);
+
+	switch (pgtctx->mode)
+	{
+#if defined(__linux__) || defined(__FreeBSD__)
+		case MODE_IO_STATS:
+			if (pgtctx->mode_remote == 0)
+				return format_next_io(processes);
+			else
+				return format_next_io_r(processes);
+#endif /* defined(__linux__) || defined(__FreeBSD__) */
+		case MODE_ASH:
+			return format_next_ash(processes);
+		case MODE_RELATIONS:
+			return format_next_relation(processes);
+		case MODE_BLOCKING:
+			return format_next_blocking(processes);
+		case MODE_PROGRESS:
+			return format_next_progress(processes);
+		case MODE_STATEMENTS:
+			return format_next_statement(processes);
+		case MODE_REPLICATION:
+			return format_next_replication(processes);
+		case MODE_SLOTS:
+			return format_next_slot(processes);
+		case MODE_FLEET:
+			return format_next_fleet(processes);
+		case MODE_TOPOLOGY:
+			return format_next_topology(processes);
+		case MODE_PGBOUNCER:
+			return format_next_pgbouncer(processes);
+		case MODE_PROCESSES:
+		default:
+			if (pgtctx->mode_remote == 0)
+				return format_next_process(processes);
+			else
+				return format_next_process_r(processes);
+	}
+}
+
+/*
+ *	wait_display() - get ready for the next display, if there is one, and
+ *	wait for it.
+ */
+
+static void
+wait_display(struct pg_top_context *pgtctx)
+{
+	/* only do the rest if we have more displays to show */
+	if (pgtctx->displays)
+	{
+		/* switch out for new display on smart terminals */
+		if (smart_terminal)
+		{
+			if (overstrike)
+			{
+				reset_display(pgtctx);
+			}
+			else
+			{
+				d_loadave = u_loadave;
+				d_minibar = u_minibar;
+				d_uptime = u_uptime;
+				d_procstates = u_procstates;
+				d_cpustates = u_cpustates;
+				d_memory = u_memory;
+				d_swap = u_swap;
+				d_diskstats = u_diskstats;
+				d_dbstats = u_dbstats;
+				d_walstats = u_walstats;
+				d_bgwstats = u_bgwstats;
+				d_message = u_message;
+				pgtctx->d_header = u_header;
+				d_process = u_process;
+			}
+		}
+
+		/* a recording is shown one update after another when not interactive */
+		if (!pgtctx->interactive && pgtctx->replay != NULL)
+			return;
+
+		if (!pgtctx->interactive && ash_running())
+		{
+			struct timeval delay;
+
+			delay.tv_sec = pgtctx->delay;
+			delay.tv_usec = pgtctx->delay_usec;
+			ash_wait(&delay);
+		}
+		else if (!pgtctx->interactive)
+		{
+			struct itimerval interval;
+
+			timerclear(&interval.it_interval);
+			interval.it_value.tv_sec = pgtctx->delay;
+			interval.it_value.tv_usec = pgtctx->delay_usec;
+
+			/* set up alarm, which may be less than a second away */
+			if (timerisset(&interval.it_value))
+			{
+				(void) signal(SIGALRM, onalrm);
+				(void) setitimer(ITIMER_REAL, &interval, NULL);
+
+				/* wait for the rest of it .... */
+				pause();
+			}
+		}
+		else
+			process_commands(pgtctx);
+	}
+}
+
+void
+do_display(struct pg_top_context *pgtctx)
+{
+	register int i = 0;
+	register int active_procs = 0;
+	int			lines;
+
+	caddr_t		processes;
+	char	   *line;
+	time_t		curr_time;
+	struct db_info db_info;
+	struct wal_info wal_info;
+	struct bgwriter_info bgwriter_info;
+	static struct ext_decl exts = {NULL, NULL};
+
+	if (pgtctx->attach != NULL)
+	{
+		/* show what the pg_top serving sampled last */
+		processes = get_served_info(&pgtctx->system_info, &db_info, &wal_info,
+									&bgwriter_info, &pgtctx->header_text);
+	}
+	else if (pgtctx->replay != NULL)
+	{
+		/* show the update of the recording that is due */
+		processes = replay_display(pgtctx, &db_info, &wal_info,
+								   &bgwriter_info);
+	}
+	else
+	{
+		processes = sample_display(pgtctx);
+
+		/* database activity, sampled along with the processes */
+		pg_database_info(&db_info);
+
+		/* and WAL activity */
+		pg_wal_info(&wal_info);
+
+		/* and checkpointer activity */
+		pg_bgwriter_info(&bgwriter_info);
+	}
+
+	/* write every backend as a record rather than show them */
+	if (pgtctx->output != OUTPUT_TEXT)
+	{
+		output_begin();
+		for (i = 0; i < pgtctx->system_info.P_ACTIVE; i++)
+		{
+			if (pgtctx->mode_remote != 0)
+				output_next_process_r(processes);
+#if defined(__linux__)
+			else
+				output_next_process(processes);
+#endif /* defined(__linux__) */
+		}
+		if (fflush(stdout) != 0)
+			quit(1);
+		wait_display(pgtctx);
+		return;
+	}
+
+	/* every line is published or recorded, not only the ones shown */
+	lines = pgtctx->system_info.P_ACTIVE < SERVE_LINES ?
+		pgtctx->system_info.P_ACTIVE : SERVE_LINES;
+	if (pgtctx->record != NULL)
+		record_begin(&pgtctx->system_info, &db_info, &wal_info,
+					 &bgwriter_info, pgtctx->header_text, pgtctx->mode);
+
+	/* publish every line rather than show them, when serving */
+	if (pgtctx->serve != NULL)
+	{
+		serve_begin(&pgtctx->system_info, &db_info, &wal_info, &bgwriter_info,
+					pgtctx->header_text);
+		for (i = 0; i < lines; i++)
+		{
+			line = format_next(pgtctx, processes);
+			serve_line(line);
+			if (pgtctx->record != NULL)
+				record_line(line);
+		}
+		serve_end();
+		if (pgtctx->record != NULL)
+			record_end();
+		wait_display(pgtctx);
+		return;
+	}
 
 	/* display the load averages */
 	(*d_loadave) (pgtctx->system_info.last_pid, pgtctx->system_info.load_avg);
 
 	/* this method of getting the time SHOULD be fairly portable */
-	time(&curr_time);
+	if (pgtctx->replay != NULL)
+		curr_time = replay_time();
+	else
+		time(&curr_time);
 
 	/* if we have a minibar extension, use it, otherwise show uptime */
 	if (exts.f_minibar != NULL)
@@ -239,6 +601,18 @@ do_display(struct pg_top_context *pgtctx)
 	/* display swap stats */
 	(*d_swap) (pgtctx->system_info.swap);
 
+	/* display disk activity */
+	(*d_diskstats) (pgtctx->system_info.disk);
+
+	/* display database activity */
+	(*d_dbstats) (&db_info);
+
+	/* and WAL activity */
+	(*d_walstats) (&wal_info);
+
+	/* and checkpointer activity */
+	(*d_bgwstats) (&bgwriter_info);
+
 	/* handle message area */
 	(*d_message) ();
 
@@ -262,48 +636,24 @@ do_display(struct pg_top_context *pgtctx)
 		{
 			active_procs = max_topn;
 		}
-
-		/* Now show the top "n" processes or other statistics. */
-		switch (pgtctx->mode)
-		{
-#if defined(__linux__) || defined(__FreeBSD__)
-			case MODE_IO_STATS:
-				for (i = 0; i < active_procs; i++)
-				{
-					if (pgtctx->mode_remote == 0)
-						(*d_process) (i, format_next_io(processes));
-					else
-						(*d_process) (i, format_next_io_r(processes));
-				}
-				break;
-#endif /* defined(__linux__) || defined(__FreeBSD__) */
-			case MODE_REPLICATION:
-				for (i = 0; i < active_procs; i++)
-				{
-					if (pgtctx->mode_remote == 0)
-						(*d_process) (i, format_next_replication(processes));
-					else
-						(*d_process) (i, format_next_replication_r(processes));
-				}
-				break;
-			case MODE_PROCESSES:
-			default:
-				for (i = 0; i < active_procs; i++)
-				{
-					if (pgtctx->mode_remote == 0)
-						(*d_process) (i, format_next_process(processes));
-					else
-						(*d_process) (i, format_next_process_r(processes));
-				}
-		}
 	}
-	else
+
+	/* Now show the top "n" processes or other statistics. */
+	if (pgtctx->record == NULL || lines < active_procs)
+		lines = active_procs;
+	for (i = 0; i < lines; i++)
 	{
-		i = 0;
+		line = format_next(pgtctx, processes);
+		if (pgtctx->record != NULL)
+			record_line(line);
+		if (i < active_procs)
+			(*d_process) (i, line);
 	}
+	if (pgtctx->record != NULL)
+		record_end();
 
 	/* do end-screen processing */
-	u_endscreen(i);
+	u_endscreen(active_procs);
 
 	/* now, flush the output buffer */
 	if (fflush(stdout) != 0)
@@ -314,43 +664,7 @@ do_display(struct pg_top_context *pgtctx)
 		/* NOTREACHED */
 	}
 
-	/* only do the rest if we have more displays to show */
-	if (pgtctx->displays)
-	{
-		/* switch out for new display on smart terminals */
-		if (smart_terminal)
-		{
-			if (overstrike)
-			{
-				reset_display(pgtctx);
-			}
-			else
-			{
-				d_loadave = u_loadave;
-				d_minibar = u_minibar;
-				d_uptime = u_uptime;
-				d_procstates = u_procstates;
-				d_cpustates = u_cpustates;
-				d_memory = u_memory;
-				d_swap = u_swap;
-				d_message = u_message;
-				pgtctx->d_header = u_header;
-				d_process = u_process;
-			}
-		}
-
-		if (!pgtctx->interactive)
-		{
-			/* set up alarm */
-			(void) signal(SIGALRM, onalrm);
-			(void) alarm((unsigned) pgtctx->delay);
-
-			/* wait for the rest of it .... */
-			pause();
-		}
-		else
-			process_commands(pgtctx);
-	}
+	wait_display(pgtctx);
 }
 
 void
@@ -358,8 +672,10 @@ process_arguments(struct pg_top_context *pgtctx, int ac, char **av)
 {
 	int			i;
 	int			option_index;
+	double		seconds;
+	char	   *end;
 
-	while ((i = getopt_long(ac, av, "CDITbcinRrVh:s:d:U:o:Wp:Xx:z:",
+	while ((i = getopt_long(ac, av, "BCDF:GHIK:OPSTbcinRrtVh:s:d:U:o:Wp:Xx:z:",
 							long_options, &option_index)) != EOF)
 	{
 		switch (i)
@@ -374,6 +690,21 @@ process_arguments(struct pg_top_context *pgtctx, int ac, char **av)
 				debug_set(1);
 				break;
 
+			case 'F':			/* fleet mode */
+				pgtctx->fleet = optarg;
+				if (pgtctx->mode == MODE_PROCESSES)
+					pgtctx->mode = MODE_FLEET;
+				break;
+
+			case 'G':			/* replication topology mode */
+				pgtctx->mode = MODE_TOPOLOGY;
+				break;
+
+			case 'K':			/* pgbouncer mode */
+				pgtctx->pgbouncer = optarg;
+				pgtctx->mode = MODE_PGBOUNCER;
+				break;
+
 			case 'V':			/* show version number */
 				printf("pg_top %s\n", version_string());
 				exit(0);
@@ -417,12 +748,20 @@ process_arguments(struct pg_top_context *pgtctx, int ac, char **av)
 				break;
 
 			case 's':
-				if ((pgtctx->delay = atoi(optarg)) < 0 ||
-					(pgtctx->delay == 0 && getuid() != 0))
+				seconds = strtod(optarg, &end);
+				if (end == optarg || *end != '\0' || seconds < 0 ||
+					seconds > INT_MAX || (seconds == 0 && getuid() != 0))
 				{
 					new_message(MT_standout | MT_delayed,
 								" Bad seconds delay (ignored)");
 					pgtctx->delay = Default_DELAY;
+					pgtctx->delay_usec = 0;
+				}
+				else
+				{
+					pgtctx->delay = (int) seconds;
+					pgtctx->delay_usec = (int) ((seconds - pgtctx->delay) *
+												1000000);
 				}
 				break;
 
@@ -464,14 +803,65 @@ process_arguments(struct pg_top_context *pgtctx, int ac, char **av)
 				pgtctx->mode = MODE_REPLICATION;
 				break;
 
+			case 'O':			/* replication slots mode */
+				pgtctx->mode = MODE_SLOTS;
+				break;
+
 			case 'r':			/* remote mode */
 				pgtctx->mode_remote = 1;
+				pgtctx->conninfo.keep = 1;
+				break;
+
+			case 'H':			/* active session history mode */
+				pgtctx->mode = MODE_ASH;
+				break;
+
+			case 'B':			/* blocking sessions mode */
+				pgtctx->mode = MODE_BLOCKING;
+				break;
+
+			case 'P':			/* progress mode */
+				pgtctx->mode = MODE_PROGRESS;
+				break;
+
+			case 'S':			/* top statements mode */
+				pgtctx->mode = MODE_STATEMENTS;
+				break;
+
+			case 't':			/* table activity mode */
+				pgtctx->mode = MODE_RELATIONS;
 				break;
 
 			case 'X':			/* i/O mode */
 				pgtctx->mode = MODE_IO_STATS;
 				break;
 
+			case OPT_ATTACH:	/* show the updates of a pg_top serving */
+				pgtctx->attach = optarg;
+				break;
+
+			case OPT_FORMAT:	/* write records rather than the display */
+				if ((pgtctx->output = output_init(optarg)) == -1)
+				{
+					fprintf(stderr,
+							"%s: '%s' is not a recognized format, try text, jsonl or csv\n",
+							progname, optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_RECORD:	/* record every update */
+				pgtctx->record = optarg;
+				break;
+
+			case OPT_REPLAY:	/* show the updates recorded */
+				pgtctx->replay = optarg;
+				break;
+
+			case OPT_SERVE:		/* sample for the pg_tops attached */
+				pgtctx->serve = optarg;
+				break;
+
 			default:
 				fprintf(stderr, "Try \"%s --help\" for more information.\n",
 						progname);
@@ -484,8 +874,17 @@ void
 process_commands(struct pg_top_context *pgtctx)
 {
 	int			no_command;
+	int			sampling;
 	fd_set		readfds;
 	char		ch;
+	struct timeval deadline,
+				delay,
+				now;
+
+	delay.tv_sec = pgtctx->delay;
+	delay.tv_usec = pgtctx->delay_usec;
+	gettimeofday(&now, NULL);
+	timeradd(&now, &delay, &deadline);
 
 	do
 	{
@@ -494,8 +893,14 @@ process_commands(struct pg_top_context *pgtctx)
 		/* set up arguments for select with timeout */
 		FD_ZERO(&readfds);
 		FD_SET(0, &readfds);	/* for standard input */
-		pgtctx->timeout.tv_sec = pgtctx->delay;
-		pgtctx->timeout.tv_usec = 0;
+		gettimeofday(&now, NULL);
+		if (timercmp(&now, &deadline, <))
+			timersub(&deadline, &now, &pgtctx->timeout);
+		else
+			timerclear(&pgtctx->timeout);
+
+		/* wake up in time for the next session history sample */
+		sampling = ash_timeout(&pgtctx->timeout);
 
 		/* wait for either input or the end of the delay period */
 		if (select(32, &readfds, (fd_set *) NULL, (fd_set *) NULL,
@@ -519,10 +924,64 @@ process_commands(struct pg_top_context *pgtctx)
 
 			/* flush out stuff that may have been written */
 			fflush(stdout);
+
+			/* wait the whole delay again after a command that did nothing */
+			if (no_command)
+			{
+				delay.tv_sec = pgtctx->delay;
+				delay.tv_usec = pgtctx->delay_usec;
+				gettimeofday(&now, NULL);
+				timeradd(&now, &delay, &deadline);
+			}
+		}
+		else if (sampling)
+		{
+			ash_sample();
+			no_command = Yes;
 		}
 	} while (no_command);
 }
 
+/*
+ *	mode_order_names() - the names of the sort orders of the current display,
+ *	or NULL if it cannot be sorted, and where the chosen order is kept.
+ */
+
+char	  **
+mode_order_names(struct pg_top_context *pgtctx, int **order_index)
+{
+	switch (pgtctx->mode)
+	{
+		case MODE_RELATIONS:
+			*order_index = &pgtctx->relation_order_index;
+			return relation_ordernames;
+		case MODE_REPLICATION:
+			*order_index = &pgtctx->replication_order_index;
+			return replication_ordernames;
+		case MODE_SLOTS:
+			*order_index = &pgtctx->slot_order_index;
+			return slot_ordernames;
+		case MODE_FLEET:
+			*order_index = &pgtctx->fleet_order_index;
+			return fleet_ordernames;
+		case MODE_PGBOUNCER:
+			*order_index = &pgtctx->pool_order_index;
+			return pool_ordernames;
+		case MODE_BLOCKING:
+		case MODE_PROGRESS:
+		case MODE_TOPOLOGY:
+			/* these displays have an order of their own */
+			*order_index = &pgtctx->order_index;
+			return NULL;
+		case MODE_STATEMENTS:
+			*order_index = &pgtctx->statement_order_index;
+			return statement_ordernames;
+		default:
+			*order_index = &pgtctx->order_index;
+			return pgtctx->statics.order_names;
+	}
+}
+
 /*
  *	reset_display() - reset all the display routine pointers so that entire
  *	screen will get redrawn.
@@ -538,6 +997,10 @@ reset_display(struct pg_top_context *pgtctx)
 	d_cpustates = i_cpustates;
 	d_memory = i_memory;
 	d_swap = i_swap;
+	d_diskstats = i_diskstats;
+	d_dbstats = i_dbstats;
+	d_walstats = i_walstats;
+	d_bgwstats = i_bgwstats;
 	d_message = i_message;
 	pgtctx->d_header = i_header;
 	d_process = i_process;
@@ -656,6 +1119,8 @@ main(int argc, char *argv[])
 	int			preset_argc = 0;
 	char	  **av;
 	int			ac;
+	char	  **order_names;
+	int		   *order_index;
 
 #ifndef FD_SET
 	/* FD_SET and friends are not present:	fake it */
@@ -671,18 +1136,32 @@ main(int argc, char *argv[])
 
 	/* initialize some selection options */
 	memset(&pgtctx, 0, sizeof(struct pg_top_context));
+	pgtctx.attach = NULL;
 #ifdef ENABLE_COLOR
 	pgtctx.color_on = 1;
 #endif
 	pgtctx.d_header = i_header;
 	pgtctx.delay = Default_DELAY;
+	pgtctx.delay_usec = 0;
 	pgtctx.displays = 0;		/* indicates unspecified */
+	pgtctx.fleet = NULL;
+	pgtctx.fleet_order_index = 0;
 	pgtctx.dostates = No;
 	pgtctx.do_unames = Yes;
 	pgtctx.interactive = Maybe;
 	pgtctx.mode = MODE_PROCESSES;
 	pgtctx.mode_remote = No;
 	pgtctx.order_index = -1;
+	pgtctx.output = OUTPUT_TEXT;
+	pgtctx.pgbouncer = NULL;
+	pgtctx.pool_order_index = 0;
+	pgtctx.relation_order_index = 0;
+	pgtctx.replication_order_index = 0;
+	pgtctx.slot_order_index = 0;
+	pgtctx.statement_order_index = 0;
+	pgtctx.record = NULL;
+	pgtctx.replay = NULL;
+	pgtctx.serve = NULL;
 	pgtctx.ps.idle = Yes;
 	pgtctx.ps.fullcmd = Yes;
 	pgtctx.ps.command = NULL;
@@ -691,6 +1170,9 @@ main(int argc, char *argv[])
 	pgtctx.topn = 0;
 	pgtctx.conninfo.connection = NULL;
 	pgtctx.conninfo.persistent = 0;
+	pgtctx.conninfo.keep = 0;
+	pgtctx.conninfo.held = 0;
+	pgtctx.conninfo.kept = NULL;
 
 	/* Show help or version number if necessary */
 	if (argc > 1)
@@ -803,32 +1285,143 @@ main(int argc, char *argv[])
 	color_env_parse(env_top);
 #endif
 
-	/* call the platform-specific init */
-	if (pgtctx.mode_remote == 0)
-		i = machine_init(&pgtctx.statics);
+	if (pgtctx.attach != NULL && pgtctx.serve != NULL)
+	{
+		fprintf(stderr, "%s: --attach and --serve cannot be used together\n",
+				myname);
+		exit(1);
+	}
+
+	if (pgtctx.replay != NULL &&
+		(pgtctx.attach != NULL || pgtctx.record != NULL ||
+		 pgtctx.serve != NULL))
+	{
+		fprintf(stderr,
+				"%s: --replay cannot be used with --attach, --record or --serve\n",
+				myname);
+		exit(1);
+	}
+
+	if (pgtctx.output != OUTPUT_TEXT)
+	{
+		if (pgtctx.attach != NULL || pgtctx.record != NULL ||
+			pgtctx.replay != NULL || pgtctx.serve != NULL)
+		{
+			fprintf(stderr,
+					"%s: --format cannot be used with --attach, --record, --replay or --serve\n",
+					myname);
+			exit(1);
+		}
+		if (pgtctx.mode != MODE_PROCESSES)
+		{
+			fprintf(stderr, "%s: --format only writes the process display\n",
+					myname);
+			exit(1);
+		}
+#if !defined(__linux__)
+		if (pgtctx.mode_remote == 0)
+		{
+			fprintf(stderr,
+					"%s: --format needs remote mode on this platform\n",
+					myname);
+			exit(1);
+		}
+#endif /* !defined(__linux__) */
+	}
+
+	/* attached, the pg_top serving does all the sampling */
+	if (pgtctx.attach != NULL)
+	{
+		if (attach_init(pgtctx.attach, &pgtctx.statics) == -1)
+			exit(1);
+	}
+	else if (pgtctx.replay != NULL)
+	{
+		if (replay_init(pgtctx.replay, &pgtctx.statics) == -1)
+			exit(1);
+
+		/* shown as they were sampled, from the display they were shown in */
+		pgtctx.mode_remote = replay_remote();
+		pgtctx.mode = replay_mode();
+		if (pgtctx.mode_remote != 0)
+			machine_replay_init_r(&pgtctx.statics);
+#if defined(__linux__)
+		else
+			machine_replay_init(&pgtctx.statics);
+#else
+		else
+		{
+			fprintf(stderr, "%s: %s was not recorded in remote mode\n",
+					myname, pgtctx.replay);
+			exit(1);
+		}
+#endif /* defined(__linux__) */
+	}
 	else
-		i = machine_init_r(&pgtctx.statics, &pgtctx.conninfo);
+	{
+		if (pgbouncer_init(pgtctx.pgbouncer, pgtctx.conninfo.values) == -1)
+			exit(1);
+
+		/*
+		 * Without a fleet, the fleet and topology displays show the one
+		 * server.  The other displays show the first server of a fleet until
+		 * told.
+		 */
+		if (fleet_init(pgtctx.fleet, pgtctx.conninfo.values) == -1)
+			exit(1);
+		if (pgtctx.fleet != NULL)
+			fleet_select(&pgtctx.conninfo, 0);
 
-	if (i == -1)
+		/* call the platform-specific init */
+		if (pgtctx.mode_remote == 0)
+			i = machine_init(&pgtctx.statics);
+		else
+			i = machine_init_r(&pgtctx.statics, &pgtctx.conninfo);
+
+		if (i == -1)
+			exit(1);
+	}
+
+	if (pgtctx.record != NULL &&
+		record_init(pgtctx.record, &pgtctx.statics, pgtctx.mode_remote) == -1)
 		exit(1);
 
+	/* serving, nothing is shown and there are no commands */
+	if (pgtctx.serve != NULL)
+	{
+		if (serve_init(pgtctx.serve, &pgtctx.statics, pgtctx.delay) == -1)
+			exit(1);
+		pgtctx.interactive = No;
+		if (pgtctx.displays == 0)
+			pgtctx.displays = Infinity;
+	}
+
+	/* writing records, there is no screen and they go on until stopped */
+	if (pgtctx.output != OUTPUT_TEXT)
+	{
+		pgtctx.interactive = No;
+		if (pgtctx.displays == 0)
+			pgtctx.displays = Infinity;
+	}
+
 	/* determine sorting order index, if necessary */
 	if (pgtctx.order_name != NULL)
 	{
-		if (pgtctx.statics.order_names == NULL)
+		order_names = mode_order_names(&pgtctx, &order_index);
+		if (order_names == NULL)
 		{
 			new_message(MT_standout | MT_delayed,
 						" This platform does not support arbitrary ordering");
 		}
-		else if ((pgtctx.order_index = string_index(pgtctx.order_name,
-													pgtctx.statics.order_names)) == -1)
+		else if ((*order_index = string_index(pgtctx.order_name,
+											  order_names)) == -1)
 		{
 			char	  **pp;
 
 			fprintf(stderr, "%s: '%s' is not a recognized sorting order.\n",
 					myname, pgtctx.order_name);
 			fprintf(stderr, "\tTry one of these:");
-			pp = pgtctx.statics.order_names;
+			pp = order_names;
 			while (*pp != NULL)
 			{
 				fprintf(stderr, " %s", *pp++);
@@ -852,11 +1445,29 @@ main(int argc, char *argv[])
 	pgtctx.header_options[0][MODE_IO_STATS] = fmt_header_io;
 #endif /* defined(__linux__) || defined(__FreeBSD__) */
 	pgtctx.header_options[0][MODE_REPLICATION] = fmt_header_replication;
+	pgtctx.header_options[0][MODE_ASH] = fmt_header_ash;
+	pgtctx.header_options[0][MODE_RELATIONS] = fmt_header_relations;
+	pgtctx.header_options[0][MODE_STATEMENTS] = fmt_header_statements;
+	pgtctx.header_options[0][MODE_BLOCKING] = fmt_header_blocking;
+	pgtctx.header_options[0][MODE_PROGRESS] = fmt_header_progress;
+	pgtctx.header_options[0][MODE_SLOTS] = fmt_header_slots;
+	pgtctx.header_options[0][MODE_FLEET] = fmt_header_fleet;
+	pgtctx.header_options[0][MODE_TOPOLOGY] = fmt_header_topology;
+	pgtctx.header_options[0][MODE_PGBOUNCER] = fmt_header_pgbouncer;
 
 	/* 1 corresponds to headers definitions when remotely connecting to pg */
 	pgtctx.header_options[1][MODE_PROCESSES] = format_header_r(uname_field);
 	pgtctx.header_options[1][MODE_IO_STATS] = fmt_header_io_r;
-	pgtctx.header_options[1][MODE_REPLICATION] = fmt_header_replication_r;
+	pgtctx.header_options[1][MODE_REPLICATION] = fmt_header_replication;
+	pgtctx.header_options[1][MODE_ASH] = fmt_header_ash;
+	pgtctx.header_options[1][MODE_RELATIONS] = fmt_header_relations;
+	pgtctx.header_options[1][MODE_STATEMENTS] = fmt_header_statements;
+	pgtctx.header_options[1][MODE_BLOCKING] = fmt_header_blocking;
+	pgtctx.header_options[1][MODE_PROGRESS] = fmt_header_progress;
+	pgtctx.header_options[1][MODE_SLOTS] = fmt_header_slots;
+	pgtctx.header_options[1][MODE_FLEET] = fmt_header_fleet;
+	pgtctx.header_options[1][MODE_TOPOLOGY] = fmt_header_topology;
+	pgtctx.header_options[1][MODE_PGBOUNCER] = fmt_header_pgbouncer;
 
 	/* get the string to use for the process area header */
 
@@ -915,8 +1526,13 @@ main(int argc, char *argv[])
 	/* if # of displays not specified, fill it in */
 	if (pgtctx.displays == 0)
 	{
-		pgtctx.displays = smart_terminal ? Infinity : 1;
+		if (pgtctx.replay != NULL && !pgtctx.interactive)
+			pgtctx.displays = replay_updates();
+		else
+			pgtctx.displays = smart_terminal ? Infinity : 1;
 	}
+	if (pgtctx.replay != NULL)
+		replay_start(pgtctx.interactive);
 
 	/* hold interrupt signals while setting up the screen and the handlers */
 #ifdef HAVE_SIGPROCMASK
@@ -986,7 +1602,8 @@ main(int argc, char *argv[])
 #endif
 
 	/* some systems require a warmup */
-	if (pgtctx.statics.flags.warmup)
+	if (pgtctx.statics.flags.warmup && pgtctx.attach == NULL &&
+		pgtctx.replay == NULL)
 	{
 		if (pgtctx.mode_remote == 0)
 		{
@@ -1008,6 +1625,11 @@ main(int argc, char *argv[])
 		/* if we've warmed up, then we can show good states too */
 		pgtctx.dostates = Yes;
 	}
+	else if (pgtctx.attach != NULL || pgtctx.replay != NULL)
+	{
+		/* the states were worked out when sampled */
+		pgtctx.dostates = Yes;
+	}
 
 	/*
 	 * main loop -- repeat while display count is positive or while it
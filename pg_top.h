@@ -85,11 +85,15 @@ enum pgparams
 
 struct pg_top_context
 {
+	char	   *attach;			/* file of the pg_top serving, or NULL */
 #ifdef ENABLE_COLOR
 	int			color_on;
 #endif
 	int			delay;
+	int			delay_usec;		/* and the fraction of a second */
 	int			displays;
+	char	   *fleet;			/* file listing the servers, or NULL */
+	int			fleet_order_index;
 	void		(*d_header) (char *);
 	char		do_unames;
 	char		dostates;
@@ -101,7 +105,17 @@ struct pg_top_context
 								 * system. */
 	int			order_index;
 	char	   *order_name;
+	int			output;			/* enum OutputFormat of --format */
+	char	   *pgbouncer;		/* settings for pgbouncer's admin console */
+	int			pool_order_index;
 	struct process_select ps;
+	char	   *record;			/* file to record updates in, or NULL */
+	int			relation_order_index;
+	char	   *replay;			/* recording to show, or NULL */
+	int			replication_order_index;
+	char	   *serve;			/* file to publish updates in, or NULL */
+	int			slot_order_index;
+	int			statement_order_index;
 	char		show_tags;
 	struct statics statics;
 	struct system_info system_info;
@@ -110,6 +124,7 @@ struct pg_top_context
 	struct pg_conninfo_ctx conninfo;
 };
 
+char	  **mode_order_names(struct pg_top_context *, int **);
 void		quit(int);
 void		reset_display(struct pg_top_context *);
 
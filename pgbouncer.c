@@ -0,0 +1,665 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * pgbouncer: the pools of a pgbouncer in front of the server, from its admin
+ * console.  Each pool shows its clients that are active and waiting for a
+ * server, how long the oldest has waited, and its server connections, from
+ * SHOW POOLS.  The transactions and queries per second, and how long each
+ * transaction waited for a server on average, come from the counters of SHOW
+ * STATS, which are kept per database, so every pool of a database shows the
+ * same.  A first line sums up SHOW CLIENTS: the clients by state, and the
+ * address the most waiting clients come from.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "delta.h"
+#include "display.h"
+#include "pgbouncer.h"
+#include "pg.h"
+#include "pg_top.h"
+#include "utils.h"
+
+/* the port pgbouncer listens on unless told otherwise */
+#define PGBOUNCER_PORT "6432"
+
+char		fmt_header_pgbouncer[] =
+"DATABASE         USER             MODE        CL_ACT CL_WAIT MAXWAIT SV_ACT SV_IDLE SV_USED  XACT/s QUERY/s AVGWAIT";
+
+/* the counters of a database kept from SHOW STATS, -1 if unknown */
+enum PoolStat
+{
+	POOL_XACTS,
+	POOL_QUERIES,
+	POOL_WAIT,					/* microseconds */
+	POOL_STATS
+};
+
+/* the counters of a database, from SHOW STATS */
+struct pool_db
+{
+	RB_ENTRY(pool_db) entry;
+	char	   *name;
+
+	/* the last sample this database was seen in */
+	unsigned int sample;
+
+	struct delta_stats stats;
+
+	double		xact_rate;		/* -1 if unknown */
+	double		query_rate;		/* -1 if unknown */
+	double		avg_wait;		/* seconds, or -1 if unknown */
+};
+
+/* a pool, from SHOW POOLS */
+struct pool
+{
+	char	   *database;
+	char	   *user;
+	char	   *mode;
+	long long	cl_active;		/* -1 if unknown */
+	long long	cl_waiting;		/* -1 if unknown */
+	long long	sv_active;		/* -1 if unknown */
+	long long	sv_idle;		/* -1 if unknown */
+	long long	sv_used;		/* -1 if unknown */
+	double		maxwait;		/* seconds, or -1 if unknown */
+	struct pool_db *db;			/* NULL if not in SHOW STATS */
+};
+
+int			pool_dbcmp(struct pool_db *, struct pool_db *);
+
+RB_HEAD(pooldb, pool_db) head_pool_db = RB_INITIALIZER(&head_pool_db);
+RB_PROTOTYPE(pooldb, pool_db, entry, pool_dbcmp)
+RB_GENERATE(pooldb, pool_db, entry, pool_dbcmp)
+
+static int	compare_maxwait(const void *, const void *);
+static int	compare_pool(const void *, const void *);
+static int	compare_queries(const void *, const void *);
+static int	compare_waiting(const void *, const void *);
+static int	compare_xacts(const void *, const void *);
+
+char	   *pool_ordernames[] = {
+	"waiting", "maxwait", "xacts", "queries", "pool", NULL
+};
+
+int			(*pool_compares[]) () =
+{
+	compare_waiting,
+		compare_maxwait,
+		compare_xacts,
+		compare_queries,
+		compare_pool,
+		NULL
+};
+
+/* the admin console, kept open between updates */
+static PGconn *bouncer_conn = NULL;
+static const char **bouncer_keywords;
+static const char **bouncer_values;
+
+/* SHOW POOLS, kept until the next update for the strings in pooltable */
+static PGresult *pools_result = NULL;
+static struct pool *pooltable;
+static int	pooltable_size;
+static int	npools;
+static int	pool_index;
+
+/* SHOW CLIENTS summed up */
+static char summary[MAX_COLS];
+static char **waiting_addrs;
+static int	waiting_addrs_size;
+
+static unsigned int sample;
+
+int
+pool_dbcmp(struct pool_db *e1, struct pool_db *e2)
+{
+	return strcmp(e1->name, e2->name);
+}
+
+static void *
+pgbouncer_alloc(void *p, size_t nmemb, size_t size)
+{
+	if ((p = reallocarray(p, nmemb, size)) == NULL)
+	{
+		fprintf(stderr, "reallocarray error\n");
+		exit(1);
+	}
+	return p;
+}
+
+/*
+ * Keep the settings to connect to the admin console with: the ones given with
+ * --pgbouncer, and for what they do not set, the host, user and password
+ * given on the command line, port 6432 and the pgbouncer database.  A service
+ * takes all its settings from the service file.  The command line settings
+ * are copied, since they are not kept for persistent connections.
+ */
+int
+pgbouncer_init(char *conninfo, const char **defaults)
+{
+	static const int default_params[] = {PG_HOST, PG_USER, PG_PASSWORD};
+	static const char *default_keywords[] = {"host", "user", "password"};
+	PQconninfoOption *options,
+			   *option;
+	char	   *errmsg = NULL;
+	int			set[3] = {0, 0, 0};
+	int			port = 0;
+	int			dbname = 0;
+	int			service = 0;
+	int			i = 0,
+				j;
+
+	if (conninfo == NULL)
+		conninfo = "";
+	if ((options = PQconninfoParse(conninfo, &errmsg)) == NULL)
+	{
+		fprintf(stderr, "%s: %s", conninfo, errmsg != NULL ? errmsg :
+				"out of memory\n");
+		PQfreemem(errmsg);
+		return -1;
+	}
+
+	for (option = options; option->keyword != NULL; option++)
+		i++;
+	bouncer_keywords = pgbouncer_alloc(NULL, i + 6, sizeof(char *));
+	bouncer_values = pgbouncer_alloc(NULL, i + 6, sizeof(char *));
+
+	/* the options are kept for as long as the settings are */
+	i = 0;
+	for (option = options; option->keyword != NULL; option++)
+	{
+		if (option->val == NULL)
+			continue;
+		for (j = 0; j < 3; j++)
+			if (strcmp(option->keyword, default_keywords[j]) == 0)
+				set[j] = 1;
+		if (strcmp(option->keyword, "port") == 0)
+			port = 1;
+		else if (strcmp(option->keyword, "dbname") == 0)
+			dbname = 1;
+		else if (strcmp(option->keyword, "service") == 0)
+			service = 1;
+		bouncer_keywords[i] = option->keyword;
+		bouncer_values[i++] = option->val;
+	}
+
+	if (!service)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			if (set[j] || defaults[default_params[j]] == NULL)
+				continue;
+			bouncer_keywords[i] = default_keywords[j];
+			bouncer_values[i] = strdup(defaults[default_params[j]]);
+			if (bouncer_values[i++] == NULL)
+			{
+				fprintf(stderr, "strdup error\n");
+				exit(1);
+			}
+		}
+		if (!port)
+		{
+			bouncer_keywords[i] = "port";
+			bouncer_values[i++] = PGBOUNCER_PORT;
+		}
+		if (!dbname)
+		{
+			bouncer_keywords[i] = "dbname";
+			bouncer_values[i++] = "pgbouncer";
+		}
+	}
+	bouncer_keywords[i] = NULL;
+	bouncer_values[i] = NULL;
+
+	return 0;
+}
+
+/* Connect to the admin console, unless it still is.  Returns -1 if not. */
+static int
+pgbouncer_connect(void)
+{
+	if (bouncer_conn != NULL && PQstatus(bouncer_conn) == CONNECTION_OK)
+		return 0;
+
+	PQfinish(bouncer_conn);
+	bouncer_conn = PQconnectdbParams(bouncer_keywords, bouncer_values, 0);
+	if (PQstatus(bouncer_conn) != CONNECTION_OK)
+	{
+		new_message(MT_standout | MT_delayed, " %s",
+					PQerrorMessage(bouncer_conn));
+		PQfinish(bouncer_conn);
+		bouncer_conn = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Whether a SHOW command answered.  If not, the error is shown, and the
+ * connection is dropped if it was lost, to be made again in the next update.
+ */
+static int
+pgbouncer_answered(PGresult *pgresult)
+{
+	if (PQresultStatus(pgresult) == PGRES_TUPLES_OK)
+		return 1;
+
+	new_message(MT_standout | MT_delayed, " %s",
+				pgresult != NULL ? PQresultErrorMessage(pgresult) :
+				PQerrorMessage(bouncer_conn));
+	if (PQstatus(bouncer_conn) != CONNECTION_OK)
+	{
+		PQfinish(bouncer_conn);
+		bouncer_conn = NULL;
+	}
+	return 0;
+}
+
+static long long
+get_count(PGresult *pgresult, int row, int column)
+{
+	if (column < 0 || PQgetisnull(pgresult, row, column))
+		return -1;
+	return strtoll(PQgetvalue(pgresult, row, column), NULL, 10);
+}
+
+static char *
+get_string(PGresult *pgresult, int row, int column)
+{
+	if (column < 0)
+		return "";
+	return PQgetvalue(pgresult, row, column);
+}
+
+static void
+update_stats(PGresult *pgresult)
+{
+	struct pool_db *n,
+			   *p,
+			   *tmp;
+	int			database = PQfnumber(pgresult, "database");
+	int			xacts = PQfnumber(pgresult, "total_xact_count");
+	int			queries = PQfnumber(pgresult, "total_query_count");
+	int			wait = PQfnumber(pgresult, "total_wait_time");
+	int			rows = PQntuples(pgresult);
+	double		delta[POOL_STATS];
+	double		seconds;
+	double	   *value;
+	int			i;
+
+	for (i = 0; i < rows && database >= 0; i++)
+	{
+		n = malloc(sizeof(struct pool_db));
+		if (n == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			exit(1);
+		}
+		memset(n, 0, sizeof(struct pool_db));
+		n->name = PQgetvalue(pgresult, i, database);
+		p = RB_INSERT(pooldb, &head_pool_db, n);
+		if (p != NULL)
+		{
+			free(n);
+			n = p;
+		}
+		else
+		{
+			n->name = strdup(n->name);
+		}
+		n->sample = sample;
+
+		value = delta_next(&n->stats);
+		value[POOL_XACTS] = get_count(pgresult, i, xacts);
+		value[POOL_QUERIES] = get_count(pgresult, i, queries);
+		value[POOL_WAIT] = get_count(pgresult, i, wait);
+
+		/* counters go back to zero when pgbouncer restarts */
+		n->xact_rate = -1;
+		n->query_rate = -1;
+		n->avg_wait = -1;
+		if ((seconds = delta_diff(&n->stats, delta, POOL_STATS)) == 0)
+			continue;
+		if (delta[POOL_XACTS] >= 0)
+			n->xact_rate = delta[POOL_XACTS] / seconds;
+		if (delta[POOL_QUERIES] >= 0)
+			n->query_rate = delta[POOL_QUERIES] / seconds;
+
+		/* the time waited for a server by the transactions since the last */
+		if (delta[POOL_WAIT] >= 0 && delta[POOL_XACTS] > 0)
+			n->avg_wait = delta[POOL_WAIT] / 1e6 / delta[POOL_XACTS];
+	}
+
+	/* forget the databases that were removed */
+	RB_FOREACH_SAFE(n, pooldb, &head_pool_db, tmp)
+	{
+		if (n->sample != sample)
+		{
+			RB_REMOVE(pooldb, &head_pool_db, n);
+			free(n->name);
+			free(n);
+		}
+	}
+}
+
+static void
+update_pools(PGresult *pgresult)
+{
+	struct pool_db find;
+	struct pool *p;
+	int			database = PQfnumber(pgresult, "database");
+	int			user = PQfnumber(pgresult, "user");
+	int			mode = PQfnumber(pgresult, "pool_mode");
+	int			cl_active = PQfnumber(pgresult, "cl_active");
+	int			cl_waiting = PQfnumber(pgresult, "cl_waiting");
+	int			sv_active = PQfnumber(pgresult, "sv_active");
+	int			sv_idle = PQfnumber(pgresult, "sv_idle");
+	int			sv_used = PQfnumber(pgresult, "sv_used");
+	int			maxwait = PQfnumber(pgresult, "maxwait");
+	int			maxwait_us = PQfnumber(pgresult, "maxwait_us");
+	long long	us;
+	int			i;
+
+	npools = PQntuples(pgresult);
+	if (npools > pooltable_size)
+	{
+		pooltable = pgbouncer_alloc(pooltable, npools, sizeof(struct pool));
+		pooltable_size = npools;
+	}
+
+	for (i = 0; i < npools; i++)
+	{
+		p = &pooltable[i];
+		p->database = get_string(pgresult, i, database);
+		p->user = get_string(pgresult, i, user);
+		p->mode = get_string(pgresult, i, mode);
+		p->cl_active = get_count(pgresult, i, cl_active);
+		p->cl_waiting = get_count(pgresult, i, cl_waiting);
+		p->sv_active = get_count(pgresult, i, sv_active);
+		p->sv_idle = get_count(pgresult, i, sv_idle);
+		p->sv_used = get_count(pgresult, i, sv_used);
+
+		/* maxwait is in whole seconds, with the rest in maxwait_us */
+		p->maxwait = get_count(pgresult, i, maxwait);
+		if (p->maxwait >= 0 && (us = get_count(pgresult, i, maxwait_us)) > 0)
+			p->maxwait += us / 1e6;
+
+		find.name = p->database;
+		p->db = RB_FIND(pooldb, &head_pool_db, &find);
+	}
+}
+
+static int
+compare_addr(const void *v1, const void *v2)
+{
+	return strcmp(*(char **) v1, *(char **) v2);
+}
+
+static void
+update_summary(PGresult *pgresult)
+{
+	int			state = PQfnumber(pgresult, "state");
+	int			addr = PQfnumber(pgresult, "addr");
+	int			rows = PQntuples(pgresult);
+	int			active = 0,
+				waiting = 0,
+				other = 0;
+	int			most = 0,
+				run,
+				i;
+	char	   *s;
+	char	   *most_addr = NULL;
+	int			len;
+
+	if (rows > waiting_addrs_size)
+	{
+		waiting_addrs = pgbouncer_alloc(waiting_addrs, rows, sizeof(char *));
+		waiting_addrs_size = rows;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		s = get_string(pgresult, i, state);
+		if (strncmp(s, "waiting", 7) == 0)
+			waiting_addrs[waiting++] = get_string(pgresult, i, addr);
+		else if (strncmp(s, "active", 6) == 0)
+			active++;
+		else
+			other++;
+	}
+
+	qsort(waiting_addrs, waiting, sizeof(char *), compare_addr);
+	for (i = 0; i < waiting; i += run)
+	{
+		for (run = 1; i + run < waiting &&
+			 strcmp(waiting_addrs[i], waiting_addrs[i + run]) == 0; run++)
+			;
+		if (run > most)
+		{
+			most = run;
+			most_addr = waiting_addrs[i];
+		}
+	}
+
+	len = snprintf(summary, sizeof(summary),
+				   "Clients: %d active, %d waiting, %d other",
+				   active, waiting, other);
+	if (most_addr != NULL && len < (int) sizeof(summary))
+		snprintf(summary + len, sizeof(summary) - len,
+				 "; most waiting from %s (%d)", printable(most_addr), most);
+}
+
+/*
+ * Sample the admin console and put the pools in order by compare_index.
+ */
+caddr_t
+get_pgbouncer_info(struct system_info *si, int compare_index)
+{
+	PGresult   *pgresult;
+
+	++sample;
+
+	PQclear(pools_result);
+	pools_result = NULL;
+	npools = 0;
+	summary[0] = '\0';
+
+	if (pgbouncer_connect() == 0)
+	{
+		pgresult = pg_pgbouncer_stats(bouncer_conn);
+		if (pgbouncer_answered(pgresult))
+			update_stats(pgresult);
+		PQclear(pgresult);
+	}
+	if (bouncer_conn != NULL)
+	{
+		pools_result = pg_pgbouncer_pools(bouncer_conn);
+		if (pgbouncer_answered(pools_result))
+			update_pools(pools_result);
+	}
+	if (bouncer_conn != NULL)
+	{
+		pgresult = pg_pgbouncer_clients(bouncer_conn);
+		if (pgbouncer_answered(pgresult))
+			update_summary(pgresult);
+		PQclear(pgresult);
+	}
+
+	if (compare_index >= 0 && npools > 0)
+		qsort(pooltable, npools, sizeof(struct pool),
+			  pool_compares[compare_index]);
+
+	/* the summary is shown first */
+	si->P_ACTIVE = summary[0] != '\0' ? npools + 1 : npools;
+	pool_index = summary[0] != '\0' ? -1 : 0;
+	return (caddr_t) 0;
+}
+
+/* Seconds waited, in milliseconds when under one. */
+static char *
+format_wait(char *buf, size_t size, double seconds)
+{
+	if (seconds < 0)
+		buf[0] = '\0';
+	else if (seconds < 1)
+		snprintf(buf, size, "%.0fms", seconds * 1000);
+	else if (seconds < 60)
+		snprintf(buf, size, "%.2fs", seconds);
+	else
+		snprintf(buf, size, "%s", format_time((long) seconds));
+	return buf;
+}
+
+static char *
+format_count(char *buf, size_t size, long long count)
+{
+	if (count < 0)
+		buf[0] = '\0';
+	else
+		snprintf(buf, size, "%lld", count);
+	return buf;
+}
+
+char *
+format_next_pgbouncer(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		cl_active[16];
+	char		cl_waiting[16];
+	char		maxwait[16];
+	char		sv_active[16];
+	char		sv_idle[16];
+	char		sv_used[16];
+	char		xacts[16];
+	char		queries[16];
+	char		avg_wait[16];
+	struct pool *p;
+
+	if (pool_index++ < 0)
+		return summary;
+	p = &pooltable[pool_index - 1];
+
+	xacts[0] = queries[0] = avg_wait[0] = '\0';
+	if (p->db != NULL)
+	{
+		if (p->db->xact_rate >= 0)
+			snprintf(xacts, sizeof(xacts), "%s", format_n(p->db->xact_rate));
+		if (p->db->query_rate >= 0)
+			snprintf(queries, sizeof(queries), "%s",
+					 format_n(p->db->query_rate));
+		format_wait(avg_wait, sizeof(avg_wait), p->db->avg_wait);
+	}
+
+	snprintf(fmt, sizeof(fmt),
+			 "%-16.16s %-16.16s %-11.11s %6s %7s %7s %6s %7s %7s %7s %7s %7s",
+			 printable(p->database),
+			 printable(p->user),
+			 p->mode,
+			 format_count(cl_active, sizeof(cl_active), p->cl_active),
+			 format_count(cl_waiting, sizeof(cl_waiting), p->cl_waiting),
+			 format_wait(maxwait, sizeof(maxwait), p->maxwait),
+			 format_count(sv_active, sizeof(sv_active), p->sv_active),
+			 format_count(sv_idle, sizeof(sv_idle), p->sv_idle),
+			 format_count(sv_used, sizeof(sv_used), p->sv_used),
+			 xacts,
+			 queries,
+			 avg_wait);
+
+	return (fmt);
+}
+
+/*
+ * Comparison routines for qsort, largest first.  What is not known sorts
+ * last.
+ */
+
+#define XACTS(p) ((p)->db != NULL ? (p)->db->xact_rate : -1)
+#define QUERIES(p) ((p)->db != NULL ? (p)->db->query_rate : -1)
+
+#define ORDERKEY_WAITING if ((result = (p2->cl_waiting > p1->cl_waiting) - \
+                                       (p2->cl_waiting < p1->cl_waiting)) == 0)
+#define ORDERKEY_MAXWAIT if ((result = (p2->maxwait > p1->maxwait) - \
+                                       (p2->maxwait < p1->maxwait)) == 0)
+#define ORDERKEY_XACTS   if ((result = (XACTS(p2) > XACTS(p1)) - \
+                                       (XACTS(p2) < XACTS(p1))) == 0)
+#define ORDERKEY_QUERIES if ((result = (QUERIES(p2) > QUERIES(p1)) - \
+                                       (QUERIES(p2) < QUERIES(p1))) == 0)
+#define ORDERKEY_POOL    if ((result = strcmp(p1->database, p2->database)) == 0 && \
+                             (result = strcmp(p1->user, p2->user)) == 0)
+
+static int
+compare_maxwait(const void *v1, const void *v2)
+{
+	struct pool *p1 = (struct pool *) v1;
+	struct pool *p2 = (struct pool *) v2;
+	int			result;
+
+	ORDERKEY_MAXWAIT
+		ORDERKEY_WAITING
+		ORDERKEY_POOL
+		;
+
+	return (result);
+}
+
+static int
+compare_pool(const void *v1, const void *v2)
+{
+	struct pool *p1 = (struct pool *) v1;
+	struct pool *p2 = (struct pool *) v2;
+	int			result;
+
+	ORDERKEY_POOL
+		;
+
+	return (result);
+}
+
+static int
+compare_queries(const void *v1, const void *v2)
+{
+	struct pool *p1 = (struct pool *) v1;
+	struct pool *p2 = (struct pool *) v2;
+	int			result;
+
+	ORDERKEY_QUERIES
+		ORDERKEY_XACTS
+		ORDERKEY_POOL
+		;
+
+	return (result);
+}
+
+static int
+compare_waiting(const void *v1, const void *v2)
+{
+	struct pool *p1 = (struct pool *) v1;
+	struct pool *p2 = (struct pool *) v2;
+	int			result;
+
+	ORDERKEY_WAITING
+		ORDERKEY_MAXWAIT
+		ORDERKEY_XACTS
+		ORDERKEY_POOL
+		;
+
+	return (result);
+}
+
+static int
+compare_xacts(const void *v1, const void *v2)
+{
+	struct pool *p1 = (struct pool *) v1;
+	struct pool *p2 = (struct pool *) v2;
+	int			result;
+
+	ORDERKEY_XACTS
+		ORDERKEY_QUERIES
+		ORDERKEY_POOL
+		;
+
+	return (result);
+}
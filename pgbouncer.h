@@ -0,0 +1,15 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _PGBOUNCER_H_
+#define _PGBOUNCER_H_
+
+#include "machine.h"
+
+int			pgbouncer_init(char *, const char **);
+caddr_t		get_pgbouncer_info(struct system_info *, int);
+char	   *format_next_pgbouncer(caddr_t);
+
+extern char fmt_header_pgbouncer[];
+extern char *pool_ordernames[];
+
+#endif							/* _PGBOUNCER_H_ */
@@ -0,0 +1,276 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Progress of long running commands: how far VACUUM, CLUSTER, CREATE INDEX,
+ * ANALYZE, COPY and base backups are, from the pg_stat_progress views, how
+ * fast they are going, and when they should be done at that speed.
+ *
+ * The rate is smoothed over the samples of the same phase of a command, so
+ * that the estimated time remaining does not jump with every update.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "display.h"
+#include "progress.h"
+#include "pg.h"
+#include "utils.h"
+
+char		fmt_header_progress[] =
+"    PID COMMAND          PHASE                     %DONE     RATE    ETA   TIME RELATION";
+
+struct progress
+{
+	RB_ENTRY(progress) entry;
+	int			pid;
+
+	/* the last sample this command was seen in */
+	unsigned int sample;
+
+	char	   *command;
+	char	   *phase;
+	char	   *relation;
+	int			bytes;			/* whether the amounts are bytes or tuples */
+	long long	done;
+	long long	total;			/* 0 if unknown */
+	double		elapsed;
+	double		rate;			/* smoothed, per second, or -1 if unknown */
+	double		eta;			/* seconds, or -1 if unknown */
+};
+
+int			progresscmp(struct progress *, struct progress *);
+
+RB_HEAD(pgprogress, progress) head_progress = RB_INITIALIZER(&head_progress);
+RB_PROTOTYPE(pgprogress, progress, entry, progresscmp)
+RB_GENERATE(pgprogress, progress, entry, progresscmp)
+
+static struct progress **progresstable;
+static int	progresstable_size;
+static int	progress_index;
+static unsigned int sample;
+static struct timeval lasttime;
+
+int
+progresscmp(struct progress *e1, struct progress *e2)
+{
+	return (e1->pid < e2->pid ? -1 : e1->pid > e2->pid);
+}
+
+/* longest running first */
+static int
+compare_elapsed(const void *v1, const void *v2)
+{
+	struct progress *p1 = *(struct progress **) v1;
+	struct progress *p2 = *(struct progress **) v2;
+	int			result;
+
+	if ((result = (p2->elapsed > p1->elapsed) -
+		 (p2->elapsed < p1->elapsed)) == 0)
+		result = (p1->pid > p2->pid) - (p1->pid < p2->pid);
+	return result;
+}
+
+static int
+changed(char *old, char *new)
+{
+	return old == NULL || strcmp(old, new) != 0;
+}
+
+/*
+ * Sample the progress of the running commands and estimate when each will be
+ * done.
+ */
+caddr_t
+get_progress_info(struct system_info *si, struct pg_conninfo_ctx *conninfo)
+{
+	struct timeval thistime;
+	double		timediff;
+	double		rate;
+	struct progress *n,
+			   *p,
+			   *tmp;
+	PGresult   *pgresult = NULL;
+	long long	done;
+	int			rows = 0;
+	int			i;
+	char	   *command,
+			   *phase,
+			   *relation;
+
+	/* calculate the time difference since our last check */
+	gettimeofday(&thistime, 0);
+	if (lasttime.tv_sec)
+	{
+		timediff = ((thistime.tv_sec - lasttime.tv_sec) +
+					(thistime.tv_usec - lasttime.tv_usec) * 1e-6);
+	}
+	else
+	{
+		timediff = 0;
+	}
+	lasttime = thistime;
+	++sample;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_progress(conninfo->connection);
+		if (pgresult == NULL)
+		{
+			new_message(MT_standout | MT_delayed,
+						" Progress needs PostgreSQL 9.6 or later");
+		}
+		else if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+		{
+			new_message(MT_standout | MT_delayed, " %s",
+						PQresultErrorMessage(pgresult));
+		}
+		else
+		{
+			rows = PQntuples(pgresult);
+		}
+	}
+
+	if (rows > progresstable_size)
+	{
+		progresstable = reallocarray(progresstable, rows,
+									 sizeof(struct progress *));
+		if (progresstable == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		progresstable_size = rows;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		n = malloc(sizeof(struct progress));
+		if (n == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		memset(n, 0, sizeof(struct progress));
+		n->pid = atoi(PQgetvalue(pgresult, i, PROGRESS_PID));
+		p = RB_INSERT(pgprogress, &head_progress, n);
+		if (p != NULL)
+		{
+			free(n);
+			n = p;
+		}
+		n->sample = sample;
+		progresstable[i] = n;
+
+		command = PQgetvalue(pgresult, i, PROGRESS_COMMAND);
+		phase = PQgetvalue(pgresult, i, PROGRESS_PHASE);
+		relation = PQgetvalue(pgresult, i, PROGRESS_RELATION);
+		done = strtoll(PQgetvalue(pgresult, i, PROGRESS_DONE), NULL, 10);
+
+		/*
+		 * How fast one phase goes says nothing about the next, so the rate is
+		 * only known from the second sample of the same phase.
+		 */
+		if (p == NULL || changed(n->command, command) ||
+			changed(n->phase, phase) || changed(n->relation, relation) ||
+			done < n->done || timediff <= 0)
+		{
+			n->rate = -1;
+		}
+		else
+		{
+			rate = (done - n->done) / timediff;
+			if (n->rate < 0)
+				n->rate = rate;
+			else
+				n->rate += (rate - n->rate) * timediff /
+					(timediff + PROGRESS_SMOOTHING);
+		}
+
+		update_str(&n->command, command);
+		update_str(&n->phase, phase);
+		update_str(&n->relation, relation);
+		n->done = done;
+		n->total = strtoll(PQgetvalue(pgresult, i, PROGRESS_TOTAL), NULL, 10);
+		n->bytes = strcmp(PQgetvalue(pgresult, i, PROGRESS_UNIT), "bytes") == 0;
+		n->elapsed = atof(PQgetvalue(pgresult, i, PROGRESS_ELAPSED));
+
+		if (n->total > 0 && n->rate > 0 && n->done <= n->total)
+			n->eta = (n->total - n->done) / n->rate;
+		else
+			n->eta = -1;
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+	disconnect_from_db(conninfo);
+
+	/* forget the commands that finished */
+	RB_FOREACH_SAFE(n, pgprogress, &head_progress, tmp)
+	{
+		if (n->sample != sample)
+		{
+			RB_REMOVE(pgprogress, &head_progress, n);
+			free(n->command);
+			free(n->phase);
+			free(n->relation);
+			free(n);
+		}
+	}
+
+	if (rows > 0)
+		qsort(progresstable, rows, sizeof(struct progress *), compare_elapsed);
+
+	si->P_ACTIVE = rows;
+	progress_index = 0;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_progress(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		pct[8];
+	char		rate[16];
+	char		eta[10];
+	struct progress *p = progresstable[progress_index++];
+
+	if (p->total > 0)
+		snprintf(pct, sizeof(pct), "%5.1f",
+				 p->done < p->total ? p->done * 100.0 / p->total : 100.0);
+	else
+		pct[0] = '\0';
+
+	/* tuples are told apart from bytes with a "t" */
+	if (p->rate < 0)
+		rate[0] = '\0';
+	else if (p->bytes)
+		snprintf(rate, sizeof(rate), "%s/s", format_b((long long) p->rate));
+	else
+		snprintf(rate, sizeof(rate), "%st/s", format_n(p->rate));
+
+	/* format_time() returns the same area every time */
+	if (p->eta >= 0)
+		snprintf(eta, sizeof(eta), "%s", format_time((long) p->eta));
+	else
+		eta[0] = '\0';
+
+	snprintf(fmt, sizeof(fmt),
+			 "%7d %-16.16s %-25.25s %5s %8s %6s %6s %s",
+			 p->pid,
+			 p->command,
+			 p->phase,
+			 pct,
+			 rate,
+			 eta,
+			 format_time((long) p->elapsed),
+			 p->relation);
+
+	return (fmt);
+}
@@ -0,0 +1,19 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _PROGRESS_H_
+#define _PROGRESS_H_
+
+#include "machine.h"
+
+/*
+ * Seconds over which the rate of progress is smoothed: a new sample counts as
+ * much as all the ones before it when it covers this much time.
+ */
+#define PROGRESS_SMOOTHING 30
+
+caddr_t		get_progress_info(struct system_info *, struct pg_conninfo_ctx *);
+char	   *format_next_progress(caddr_t);
+
+extern char fmt_header_progress[];
+
+#endif							/* _PROGRESS_H_ */
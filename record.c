@@ -0,0 +1,1483 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Recording: every update is appended to a file as it is sampled, for
+ * --replay to show again later, with the updates in between skipped over,
+ * paused on or stepped through, faster or slower than they happened.
+ *
+ * What is recorded are the rows the displays are made from, not the lines
+ * they were shown as: the processes, the standbys and the sessions waiting on
+ * locks of every update, whichever display was shown, so that a replay puts
+ * them in order and shows them in any of those displays.  Only the other
+ * displays are kept as their lines, while they are shown.
+ *
+ * The file is a header followed by records, each a type and a length, kept
+ * aligned so that the file is read straight from a mapping.  Every string,
+ * such as a user name, a query or a line, is written once, numbered in the
+ * order written, and rows refer to it by number.  A row only has the fields
+ * that changed since the row with the same key, its first field, in the
+ * update before, with a bit for each field saying which.  The numbers of the
+ * header lines are kept as the bytes that changed since the update before.
+ * Every RECORD_KEYFRAME updates one is kept whole, so that seeking only has
+ * to go back that far.
+ */
+
+#include "os.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "blocking.h"
+#include "delta.h"
+#include "display.h"
+#include "record.h"
+#include "remote.h"
+#include "replication.h"
+#include "serve.h"
+#include "pg.h"
+#include "utils.h"
+
+#define RECORD_MAGIC "pg_top record 2"
+
+/* the records start on these boundaries */
+#define RECORD_ALIGN 8
+#define ALIGN_TO(n, a) (((n) + (a) - 1) & ~((size_t) (a) - 1))
+
+/*
+ * Strings not used for this many updates are forgotten when recording, and
+ * written again should they come back, so that hours of recording do not
+ * keep every query ever run.
+ */
+#define INTERN_UPDATES 16
+
+/* changes to the header numbers closer than this are kept as one */
+#define INFO_GAP 8
+
+enum RecordType
+{
+	RECORD_STRING = 1,			/* numbered in the order written */
+	RECORD_UPDATE
+};
+
+/* the tables of rows of an update */
+enum RecordTable
+{
+	TABLE_PROCESSES,
+	TABLE_STANDBYS,
+	TABLE_RECOVERY,				/* the lines shown before the standbys */
+	TABLE_LOCKS,
+	TABLE_SUMMARY,				/* the line shown before the locks */
+	TABLE_LINES,				/* of a display kept as its lines */
+	RECORD_TABLES
+};
+
+/*
+ * The fields of the rows of each table, 64 bits each, the key first.
+ * Strings are their number plus one, or 0 for none, and doubles their bits.
+ */
+enum ProcessField
+{
+	PF_PID,
+	PF_USENAME,
+	PF_NAME,
+	PF_TYPE,
+	PF_STATE,
+	PF_SIZE,
+	PF_RSS,
+	PF_XTIME,
+	PF_QTIME,
+	PF_LOCKS,
+	PF_CPU,
+	PF_RUNQ,
+	PF_INTERVAL,
+	PF_COUNTER,
+	PROCESS_FIELDS = PF_COUNTER + PROCESS_COUNTERS
+};
+
+enum StandbyField
+{
+	SF_PID,
+	SF_USENAME,
+	SF_APPLICATION,
+	SF_CLIENT,
+	SF_STATE,
+	SF_RATED,
+	SF_RATE,
+	SF_ETA,
+	SF_LSN,
+	SF_LAGTIME = SF_LSN + NLSNS,
+	STANDBY_FIELDS = SF_LAGTIME + NLAGTIMES
+};
+
+enum LockField
+{
+	LF_PID,
+	LF_DEPTH,
+	LF_NBLOCKERS,
+	LF_BLOCKS,
+	LF_WAIT,
+	LF_MODE,
+	LF_RELATION,
+	LF_STATE,
+	LF_QUERY,
+	LOCK_FIELDS
+};
+
+/* a line is keyed by where it is shown */
+enum LineField
+{
+	LINE_POSITION,
+	LINE_TEXT,
+	LINE_FIELDS
+};
+
+/* most fields of a row, one bit each in the mask before it */
+#define MAX_FIELDS 32
+
+static const int table_fields[RECORD_TABLES] = {
+	PROCESS_FIELDS, STANDBY_FIELDS, LINE_FIELDS, LOCK_FIELDS, LINE_FIELDS,
+	LINE_FIELDS
+};
+
+struct record_header
+{
+	char		magic[16];
+	int			info_size;		/* sizeof(struct serve_info) */
+	int			keyframe;
+	int			remote;			/* whether the processes were sampled remotely */
+	struct serve_statics statics;
+};
+
+struct record_head
+{
+	uint32_t	type;
+	uint32_t	length;			/* not counting what aligns the next */
+};
+
+/*
+ * An update is followed by the changes to the header numbers, each the bytes
+ * to skip and to copy, as uint16_t, and the bytes copied, then the rows of
+ * each table.  A row is a mask of the fields it has, bit 0 for the key, and
+ * those fields.  Without a key, it is the row in the same place in the update
+ * before.  Kept whole, a row has every field that is not zero.
+ */
+struct record_update
+{
+	int64_t		usec;			/* when it was sampled, since the epoch */
+	int32_t		mode;			/* the display shown */
+	uint32_t	whole;
+	uint32_t	info_length;	/* bytes of changes to the header numbers */
+	uint32_t	nrows[RECORD_TABLES];
+	uint32_t	length[RECORD_TABLES];	/* bytes of the rows of each table */
+};
+
+/* the rows of a table in an update, and in the update before it */
+struct record_rows
+{
+	uint64_t   *fields[2];		/* table_fields[] of them a row */
+	int			nrows[2];
+	int			size[2];
+	int			this;
+	int		   *order;			/* the rows before, by key and place */
+	int			order_size;
+	int			sorted;
+};
+
+/* a string recently recorded */
+struct interned
+{
+	RB_ENTRY(interned) entry;
+	char	   *text;
+	uint32_t	id;
+	unsigned long seen;			/* the last update it was in */
+};
+
+int			internedcmp(struct interned *, struct interned *);
+
+RB_HEAD(internedtree, interned) head_interned = RB_INITIALIZER(&head_interned);
+RB_PROTOTYPE(internedtree, interned, entry, internedcmp)
+RB_GENERATE(internedtree, interned, entry, internedcmp)
+
+/* recording */
+static FILE *record_file;
+static char *record_path;
+static int	record_remote;
+static struct serve_statics record_statics;
+static unsigned long record_count;
+static uint32_t next_id;
+static struct serve_info info[2];
+static int	this;
+static int	record_mode;
+static struct timeval record_time;
+static struct record_rows record_tables[RECORD_TABLES];
+static char *update_buffer;
+static size_t update_buffer_size;
+
+/* replaying */
+static char *replay_base;
+static size_t replay_size;
+static int	replay_remote_processes;
+static char **strings;
+static long nstrings;
+static struct record_update **updates;
+static long nupdates;
+static long decoded = -1;
+static struct serve_info replay_info;
+static struct record_rows replay_tables[RECORD_TABLES];
+static int	replay_index;
+static int	replay_interactive;
+static long shown;
+static double position;			/* seconds since the epoch */
+static double speed = 1;
+static int	paused;
+static double last_real;
+
+/* the rows of the update shown, as the displays take them */
+static struct process_row *replayed_processes;
+static int	replayed_processes_size;
+static struct replication_row *replayed_standbys;
+static int	replayed_standbys_size;
+static struct blocking_row *replayed_locks;
+static int	replayed_locks_size;
+
+int
+internedcmp(struct interned *e1, struct interned *e2)
+{
+	return strcmp(e1->text, e2->text);
+}
+
+static double
+update_time(long n)
+{
+	return updates[n]->usec / 1000000.0;
+}
+
+static uint64_t
+put_double(double value)
+{
+	uint64_t	bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static double
+get_double(uint64_t bits)
+{
+	double		value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/*
+ * Whether the rows of a display are recorded every update, rather than its
+ * lines while it is shown.
+ */
+int
+record_rows(int mode)
+{
+	return mode == MODE_PROCESSES || mode == MODE_IO_STATS ||
+		mode == MODE_REPLICATION || mode == MODE_BLOCKING;
+}
+
+/* Make room for a number of rows of this update, and forget the ones there. */
+static uint64_t *
+new_rows(struct record_rows *t, int nfields, int nrows)
+{
+	uint64_t   *a;
+
+	if (nrows > t->size[t->this])
+	{
+		a = reallocarray(t->fields[t->this], nrows,
+						 nfields * sizeof(uint64_t));
+		if (a == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		t->fields[t->this] = a;
+		t->size[t->this] = nrows;
+	}
+	t->nrows[t->this] = 0;
+	return t->fields[t->this];
+}
+
+/* Start on the rows of the next update, keeping those of this one. */
+static void
+next_rows(struct record_rows *t)
+{
+	t->this = !t->this;
+	t->nrows[t->this] = 0;
+	t->sorted = 0;
+}
+
+/* for putting the rows before in order by key, and then place */
+static uint64_t *sorting_fields;
+static int	sorting_nfields;
+
+static int
+compare_key(const void *v1, const void *v2)
+{
+	int			i1 = *(const int *) v1;
+	int			i2 = *(const int *) v2;
+	uint64_t	k1 = sorting_fields[(size_t) i1 * sorting_nfields];
+	uint64_t	k2 = sorting_fields[(size_t) i2 * sorting_nfields];
+
+	if (k1 != k2)
+		return k1 < k2 ? -1 : 1;
+	return (i1 > i2) - (i1 < i2);
+}
+
+/*
+ * The first row of the update before with a key, or NULL.  Recording and
+ * replaying find the same one, however the rows before are sorted.
+ */
+static uint64_t *
+find_before(struct record_rows *t, int nfields, uint64_t key)
+{
+	int			before = !t->this;
+	uint64_t   *fields = t->fields[before];
+	int			low = 0;
+	int			high = t->nrows[before];
+	int			middle;
+	int			i;
+	int		   *a;
+
+	if (!t->sorted)
+	{
+		if (t->nrows[before] > t->order_size)
+		{
+			a = reallocarray(t->order, t->nrows[before], sizeof(int));
+			if (a == NULL)
+			{
+				fprintf(stderr, "reallocarray error\n");
+				exit(1);
+			}
+			t->order = a;
+			t->order_size = t->nrows[before];
+		}
+		for (i = 0; i < t->nrows[before]; i++)
+			t->order[i] = i;
+		sorting_fields = fields;
+		sorting_nfields = nfields;
+		qsort(t->order, t->nrows[before], sizeof(int), compare_key);
+		t->sorted = 1;
+	}
+
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if (fields[(size_t) t->order[middle] * nfields] < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (low == t->nrows[before] ||
+		fields[(size_t) t->order[low] * nfields] != key)
+		return NULL;
+	return &fields[(size_t) t->order[low] * nfields];
+}
+
+/*
+ * Put the rows of a table, each with only the fields that changed since the
+ * row with its key in the update before, returning how many bytes that took.
+ */
+static size_t
+put_rows(char *buffer, struct record_rows *t, int nfields, int whole)
+{
+	static const uint64_t none[MAX_FIELDS];
+	int			before = !t->this;
+	const uint64_t *previous;
+	uint64_t   *row;
+	uint32_t	mask;
+	size_t		length = 0;
+	int			i,
+				f;
+
+	for (i = 0; i < t->nrows[t->this]; i++)
+	{
+		row = &t->fields[t->this][(size_t) i * nfields];
+		if (!whole && i < t->nrows[before] &&
+			t->fields[before][(size_t) i * nfields] == row[0])
+		{
+			previous = &t->fields[before][(size_t) i * nfields];
+			mask = 0;
+		}
+		else
+		{
+			previous = whole ? NULL : find_before(t, nfields, row[0]);
+			if (previous == NULL)
+				previous = none;
+			mask = 1;
+		}
+		for (f = 1; f < nfields; f++)
+			if (row[f] != previous[f])
+				mask |= (uint32_t) 1 << f;
+
+		memcpy(buffer + length, &mask, sizeof(mask));
+		length += sizeof(mask);
+		for (f = 0; f < nfields; f++)
+		{
+			if (mask & ((uint32_t) 1 << f))
+			{
+				memcpy(buffer + length, &row[f], sizeof(uint64_t));
+				length += sizeof(uint64_t);
+			}
+		}
+	}
+	return length;
+}
+
+/*
+ * Take the rows of a table from an update, onto those of the update before.
+ * Returns -1 if they are cut short.
+ */
+static int
+get_rows(char *p, char *end, struct record_rows *t, int nfields, int nrows,
+		 int whole)
+{
+	static const uint64_t none[MAX_FIELDS];
+	int			before;
+	const uint64_t *previous;
+	uint64_t   *row;
+	uint32_t	mask;
+	int			i,
+				f;
+
+	next_rows(t);
+	before = !t->this;
+	new_rows(t, nfields, nrows);
+	for (i = 0; i < nrows; i++)
+	{
+		if (end - p < (long) sizeof(mask))
+			return -1;
+		memcpy(&mask, p, sizeof(mask));
+		p += sizeof(mask);
+
+		row = &t->fields[t->this][(size_t) i * nfields];
+		if (mask & 1)
+		{
+			if (end - p < (long) sizeof(uint64_t))
+				return -1;
+			memcpy(&row[0], p, sizeof(uint64_t));
+			previous = whole ? NULL : find_before(t, nfields, row[0]);
+			if (previous == NULL)
+				previous = none;
+		}
+		else
+		{
+			if (i >= t->nrows[before])
+				return -1;
+			previous = &t->fields[before][(size_t) i * nfields];
+		}
+
+		for (f = 0; f < nfields; f++)
+		{
+			if (mask & ((uint32_t) 1 << f))
+			{
+				if (end - p < (long) sizeof(uint64_t))
+					return -1;
+				memcpy(&row[f], p, sizeof(uint64_t));
+				p += sizeof(uint64_t);
+			}
+			else
+				row[f] = previous[f];
+		}
+		t->nrows[t->this]++;
+	}
+	return 0;
+}
+
+/* Write a record, stopping recording if it cannot be. */
+static void
+write_record(int type, void *payload, size_t length)
+{
+	static const char padding[RECORD_ALIGN];
+	struct record_head head;
+	size_t		pad = ALIGN_TO(length, RECORD_ALIGN) - length;
+
+	if (record_file == NULL)
+		return;
+
+	head.type = type;
+	head.length = length;
+	if (fwrite(&head, sizeof(head), 1, record_file) != 1 ||
+		fwrite(payload, length, 1, record_file) != 1 ||
+		(pad > 0 && fwrite(padding, pad, 1, record_file) != 1))
+	{
+		new_message(MT_standout | MT_delayed, " Recording stopped: %s: %s",
+					record_path, strerror(errno));
+		fclose(record_file);
+		record_file = NULL;
+	}
+}
+
+/*
+ * The number of a string, plus one, writing it if it is new.  A string is
+ * only copied the first time it is seen.
+ */
+static uint64_t
+intern(char *text)
+{
+	struct interned key;
+	struct interned *n;
+
+	if (text == NULL)
+		return 0;
+
+	key.text = text;
+	n = RB_FIND(internedtree, &head_interned, &key);
+	if (n == NULL)
+	{
+		n = malloc(sizeof(struct interned));
+		if (n == NULL || (n->text = strdup(text)) == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			exit(1);
+		}
+		n->id = next_id++;
+		RB_INSERT(internedtree, &head_interned, n);
+		write_record(RECORD_STRING, n->text, strlen(n->text) + 1);
+	}
+	n->seen = record_count;
+	return (uint64_t) n->id + 1;
+}
+
+/*
+ * Create the file to record in.  It is not written over, so that a recording
+ * is not lost to a mistyped name.
+ */
+int
+record_init(char *path, struct statics *statics, int remote)
+{
+	static const char padding[RECORD_ALIGN];
+	struct record_header header;
+	size_t		pad = ALIGN_TO(sizeof(header), RECORD_ALIGN) - sizeof(header);
+	int			fd;
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644)) == -1 ||
+		(record_file = fdopen(fd, "w")) == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	record_path = path;
+	record_remote = remote;
+
+	memset(&header, 0, sizeof(header));
+	snprintf(header.magic, sizeof(header.magic), "%s", RECORD_MAGIC);
+	header.info_size = sizeof(struct serve_info);
+	header.keyframe = RECORD_KEYFRAME;
+	header.remote = remote;
+	put_serve_statics(&header.statics, statics);
+	record_statics = header.statics;
+
+	if (fwrite(&header, sizeof(header), 1, record_file) != 1 ||
+		(pad > 0 && fwrite(padding, pad, 1, record_file) != 1) ||
+		fflush(record_file) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Start recording an update, with the numbers of its header lines and the
+ * display shown.
+ */
+void
+record_begin(struct system_info *si, struct db_info *db, struct wal_info *wal,
+			 struct bgwriter_info *bgwriter, char *header, int mode)
+{
+	int			i;
+
+	if (record_file == NULL)
+		return;
+
+	this = !this;
+	gettimeofday(&record_time, NULL);
+	put_serve_info(&info[this], &record_statics, si, db, wal, bgwriter,
+				   header);
+	record_mode = mode;
+	for (i = 0; i < RECORD_TABLES; i++)
+		next_rows(&record_tables[i]);
+	new_rows(&record_tables[TABLE_LINES], LINE_FIELDS, SERVE_LINES);
+	record_count++;
+}
+
+/* Record the next line of a display that is not recorded as rows. */
+void
+record_line(char *line)
+{
+	struct record_rows *t = &record_tables[TABLE_LINES];
+	uint64_t   *row;
+	int			n = t->nrows[t->this];
+
+	if (record_file == NULL || record_rows(record_mode) || n == SERVE_LINES)
+		return;
+
+	row = &t->fields[t->this][n * LINE_FIELDS];
+	row[LINE_POSITION] = n;
+	row[LINE_TEXT] = intern(line);
+	t->nrows[t->this]++;
+}
+
+static int
+compare_process_pid(const void *v1, const void *v2)
+{
+	const struct process_row *p1 = (const struct process_row *) v1;
+	const struct process_row *p2 = (const struct process_row *) v2;
+
+	return (p1->pid > p2->pid) - (p1->pid < p2->pid);
+}
+
+static int
+compare_standby_pid(const void *v1, const void *v2)
+{
+	const struct replication_row *p1 = (const struct replication_row *) v1;
+	const struct replication_row *p2 = (const struct replication_row *) v2;
+
+	return (p1->pid > p2->pid) - (p1->pid < p2->pid);
+}
+
+/*
+ * Take the processes, standbys and sessions waiting on locks last sampled as
+ * rows.  Processes and standbys are kept in the order of their pids, which
+ * changes less than the order they are shown in.
+ */
+static void
+take_rows(void)
+{
+	struct process_row *processes = NULL;
+	struct replication_row *standbys;
+	struct blocking_row *locks;
+	struct record_rows *t;
+	char	  **lines;
+	char	   *summary;
+	uint64_t   *row;
+	int			n = 0;
+	int			i,
+				j;
+
+	if (record_remote)
+		n = get_process_rows_r(&processes);
+#if defined(__linux__)
+	else
+		n = get_process_rows(&processes);
+#endif /* defined(__linux__) */
+	if (n > 0)
+		qsort(processes, n, sizeof(struct process_row), compare_process_pid);
+	t = &record_tables[TABLE_PROCESSES];
+	row = new_rows(t, PROCESS_FIELDS, n);
+	for (i = 0; i < n; i++, row += PROCESS_FIELDS)
+	{
+		row[PF_PID] = processes[i].pid;
+		row[PF_USENAME] = intern(processes[i].usename);
+		row[PF_NAME] = intern(processes[i].name);
+		row[PF_TYPE] = intern(processes[i].backend_type);
+		row[PF_STATE] = processes[i].pgstate;
+		row[PF_SIZE] = processes[i].size;
+		row[PF_RSS] = processes[i].rss;
+		row[PF_XTIME] = processes[i].xtime;
+		row[PF_QTIME] = processes[i].qtime;
+		row[PF_LOCKS] = processes[i].locks;
+		row[PF_CPU] = put_double(processes[i].pcpu);
+		row[PF_RUNQ] = put_double(processes[i].prunq);
+		row[PF_INTERVAL] = put_double(processes[i].interval);
+		for (j = 0; j < PROCESS_COUNTERS; j++)
+			row[PF_COUNTER + j] = processes[i].counter[j];
+	}
+	t->nrows[t->this] = n;
+
+	n = get_replication_rows(&standbys, &lines, &j);
+	t = &record_tables[TABLE_RECOVERY];
+	row = new_rows(t, LINE_FIELDS, j);
+	for (i = 0; i < j; i++, row += LINE_FIELDS)
+	{
+		row[LINE_POSITION] = i;
+		row[LINE_TEXT] = intern(lines[i]);
+	}
+	t->nrows[t->this] = j;
+
+	if (n > 0)
+		qsort(standbys, n, sizeof(struct replication_row),
+			  compare_standby_pid);
+	t = &record_tables[TABLE_STANDBYS];
+	row = new_rows(t, STANDBY_FIELDS, n);
+	for (i = 0; i < n; i++, row += STANDBY_FIELDS)
+	{
+		row[SF_PID] = standbys[i].pid;
+		row[SF_USENAME] = intern(standbys[i].usename);
+		row[SF_APPLICATION] = intern(standbys[i].application_name);
+		row[SF_CLIENT] = intern(standbys[i].client_addr);
+		row[SF_STATE] = intern(standbys[i].state);
+		row[SF_RATED] = standbys[i].rated;
+		row[SF_RATE] = put_double(standbys[i].rate);
+		row[SF_ETA] = put_double(standbys[i].eta);
+		for (j = 0; j < NLSNS; j++)
+			row[SF_LSN + j] = standbys[i].lsn[j];
+		for (j = 0; j < NLAGTIMES; j++)
+			row[SF_LAGTIME + j] = put_double(standbys[i].lagtime[j]);
+	}
+	t->nrows[t->this] = n;
+
+	n = get_blocking_rows(&locks, &summary);
+	t = &record_tables[TABLE_SUMMARY];
+	row = new_rows(t, LINE_FIELDS, 1);
+	row[LINE_POSITION] = 0;
+	row[LINE_TEXT] = intern(summary);
+	t->nrows[t->this] = summary[0] != '\0';
+
+	t = &record_tables[TABLE_LOCKS];
+	row = new_rows(t, LOCK_FIELDS, n);
+	for (i = 0; i < n; i++, row += LOCK_FIELDS)
+	{
+		/* locks are kept in the order shown, so are keyed by it too */
+		row[LF_PID] = locks[i].pid;
+		row[LF_DEPTH] = locks[i].depth;
+		row[LF_NBLOCKERS] = locks[i].nblockers;
+		row[LF_BLOCKS] = locks[i].blocks;
+		row[LF_WAIT] = put_double(locks[i].wait);
+		row[LF_MODE] = intern(locks[i].mode);
+		row[LF_RELATION] = intern(locks[i].relation);
+		row[LF_STATE] = intern(locks[i].state);
+		row[LF_QUERY] = intern(locks[i].query);
+	}
+	t->nrows[t->this] = n;
+}
+
+/*
+ * Put the bytes of the header numbers that changed since the update before,
+ * returning how many bytes that took.
+ */
+static size_t
+put_info_changes(char *buffer, char *before, char *after, int whole)
+{
+	size_t		size = sizeof(struct serve_info);
+	size_t		length = 0;
+	size_t		at = 0;
+	size_t		start,
+				end,
+				last;
+	uint16_t	skip,
+				copy;
+
+	while (at < size)
+	{
+		start = at;
+		if (!whole)
+			while (start < size && before[start] == after[start])
+				start++;
+		if (start == size)
+			break;
+
+		/* take in the unchanged bytes that are too few to skip */
+		end = last = start + 1;
+		while (end < size && end - last < INFO_GAP)
+		{
+			if (whole || before[end] != after[end])
+				last = end + 1;
+			end++;
+		}
+
+		skip = start - at;
+		copy = last - start;
+		memcpy(buffer + length, &skip, sizeof(skip));
+		memcpy(buffer + length + sizeof(skip), &copy, sizeof(copy));
+		memcpy(buffer + length + sizeof(skip) + sizeof(copy), after + start,
+			   copy);
+		length += sizeof(skip) + sizeof(copy) + copy;
+		at = last;
+	}
+	return length;
+}
+
+/* Write the update being recorded, and forget strings long unused. */
+void
+record_end(void)
+{
+	struct record_update *u;
+	struct interned *n,
+			   *tmp;
+	size_t		size;
+	char	   *p;
+	int			i;
+
+	if (record_file == NULL)
+		return;
+
+	take_rows();
+
+	/* the most it can take, every field of every row changed */
+	size = sizeof(struct record_update) + sizeof(struct serve_info) * 2;
+	for (i = 0; i < RECORD_TABLES; i++)
+		size += (size_t) record_tables[i].nrows[record_tables[i].this] *
+			(sizeof(uint32_t) + table_fields[i] * sizeof(uint64_t));
+	if (size > update_buffer_size)
+	{
+		p = realloc(update_buffer, size);
+		if (p == NULL)
+		{
+			fprintf(stderr, "realloc error\n");
+			exit(1);
+		}
+		update_buffer = p;
+		update_buffer_size = size;
+	}
+
+	u = (struct record_update *) update_buffer;
+	memset(u, 0, sizeof(struct record_update));
+	u->usec = (int64_t) record_time.tv_sec * 1000000 + record_time.tv_usec;
+	u->mode = record_mode;
+	u->whole = (record_count - 1) % RECORD_KEYFRAME == 0;
+
+	p = update_buffer + sizeof(struct record_update);
+	u->info_length = put_info_changes(p, (char *) &info[!this],
+									  (char *) &info[this], u->whole);
+	p += u->info_length;
+	for (i = 0; i < RECORD_TABLES; i++)
+	{
+		u->nrows[i] = record_tables[i].nrows[record_tables[i].this];
+		u->length[i] = put_rows(p, &record_tables[i], table_fields[i],
+								u->whole);
+		p += u->length[i];
+	}
+
+	write_record(RECORD_UPDATE, update_buffer, p - update_buffer);
+	if (record_file != NULL && fflush(record_file) != 0)
+	{
+		new_message(MT_standout | MT_delayed, " Recording stopped: %s: %s",
+					record_path, strerror(errno));
+		fclose(record_file);
+		record_file = NULL;
+	}
+
+	RB_FOREACH_SAFE(n, internedtree, &head_interned, tmp)
+	{
+		if (record_count - n->seen >= INTERN_UPDATES)
+		{
+			RB_REMOVE(internedtree, &head_interned, n);
+			free(n->text);
+			free(n);
+		}
+	}
+}
+
+static void
+add_string(char *s)
+{
+	static long size;
+	char	  **a;
+
+	if (nstrings == size)
+	{
+		size = size == 0 ? 1024 : size * 2;
+		a = reallocarray(strings, size, sizeof(char *));
+		if (a == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		strings = a;
+	}
+	strings[nstrings++] = s;
+}
+
+static void
+add_update(struct record_update *u)
+{
+	static long size;
+	struct record_update **a;
+
+	if (nupdates == size)
+	{
+		size = size == 0 ? 1024 : size * 2;
+		a = reallocarray(updates, size, sizeof(struct record_update *));
+		if (a == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		updates = a;
+	}
+	updates[nupdates++] = u;
+}
+
+/* Whether an update has room for all it says it has. */
+static int
+update_fits(struct record_update *u, size_t length)
+{
+	size_t		size = sizeof(struct record_update);
+	int			i;
+
+	if (length < size)
+		return 0;
+	size += u->info_length;
+	for (i = 0; i < RECORD_TABLES; i++)
+	{
+		/* each row has at least its mask */
+		if (u->nrows[i] > u->length[i] / sizeof(uint32_t))
+			return 0;
+		size += u->length[i];
+	}
+	return size <= length && u->nrows[TABLE_LINES] <= SERVE_LINES;
+}
+
+/*
+ * Map a recording and find its strings and updates, which are not read until
+ * they are shown.  What was being written when the recording stopped is left
+ * out.
+ */
+int
+replay_init(char *path, struct statics *statics)
+{
+	struct record_header *header;
+	struct record_head *head;
+	struct stat st;
+	char	   *p;
+	char	   *end;
+	int			fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &st) == -1)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	replay_size = st.st_size;
+	if (replay_size < sizeof(struct record_header) ||
+		(replay_base = mmap(NULL, replay_size, PROT_READ, MAP_SHARED, fd,
+							0)) == MAP_FAILED)
+	{
+		if (replay_size < sizeof(struct record_header))
+			fprintf(stderr, "%s: not a recording of pg_top\n", path);
+		else
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	header = (struct record_header *) replay_base;
+	if (strncmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0 ||
+		header->info_size != sizeof(struct serve_info))
+	{
+		fprintf(stderr, "%s: not recorded by this version of pg_top\n", path);
+		munmap(replay_base, replay_size);
+		return -1;
+	}
+	replay_remote_processes = header->remote;
+
+	p = replay_base + ALIGN_TO(sizeof(struct record_header), RECORD_ALIGN);
+	end = replay_base + replay_size;
+	while (end - p >= (long) sizeof(struct record_head))
+	{
+		head = (struct record_head *) p;
+		if ((size_t) (end - p) - sizeof(struct record_head) < head->length)
+			break;
+		p += sizeof(struct record_head);
+
+		if (head->type == RECORD_STRING)
+		{
+			if (head->length == 0 || p[head->length - 1] != '\0')
+				break;
+			add_string(p);
+		}
+		else if (head->type == RECORD_UPDATE)
+		{
+			if (!update_fits((struct record_update *) p, head->length))
+				break;
+			add_update((struct record_update *) p);
+		}
+
+		if ((size_t) (end - p) < ALIGN_TO(head->length, RECORD_ALIGN))
+			break;
+		p += ALIGN_TO(head->length, RECORD_ALIGN);
+	}
+
+	if (nupdates == 0)
+	{
+		fprintf(stderr, "%s: no updates were recorded\n", path);
+		return -1;
+	}
+
+	get_serve_statics(&header->statics, statics);
+	position = update_time(0);
+	return 0;
+}
+
+/* Whether the processes of the recording were sampled in remote mode. */
+int
+replay_remote(void)
+{
+	return replay_remote_processes;
+}
+
+/* The display shown when the recording started. */
+int
+replay_mode(void)
+{
+	return updates[0]->mode >= 0 && updates[0]->mode < MODE_TYPES ?
+		updates[0]->mode : MODE_PROCESSES;
+}
+
+long
+replay_updates(void)
+{
+	return nupdates;
+}
+
+/*
+ * Start replaying: interactive, as the updates happened, or else one update
+ * after another as fast as they can be shown.
+ */
+void
+replay_start(int interactive)
+{
+	replay_interactive = interactive;
+	shown = interactive ? 0 : -1;
+}
+
+/*
+ * Apply an update onto the one before it.  The rows of a table cut short are
+ * left out.
+ */
+static void
+apply_update(long n)
+{
+	struct record_update *u = updates[n];
+	char	   *p = (char *) u + sizeof(struct record_update);
+	char	   *end = p + u->info_length;
+	char	   *to = (char *) &replay_info;
+	size_t		at = 0;
+	uint16_t	skip,
+				copy;
+	int			i;
+
+	while (end - p >= (long) (sizeof(skip) + sizeof(copy)))
+	{
+		memcpy(&skip, p, sizeof(skip));
+		memcpy(&copy, p + sizeof(skip), sizeof(copy));
+		p += sizeof(skip) + sizeof(copy);
+		at += skip;
+		if (at + copy > sizeof(struct serve_info) || end - p < copy)
+			break;
+		memcpy(to + at, p, copy);
+		at += copy;
+		p += copy;
+	}
+
+	p = end;
+	for (i = 0; i < RECORD_TABLES; i++)
+	{
+		if (get_rows(p, p + u->length[i], &replay_tables[i], table_fields[i],
+					 u->nrows[i], u->whole) == -1)
+			replay_tables[i].nrows[replay_tables[i].this] = 0;
+		p += u->length[i];
+	}
+	decoded = n;
+}
+
+/* Put together an update, from the last one kept whole before it. */
+static void
+decode_update(long n)
+{
+	long		from;
+
+	if (n == decoded)
+		return;
+	if (n == decoded + 1)
+	{
+		apply_update(n);
+		return;
+	}
+
+	for (from = n; from > 0 && !updates[from]->whole; from--)
+		;
+	memset(&replay_info, 0, sizeof(replay_info));
+	for (; from <= n; from++)
+		apply_update(from);
+}
+
+/* the last update sampled by a time, or the first */
+static long
+find_update(double when)
+{
+	long		low = 0;
+	long		high = nupdates - 1;
+	long		middle;
+
+	while (low < high)
+	{
+		middle = (low + high + 1) / 2;
+		if (update_time(middle) <= when)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+	return low;
+}
+
+time_t
+replay_time(void)
+{
+	return (time_t) update_time(shown < 0 ? 0 : shown);
+}
+
+void
+replay_pause(void)
+{
+	paused = !paused;
+	last_real = 0;
+}
+
+/* Step updates forward or back, and stay there. */
+void
+replay_step(int steps)
+{
+	shown += steps;
+	if (shown < 0)
+		shown = 0;
+	if (shown >= nupdates)
+		shown = nupdates - 1;
+	position = update_time(shown);
+	paused = 1;
+}
+
+/* Seek seconds forward or back. */
+void
+replay_seek(double seconds)
+{
+	position += seconds;
+	if (position < update_time(0))
+		position = update_time(0);
+	shown = find_update(position);
+	last_real = 0;
+}
+
+void
+replay_speed(double factor)
+{
+	speed *= factor;
+	if (speed < 1.0 / 64)
+		speed = 1.0 / 64;
+	if (speed > 64)
+		speed = 64;
+}
+
+/*
+ * Go to the update at a time of day, from the day the recording started.
+ * Returns -1 if the recording ended before it.
+ */
+int
+replay_goto(int hour, int minute, int second)
+{
+	struct tm	tm;
+	time_t		start = (time_t) update_time(0);
+	time_t		when;
+
+	localtime_r(&start, &tm);
+	tm.tm_hour = hour;
+	tm.tm_min = minute;
+	tm.tm_sec = second;
+	tm.tm_isdst = -1;
+	if ((when = mktime(&tm)) < start)
+		when += 24 * 60 * 60;
+	if (when > update_time(nupdates - 1))
+		return -1;
+
+	position = when;
+	shown = find_update(position);
+	if (update_time(shown) < when && shown < nupdates - 1)
+		shown++;
+	last_real = 0;
+	return 0;
+}
+
+/* a string of a recording, or NULL for none */
+static char *
+replayed_string(uint64_t number)
+{
+	if (number == 0)
+		return NULL;
+	return number - 1 < (uint64_t) nstrings ? strings[number - 1] : "";
+}
+
+/* a string of a recording, or an empty one for none */
+static char *
+replayed_text(uint64_t number)
+{
+	char	   *s = replayed_string(number);
+
+	return s != NULL ? s : "";
+}
+
+/* the rows of a table of the update shown */
+static uint64_t *
+replayed_rows(int table, int *nrows)
+{
+	struct record_rows *t = &replay_tables[table];
+
+	*nrows = t->nrows[t->this];
+	return t->fields[t->this];
+}
+
+/* the lines of a table of the update shown */
+static char **
+replayed_lines(int table, int *nlines)
+{
+	static char **lines;
+	static int	size;
+	uint64_t   *row = replayed_rows(table, nlines);
+	char	  **a;
+	int			i;
+
+	if (*nlines > size)
+	{
+		a = reallocarray(lines, *nlines, sizeof(char *));
+		if (a == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		lines = a;
+		size = *nlines;
+	}
+	for (i = 0; i < *nlines; i++, row += LINE_FIELDS)
+		lines[i] = replayed_text(row[LINE_TEXT]);
+	return lines;
+}
+
+/*
+ * Show the update due, and where in the recording it is.  The lines recorded
+ * are only shown by the display they were recorded in.
+ */
+caddr_t
+get_replayed_info(struct system_info *si, struct db_info *db,
+				  struct wal_info *wal, struct bgwriter_info *bgwriter,
+				  char **header, int mode)
+{
+	double		now;
+	long		due;
+	char		when[9];
+	char	   *recorded_header;
+	time_t		t;
+
+	if (!replay_interactive)
+	{
+		if (shown < nupdates - 1)
+			shown++;
+	}
+	else
+	{
+		now = sample_time();
+		if (!paused && last_real > 0)
+		{
+			position += (now - last_real) * speed;
+			due = find_update(position);
+			if (due > shown)
+				shown = due;
+			if (shown == nupdates - 1)
+				paused = 1;
+		}
+		last_real = now;
+	}
+
+	decode_update(shown);
+	recorded_header = NULL;
+	get_serve_info(&replay_info, si, db, wal, bgwriter, &recorded_header);
+	if (updates[shown]->mode == mode && !record_rows(mode))
+	{
+		if (recorded_header != NULL)
+			*header = recorded_header;
+		replayed_rows(TABLE_LINES, &si->P_ACTIVE);
+	}
+	else
+		si->P_ACTIVE = 0;
+
+	if (replay_interactive)
+	{
+		t = replay_time();
+		strftime(when, sizeof(when), "%H:%M:%S", localtime(&t));
+		new_message(MT_standout | MT_delayed, " %s %s, update %ld of %ld, %gx",
+					shown == nupdates - 1 ? "End at" :
+					paused ? "Paused at" : "Replaying", when, shown + 1,
+					nupdates, speed);
+	}
+
+	replay_index = 0;
+	return (caddr_t) 0;
+}
+
+/* The processes of the update shown, put in order by compare_index. */
+caddr_t
+get_replayed_processes(struct system_info *si, struct process_select *sel,
+					   int compare_index)
+{
+	struct process_row *p;
+	uint64_t   *row;
+	int			nrows;
+	int			i,
+				j;
+
+	row = replayed_rows(TABLE_PROCESSES, &nrows);
+	if (nrows > replayed_processes_size)
+	{
+		p = reallocarray(replayed_processes, nrows,
+						 sizeof(struct process_row));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		replayed_processes = p;
+		replayed_processes_size = nrows;
+	}
+
+	for (i = 0; i < nrows; i++, row += PROCESS_FIELDS)
+	{
+		p = &replayed_processes[i];
+		p->pid = (int) row[PF_PID];
+		p->usename = replayed_text(row[PF_USENAME]);
+		p->name = replayed_text(row[PF_NAME]);
+		p->backend_type = replayed_string(row[PF_TYPE]);
+		p->pgstate = (int) row[PF_STATE];
+		if (p->pgstate < 0 || p->pgstate >= NPROCSTATES)
+			p->pgstate = STATE_UNDEFINED;
+		p->size = row[PF_SIZE];
+		p->rss = row[PF_RSS];
+		p->xtime = row[PF_XTIME];
+		p->qtime = row[PF_QTIME];
+		p->locks = row[PF_LOCKS];
+		p->pcpu = get_double(row[PF_CPU]);
+		p->prunq = get_double(row[PF_RUNQ]);
+		p->interval = get_double(row[PF_INTERVAL]);
+		for (j = 0; j < PROCESS_COUNTERS; j++)
+			p->counter[j] = row[PF_COUNTER + j];
+	}
+
+	if (replay_remote_processes)
+		return put_process_rows_r(si, sel, replayed_processes, nrows,
+								  compare_index);
+#if defined(__linux__)
+	return put_process_rows(si, sel, replayed_processes, nrows,
+							compare_index);
+#else
+	si->P_ACTIVE = 0;
+	return (caddr_t) 0;
+#endif /* defined(__linux__) */
+}
+
+/* The standbys of the update shown, put in order by compare_index. */
+caddr_t
+get_replayed_replication(struct system_info *si, int compare_index)
+{
+	struct replication_row *p;
+	uint64_t   *row;
+	char	  **lines;
+	int			nlines;
+	int			nrows;
+	int			i,
+				j;
+
+	lines = replayed_lines(TABLE_RECOVERY, &nlines);
+	row = replayed_rows(TABLE_STANDBYS, &nrows);
+	if (nrows > replayed_standbys_size)
+	{
+		p = reallocarray(replayed_standbys, nrows,
+						 sizeof(struct replication_row));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		replayed_standbys = p;
+		replayed_standbys_size = nrows;
+	}
+
+	for (i = 0; i < nrows; i++, row += STANDBY_FIELDS)
+	{
+		p = &replayed_standbys[i];
+		p->pid = (int) row[SF_PID];
+		p->usename = replayed_text(row[SF_USENAME]);
+		p->application_name = replayed_text(row[SF_APPLICATION]);
+		p->client_addr = replayed_text(row[SF_CLIENT]);
+		p->state = replayed_text(row[SF_STATE]);
+		p->rated = (int) row[SF_RATED];
+		p->rate = get_double(row[SF_RATE]);
+		p->eta = get_double(row[SF_ETA]);
+		for (j = 0; j < NLSNS; j++)
+			p->lsn[j] = (long long) row[SF_LSN + j];
+		for (j = 0; j < NLAGTIMES; j++)
+			p->lagtime[j] = get_double(row[SF_LAGTIME + j]);
+	}
+
+	return put_replication_rows(si, replayed_standbys, nrows, lines, nlines,
+								compare_index);
+}
+
+/* The sessions waiting on locks of the update shown, in the order shown. */
+caddr_t
+get_replayed_blocking(struct system_info *si)
+{
+	struct blocking_row *p;
+	uint64_t   *row;
+	char	  **lines;
+	int			nlines;
+	int			nrows;
+	int			i;
+
+	lines = replayed_lines(TABLE_SUMMARY, &nlines);
+	row = replayed_rows(TABLE_LOCKS, &nrows);
+	if (nrows > replayed_locks_size)
+	{
+		p = reallocarray(replayed_locks, nrows, sizeof(struct blocking_row));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		replayed_locks = p;
+		replayed_locks_size = nrows;
+	}
+
+	for (i = 0; i < nrows; i++, row += LOCK_FIELDS)
+	{
+		p = &replayed_locks[i];
+		p->pid = (int) row[LF_PID];
+		p->depth = (int) row[LF_DEPTH];
+		p->nblockers = (int) row[LF_NBLOCKERS];
+		p->blocks = (int) row[LF_BLOCKS];
+		p->wait = get_double(row[LF_WAIT]);
+		p->mode = replayed_text(row[LF_MODE]);
+		p->relation = replayed_text(row[LF_RELATION]);
+		p->state = replayed_text(row[LF_STATE]);
+		p->query = replayed_text(row[LF_QUERY]);
+	}
+
+	return put_blocking_rows(si, replayed_locks, nrows,
+							 nlines > 0 ? lines[0] : "");
+}
+
+/* The next line of a display recorded as its lines. */
+char *
+format_next_replayed(caddr_t handle)
+{
+	int			nlines;
+	uint64_t   *row = replayed_rows(TABLE_LINES, &nlines);
+
+	if (replay_index >= nlines)
+		return "";
+	return replayed_text(row[(size_t) replay_index++ * LINE_FIELDS +
+							 LINE_TEXT]);
+}
@@ -0,0 +1,39 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _RECORD_H_
+#define _RECORD_H_
+
+#include "machine.h"
+
+/* every this many updates is kept whole, for seeking */
+#define RECORD_KEYFRAME 64
+
+int			record_rows(int);
+int			record_init(char *, struct statics *, int);
+void		record_begin(struct system_info *, struct db_info *,
+						 struct wal_info *, struct bgwriter_info *, char *,
+						 int);
+void		record_line(char *);
+void		record_end(void);
+
+int			replay_init(char *, struct statics *);
+int			replay_remote(void);
+int			replay_mode(void);
+long		replay_updates(void);
+void		replay_start(int);
+time_t		replay_time(void);
+void		replay_pause(void);
+void		replay_step(int);
+void		replay_seek(double);
+void		replay_speed(double);
+int			replay_goto(int, int, int);
+caddr_t		get_replayed_info(struct system_info *, struct db_info *,
+							  struct wal_info *, struct bgwriter_info *,
+							  char **, int);
+caddr_t		get_replayed_processes(struct system_info *,
+								   struct process_select *, int);
+caddr_t		get_replayed_replication(struct system_info *, int);
+caddr_t		get_replayed_blocking(struct system_info *);
+char	   *format_next_replayed(caddr_t);
+
+#endif							/* _RECORD_H_ */
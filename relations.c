@@ -0,0 +1,475 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Table activity: the rate of scans, reads and changes of each table in the
+ * database since the last update, from pg_stat_user_tables and
+ * pg_statio_user_tables.
+ *
+ * The counters last seen of every table are kept in a hash table by relid,
+ * open addressed so that a database of a hundred thousand tables costs one
+ * array that is kept from one sample to the next.
+ */
+
+#include "os.h"
+#include <stdint.h>
+#include <bsd/stdlib.h>
+
+#include "relations.h"
+#include "pg.h"
+#include "utils.h"
+
+/* number of statistics kept for each table */
+#define NRELSTATS (REL_IDX_BLKS_READ - REL_SEQ_SCAN + 1)
+
+#define STAT(p, i) ((p)->rate[(i) - REL_SEQ_SCAN])
+
+char		fmt_header_relations[] =
+"    RELID SEQSCAN SEQREAD IDXSCAN IDXFETCH   INS   UPD   DEL HEAPRD IDXRD RELATION";
+
+/* the hash table starts with 2^REL_SLOTS_BITS slots */
+#define REL_SLOTS_BITS 10
+
+/* Fibonacci hashing, the slot is taken from the top bits */
+#define REL_HASH(relid) ((uint32_t) ((relid) * 2654435769U))
+
+/* a table as last seen, in a slot of the hash table */
+struct relation_slot
+{
+	unsigned int relid;			/* 0 for an empty slot */
+
+	/* the last sample this table was seen in */
+	unsigned int sample;
+
+	char	   *schemaname;
+	char	   *relname;
+	long long	last[NRELSTATS];
+};
+
+/* a table that was used since the last sample, as shown */
+struct relation
+{
+	unsigned int relid;
+	char	   *schemaname;
+	char	   *relname;
+	double		rate[NRELSTATS];
+};
+
+static int	compare_heaprd(const void *, const void *);
+static int	compare_idxfetch(const void *, const void *);
+static int	compare_idxrd(const void *, const void *);
+static int	compare_idxscan(const void *, const void *);
+static int	compare_ins(const void *, const void *);
+static int	compare_del(const void *, const void *);
+static int	compare_relation(const void *, const void *);
+static int	compare_seqread(const void *, const void *);
+static int	compare_seqscan(const void *, const void *);
+static int	compare_upd(const void *, const void *);
+
+char	   *relation_ordernames[] = {
+	"seqread", "seqscan", "idxscan", "idxfetch", "ins", "upd", "del",
+	"heaprd", "idxrd", "relation", NULL
+};
+
+int			(*relation_compares[]) () =
+{
+	compare_seqread,
+		compare_seqscan,
+		compare_idxscan,
+		compare_idxfetch,
+		compare_ins,
+		compare_upd,
+		compare_del,
+		compare_heaprd,
+		compare_idxrd,
+		compare_relation,
+		NULL
+};
+
+static struct relation *reltable;
+static int	reltable_size;
+static int	rel_index;
+static unsigned int sample;
+static struct timeval lasttime;
+
+/* the hash table, and the array it is moved to when rehashed */
+static struct relation_slot *slots;
+static struct relation_slot *spare;
+static int	slots_bits;
+static int	spare_bits;
+static int	slots_used;
+
+/* the slot of relid in table, or the empty slot where it would go */
+static struct relation_slot *
+find_slot(struct relation_slot *table, int bits, unsigned int relid)
+{
+	uint32_t	mask = (1U << bits) - 1;
+	uint32_t	i = REL_HASH(relid) >> (32 - bits);
+
+	while (table[i].relid != 0 && table[i].relid != relid)
+		i = (i + 1) & mask;
+	return &table[i];
+}
+
+/*
+ * Move the tables into a hash table of 2^bits slots, forgetting those not
+ * seen in this sample when drop is set.  The old slots are kept for the next
+ * time, unless the table grew.
+ */
+static void
+rehash(int bits, int drop)
+{
+	struct relation_slot *old = slots;
+	int			old_bits = slots_bits;
+	int			i;
+
+	if (spare == NULL || spare_bits != bits)
+	{
+		free(spare);
+		spare = calloc((size_t) 1 << bits, sizeof(struct relation_slot));
+		if (spare == NULL)
+		{
+			fprintf(stderr, "calloc error\n");
+			exit(1);
+		}
+		spare_bits = bits;
+	}
+	else
+		memset(spare, 0, sizeof(struct relation_slot) << bits);
+
+	slots = spare;
+	slots_bits = bits;
+	slots_used = 0;
+	for (i = 0; old != NULL && i < 1 << old_bits; i++)
+	{
+		if (old[i].relid == 0)
+			continue;
+		if (drop && old[i].sample != sample)
+		{
+			free(old[i].schemaname);
+			free(old[i].relname);
+			continue;
+		}
+		*find_slot(slots, bits, old[i].relid) = old[i];
+		slots_used++;
+	}
+
+	spare = old;
+	spare_bits = old_bits;
+}
+
+/*
+ * Sample the statistics of every table and gather the ones that were used
+ * since the last sample, sorted by compare_index.
+ */
+caddr_t
+get_relation_info(struct system_info *si, struct pg_conninfo_ctx *conninfo,
+				  int compare_index)
+{
+	struct timeval thistime;
+	double		timediff;
+	struct relation_slot *n;
+	struct relation *p;
+	PGresult   *pgresult = NULL;
+	unsigned int relid;
+	long long	value;
+	long long	diff;
+	int			active_rels = 0;
+	int			rows = 0;
+	int			i,
+				j;
+	int			fresh;
+	int			active;
+
+	/* calculate the time difference since our last check */
+	gettimeofday(&thistime, 0);
+	if (lasttime.tv_sec)
+	{
+		timediff = ((thistime.tv_sec - lasttime.tv_sec) +
+					(thistime.tv_usec - lasttime.tv_usec) * 1e-6);
+	}
+	else
+	{
+		timediff = 0;
+	}
+	lasttime = thistime;
+	++sample;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_relations(conninfo->connection);
+		if (PQresultStatus(pgresult) == PGRES_TUPLES_OK)
+			rows = PQntuples(pgresult);
+	}
+
+	if (rows > reltable_size)
+	{
+		p = reallocarray(reltable, rows, sizeof(struct relation));
+		if (p == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			if (pgresult != NULL)
+				PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		reltable = p;
+		reltable_size = rows;
+	}
+
+	if (slots == NULL)
+		rehash(REL_SLOTS_BITS, 0);
+
+	for (i = 0; i < rows; i++)
+	{
+		/* kept no more than three quarters full */
+		if ((slots_used + 1) * 4 > 3 << slots_bits)
+			rehash(slots_bits + 1, 0);
+
+		relid = (unsigned int) strtoul(PQgetvalue(pgresult, i, REL_RELID),
+									   NULL, 10);
+		n = find_slot(slots, slots_bits, relid);
+		fresh = n->relid == 0;
+		if (fresh)
+		{
+			n->relid = relid;
+			slots_used++;
+		}
+		n->sample = sample;
+
+		update_str(&n->schemaname, PQgetvalue(pgresult, i, REL_SCHEMANAME));
+		update_str(&n->relname, PQgetvalue(pgresult, i, REL_RELNAME));
+
+		p = &reltable[active_rels];
+		active = 0;
+		for (j = 0; j < NRELSTATS; j++)
+		{
+			value = strtoll(PQgetvalue(pgresult, i, REL_SEQ_SCAN + j), NULL,
+							10);
+
+			/* a table seen for the first time has no activity yet */
+			diff = fresh ? 0 : value - n->last[j];
+			if (diff > 0 && timediff > 0)
+			{
+				p->rate[j] = diff / timediff;
+				active = 1;
+			}
+			else
+			{
+				p->rate[j] = 0;
+			}
+			n->last[j] = value;
+		}
+
+		if (active)
+		{
+			p->relid = relid;
+			p->schemaname = n->schemaname;
+			p->relname = n->relname;
+			active_rels++;
+		}
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+	disconnect_from_db(conninfo);
+
+	/* forget the tables that were dropped */
+	if (rows > 0 && slots_used > rows)
+		rehash(slots_bits, 1);
+
+	if (compare_index >= 0 && active_rels)
+	{
+		qsort(reltable, active_rels, sizeof(struct relation),
+			  relation_compares[compare_index]);
+	}
+
+	si->P_ACTIVE = active_rels;
+	rel_index = 0;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_relation(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	struct relation *p = &reltable[rel_index++];
+
+	snprintf(fmt, sizeof(fmt),
+			 "%9u %7s %7s %7s %8s %5s %5s %5s %6s %5s %s.%s",
+			 p->relid,
+			 format_n(STAT(p, REL_SEQ_SCAN)),
+			 format_n(STAT(p, REL_SEQ_TUP_READ)),
+			 format_n(STAT(p, REL_IDX_SCAN)),
+			 format_n(STAT(p, REL_IDX_TUP_FETCH)),
+			 format_n(STAT(p, REL_N_TUP_INS)),
+			 format_n(STAT(p, REL_N_TUP_UPD)),
+			 format_n(STAT(p, REL_N_TUP_DEL)),
+			 format_n(STAT(p, REL_HEAP_BLKS_READ)),
+			 format_n(STAT(p, REL_IDX_BLKS_READ)),
+			 p->schemaname,
+			 p->relname);
+
+	return (fmt);
+}
+
+/* comparison routines for qsort */
+
+#define ORDERKEY_RATE(i) if ((result = (STAT(p2, i) > STAT(p1, i)) - \
+										(STAT(p2, i) < STAT(p1, i))) == 0)
+#define ORDERKEY_RELNAME if ((result = strcmp(p1->schemaname, \
+											  p2->schemaname)) == 0 && \
+							 (result = strcmp(p1->relname, p2->relname)) == 0)
+
+static int
+compare_seqread(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_SEQ_TUP_READ)
+		ORDERKEY_RATE(REL_SEQ_SCAN)
+		ORDERKEY_RATE(REL_IDX_TUP_FETCH)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_seqscan(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_SEQ_SCAN)
+		ORDERKEY_RATE(REL_SEQ_TUP_READ)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_idxscan(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_IDX_SCAN)
+		ORDERKEY_RATE(REL_IDX_TUP_FETCH)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_idxfetch(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_IDX_TUP_FETCH)
+		ORDERKEY_RATE(REL_IDX_SCAN)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_ins(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_N_TUP_INS)
+		ORDERKEY_RATE(REL_N_TUP_UPD)
+		ORDERKEY_RATE(REL_N_TUP_DEL)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_upd(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_N_TUP_UPD)
+		ORDERKEY_RATE(REL_N_TUP_INS)
+		ORDERKEY_RATE(REL_N_TUP_DEL)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_del(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_N_TUP_DEL)
+		ORDERKEY_RATE(REL_N_TUP_INS)
+		ORDERKEY_RATE(REL_N_TUP_UPD)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_heaprd(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_HEAP_BLKS_READ)
+		ORDERKEY_RATE(REL_IDX_BLKS_READ)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_idxrd(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RATE(REL_IDX_BLKS_READ)
+		ORDERKEY_RATE(REL_HEAP_BLKS_READ)
+		ORDERKEY_RELNAME
+		;
+
+	return (result);
+}
+
+static int
+compare_relation(const void *v1, const void *v2)
+{
+	struct relation *p1 = (struct relation *) v1;
+	struct relation *p2 = (struct relation *) v2;
+	int			result;
+
+	ORDERKEY_RELNAME
+		ORDERKEY_RATE(REL_SEQ_TUP_READ)
+		;
+
+	return (result);
+}
@@ -0,0 +1,15 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _RELATIONS_H_
+#define _RELATIONS_H_
+
+#include "machine.h"
+
+caddr_t		get_relation_info(struct system_info *, struct pg_conninfo_ctx *,
+							  int);
+char	   *format_next_relation(caddr_t);
+
+extern char fmt_header_relations[];
+extern char *relation_ordernames[];
+
+#endif							/* _RELATIONS_H_ */
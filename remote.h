@@ -14,9 +14,12 @@ caddr_t		get_process_info_r(struct system_info *, struct process_select *, int,
 char	   *format_header_r(char *);
 char	   *format_next_io_r(caddr_t);
 char	   *format_next_process_r(caddr_t);
-char	   *format_next_replication_r(caddr_t);
+void		output_next_process_r(caddr_t);
+void		machine_replay_init_r(struct statics *);
+int			get_process_rows_r(struct process_row **);
+caddr_t		put_process_rows_r(struct system_info *, struct process_select *,
+							   struct process_row *, int, int);
 
 extern char fmt_header_io_r[];
-extern char fmt_header_replication_r[];
 
 #endif							/* _REMOTE_H_ */
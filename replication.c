@@ -0,0 +1,731 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Replication: how far behind the primary each standby is, in bytes and, from
+ * PostgreSQL 10, in time, from pg_stat_replication.
+ *
+ * The replay lag of each standby is kept over the last few samples so that
+ * the rate it is changing at shows whether the standby is catching up or
+ * falling behind, and when it should have caught up at that rate.
+ *
+ * When the server is itself a standby, its WAL receiver, how fast it replays
+ * WAL and the queries cancelled by recovery conflicts are shown first,
+ * followed by the standbys cascading from it.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "delta.h"
+#include "display.h"
+#include "replication.h"
+#include "pg.h"
+#include "utils.h"
+
+#define LSN(p, i) ((p)->lsn[(i) - REP_PRIMARY])
+
+/* the lags of each standby, in bytes and in seconds, -1 if unknown */
+#define LAG(p, i) (LSN(p, REP_PRIMARY) < 0 || LSN(p, i) < 0 ? -1 : \
+		LSN(p, REP_PRIMARY) > LSN(p, i) ? \
+		LSN(p, REP_PRIMARY) - LSN(p, i) : 0)
+#define LAGTIME(p, i) ((p)->lagtime[(i) - REP_WRITE_TIME])
+
+char		fmt_header_replication[] =
+"    PID USERNAME APPLICATION          CLIENT STATE      SLAG  WLAG  FLAG  RLAG  WTIME  FTIME  RTIME    RATE    ETA PRIMARY           SENT              WRITE             FLUSH             REPLAY";
+
+struct standby
+{
+	RB_ENTRY(standby) entry;
+	int			pid;
+
+	/* the last sample this standby was seen in */
+	unsigned int sample;
+
+	char	   *usename;
+	char	   *application_name;
+	char	   *client_addr;
+	char	   *state;
+	long long	lsn[NLSNS];
+	double		lagtime[NLAGTIMES];
+
+	/* replay lag over the last samples, oldest first from history_index */
+	double		history_time[REPLICATION_HISTORY];
+	long long	history_lag[REPLICATION_HISTORY];
+	int			history_index;
+	int			nhistory;
+
+	double		rate;			/* bytes per second the lag grows by */
+	double		eta;			/* seconds until caught up, or -1 */
+};
+
+int			standbycmp(struct standby *, struct standby *);
+
+RB_HEAD(pgstandby, standby) head_standby = RB_INITIALIZER(&head_standby);
+RB_PROTOTYPE(pgstandby, standby, entry, standbycmp)
+RB_GENERATE(pgstandby, standby, entry, standbycmp)
+
+static int	compare_eta(const void *, const void *);
+static int	compare_lag_flush(const void *, const void *);
+static int	compare_lag_replay(const void *, const void *);
+static int	compare_lag_sent(const void *, const void *);
+static int	compare_lag_write(const void *, const void *);
+static int	compare_rate(const void *, const void *);
+static int	compare_time_replay(const void *, const void *);
+
+char	   *replication_ordernames[] = {
+	"rlag", "slag", "wlag", "flag", "rtime", "rate", "eta", NULL
+};
+
+int			(*replication_compares[]) () =
+{
+	compare_lag_replay,
+		compare_lag_sent,
+		compare_lag_write,
+		compare_lag_flush,
+		compare_time_replay,
+		compare_rate,
+		compare_eta,
+		NULL
+};
+
+static struct standby **standbytable;
+static int	standbytable_size;
+static int	standby_index;
+static int	nstandbys;
+static unsigned int sample;
+
+/* the standbys of the last sample as rows, and those of a recording */
+static struct replication_row *rowtable;
+static int	rowtable_size;
+static struct standby *replayed_standbys;
+static int	replayed_size;
+
+/* what the server does as a standby, shown before the standbys */
+#define NCONFLICTS (STANDBY_CONFL_LOGICALSLOT - STANDBY_CONFL_TABLESPACE + 1)
+static char *conflictnames[NCONFLICTS] =
+{
+	"tablespace", "lock", "snapshot", "bufferpin", "deadlock", "logicalslot"
+};
+static char recovery[2][MAX_COLS];
+static int	nrecovery;
+static int	recovery_index;
+
+/* the counters of the server as a standby, in recovery_stats */
+enum RecoveryStat
+{
+	RECOVERY_STAT_REPLAYED,
+	RECOVERY_STAT_CONFLICTS,	/* NCONFLICTS of them */
+	RECOVERY_STATS = RECOVERY_STAT_CONFLICTS + NCONFLICTS
+};
+static struct delta_stats recovery_stats;
+
+int
+standbycmp(struct standby *e1, struct standby *e2)
+{
+	return (e1->pid < e2->pid ? -1 : e1->pid > e2->pid);
+}
+
+/*
+ * Parse an LSN, formatted as two 32-bit hexadecimal numbers separated by a
+ * slash, into a 64-bit integer.  Returns -1 if it is not known.
+ */
+static long long
+parse_lsn(char *value)
+{
+	unsigned int hi,
+				lo;
+
+	if (sscanf(value, "%X/%X", &hi, &lo) != 2)
+		return -1;
+	return ((long long) hi << 32) | lo;
+}
+
+static char *
+format_lsn(long long lsn)
+{
+	static char result[NLSNS][20];
+	static int	index = 0;
+	char	   *ret = result[index];
+
+	index = (index + 1) % NLSNS;
+	if (lsn < 0)
+		ret[0] = '\0';
+	else
+		snprintf(ret, sizeof(result[0]), "%X/%08X",
+				 (unsigned int) (lsn >> 32), (unsigned int) lsn);
+	return ret;
+}
+
+static char *
+format_lag(long long lag)
+{
+	static char result[4][16];
+	static int	index = 0;
+	char	   *ret = result[index];
+
+	index = (index + 1) % 4;
+	if (lag < 0)
+		ret[0] = '\0';
+	else
+		snprintf(ret, sizeof(result[0]), "%s", format_b(lag));
+	return ret;
+}
+
+/* Seconds under a minute are shown to the hundredth. */
+static char *
+format_lag_time(double seconds)
+{
+	static char result[NLAGTIMES][16];
+	static int	index = 0;
+	char	   *ret = result[index];
+
+	index = (index + 1) % NLAGTIMES;
+	if (seconds < 0)
+		ret[0] = '\0';
+	else if (seconds < 60)
+		snprintf(ret, sizeof(result[0]), "%.2fs", seconds);
+	else
+		snprintf(ret, sizeof(result[0]), "%s", format_time((long) seconds));
+	return ret;
+}
+
+/*
+ * Remember the replay lag of a standby and work out how fast it is changing
+ * over the samples kept, and when the standby should have caught up.
+ */
+static void
+update_history(struct standby *n, double now)
+{
+	long long	lag = LAG(n, REP_REPLAY);
+	int			oldest;
+	int			i;
+	double		timediff;
+
+	n->rate = 0;
+	n->eta = -1;
+	if (lag < 0)
+	{
+		n->nhistory = 0;
+		return;
+	}
+
+	i = (n->history_index + n->nhistory) % REPLICATION_HISTORY;
+	n->history_time[i] = now;
+	n->history_lag[i] = lag;
+	if (n->nhistory < REPLICATION_HISTORY)
+		n->nhistory++;
+	else
+		n->history_index = (n->history_index + 1) % REPLICATION_HISTORY;
+
+	if (n->nhistory < 2)
+		return;
+
+	oldest = n->history_index;
+	timediff = now - n->history_time[oldest];
+	if (timediff <= 0)
+		return;
+
+	n->rate = (lag - n->history_lag[oldest]) / timediff;
+	if (lag == 0)
+		n->eta = 0;
+	else if (n->rate < 0)
+		n->eta = lag / -n->rate;
+}
+
+/*
+ * Describe what the server does as a standby, if it is one: where its WAL
+ * receiver gets WAL from, how far it has received and replayed WAL, how fast
+ * it is replaying, and the queries cancelled by conflicts with recovery
+ * since the last sample.
+ */
+static void
+update_recovery(PGresult *pgresult)
+{
+	char	   *s;
+	char	   *end;
+	long long	received;
+	long long	replayed;
+	double	   *value;
+	double		delta[RECOVERY_STATS];
+	double		seconds;
+	int			i;
+
+	nrecovery = 0;
+	if (PQresultStatus(pgresult) != PGRES_TUPLES_OK ||
+		PQntuples(pgresult) != 1 || PQnfields(pgresult) != STANDBY_TYPES ||
+		strcmp(PQgetvalue(pgresult, 0, STANDBY_IN_RECOVERY), "t") != 0)
+	{
+		recovery_stats.samples = 0;
+		return;
+	}
+
+	received = PQgetisnull(pgresult, 0, STANDBY_RECEIVED) ? -1 :
+		strtoll(PQgetvalue(pgresult, 0, STANDBY_RECEIVED), NULL, 10);
+	replayed = PQgetisnull(pgresult, 0, STANDBY_REPLAYED) ? -1 :
+		strtoll(PQgetvalue(pgresult, 0, STANDBY_REPLAYED), NULL, 10);
+	value = delta_next(&recovery_stats);
+	value[RECOVERY_STAT_REPLAYED] = replayed;
+	for (i = 0; i < NCONFLICTS; i++)
+		value[RECOVERY_STAT_CONFLICTS + i] =
+			PQgetisnull(pgresult, 0, STANDBY_CONFL_TABLESPACE + i) ? -1 :
+			strtoll(PQgetvalue(pgresult, 0, STANDBY_CONFL_TABLESPACE + i),
+					NULL, 10);
+	seconds = delta_diff(&recovery_stats, delta, RECOVERY_STATS);
+
+	s = recovery[0];
+	end = s + sizeof(recovery[0]);
+	if (PQgetisnull(pgresult, 0, STANDBY_STATUS))
+		s += snprintf(s, end - s, "Standby: no WAL receiver");
+	else
+	{
+		s += snprintf(s, end - s, "Standby: receiver %.16s",
+					  PQgetvalue(pgresult, 0, STANDBY_STATUS));
+		if (!PQgetisnull(pgresult, 0, STANDBY_SENDER_HOST))
+			s += snprintf(s, end - s, " from %.64s:%s",
+						  PQgetvalue(pgresult, 0, STANDBY_SENDER_HOST),
+						  PQgetvalue(pgresult, 0, STANDBY_SENDER_PORT));
+		if (!PQgetisnull(pgresult, 0, STANDBY_SLOT))
+			s += snprintf(s, end - s, " slot %.64s",
+						  PQgetvalue(pgresult, 0, STANDBY_SLOT));
+	}
+	if (received >= 0 && s < end)
+		s += snprintf(s, end - s, ", received %s", format_lsn(received));
+	if (replayed >= 0 && s < end)
+	{
+		s += snprintf(s, end - s, ", replayed %s", format_lsn(replayed));
+		if (received >= 0 && s < end)
+			s += snprintf(s, end - s, " (%s behind)",
+						  format_b(received > replayed ?
+								   received - replayed : 0));
+		if (seconds > 0 && delta[RECOVERY_STAT_REPLAYED] >= 0 && s < end)
+			s += snprintf(s, end - s, ", %s/s replayed",
+						  format_b((long long)
+								   (delta[RECOVERY_STAT_REPLAYED] /
+									seconds)));
+	}
+	if (!PQgetisnull(pgresult, 0, STANDBY_DELAY) && s < end)
+		snprintf(s, end - s, ", last transaction replayed was %s old",
+				 format_lag_time(atof(PQgetvalue(pgresult, 0,
+												 STANDBY_DELAY))));
+
+	s = recovery[1];
+	end = s + sizeof(recovery[1]);
+	s += snprintf(s, end - s, "Recovery conflicts:");
+	for (i = 0; i < NCONFLICTS && s < end; i++)
+	{
+		if (value[RECOVERY_STAT_CONFLICTS + i] < 0)
+			continue;
+		if (seconds > 0 && delta[RECOVERY_STAT_CONFLICTS + i] >= 0)
+			s += snprintf(s, end - s, " %.0f %s",
+						  delta[RECOVERY_STAT_CONFLICTS + i], conflictnames[i]);
+		else
+			s += snprintf(s, end - s, " - %s", conflictnames[i]);
+	}
+	nrecovery = 2;
+}
+
+/*
+ * Sample the standbys and put them in order by compare_index.
+ */
+caddr_t
+get_replication_info(struct system_info *si, struct pg_conninfo_ctx *conninfo,
+					 int compare_index)
+{
+	double		thistime;
+	struct standby *n,
+			   *p,
+			   *tmp;
+	PGresult   *pgresult = NULL;
+	PGresult   *r;
+	int			rows = 0;
+	int			i,
+				j;
+
+	thistime = sample_time();
+	++sample;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_replication(conninfo->connection);
+		if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+		{
+			new_message(MT_standout | MT_delayed, " %s",
+						PQresultErrorMessage(pgresult));
+		}
+		else
+		{
+			rows = PQntuples(pgresult);
+		}
+		r = pg_standby(conninfo->connection);
+		update_recovery(r);
+		PQclear(r);
+	}
+	else
+	{
+		nrecovery = 0;
+	}
+
+	if (rows > standbytable_size)
+	{
+		standbytable = reallocarray(standbytable, rows,
+									sizeof(struct standby *));
+		if (standbytable == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		standbytable_size = rows;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		n = malloc(sizeof(struct standby));
+		if (n == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		memset(n, 0, sizeof(struct standby));
+		n->pid = atoi(PQgetvalue(pgresult, i, REP_PID));
+		p = RB_INSERT(pgstandby, &head_standby, n);
+		if (p != NULL)
+		{
+			free(n);
+			n = p;
+		}
+		n->sample = sample;
+		standbytable[i] = n;
+
+		update_str(&n->usename, PQgetvalue(pgresult, i, REP_USENAME));
+		update_str(&n->application_name,
+				   PQgetvalue(pgresult, i, REP_APPLICATION_NAME));
+		update_str(&n->client_addr, PQgetvalue(pgresult, i, REP_CLIENT_ADDR));
+		update_str(&n->state, PQgetvalue(pgresult, i, REP_STATE));
+		for (j = REP_PRIMARY; j <= REP_REPLAY; j++)
+			LSN(n, j) = parse_lsn(PQgetvalue(pgresult, i, j));
+		for (j = REP_WRITE_TIME; j <= REP_REPLAY_TIME; j++)
+			LAGTIME(n, j) = PQgetisnull(pgresult, i, j) ? -1 :
+				atof(PQgetvalue(pgresult, i, j));
+
+		update_history(n, thistime);
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+	disconnect_from_db(conninfo);
+
+	/* forget the standbys that went away */
+	RB_FOREACH_SAFE(n, pgstandby, &head_standby, tmp)
+	{
+		if (n->sample != sample)
+		{
+			RB_REMOVE(pgstandby, &head_standby, n);
+			free(n->usename);
+			free(n->application_name);
+			free(n->client_addr);
+			free(n->state);
+			free(n);
+		}
+	}
+
+	if (compare_index >= 0 && rows > 0)
+		qsort(standbytable, rows, sizeof(struct standby *),
+			  replication_compares[compare_index]);
+
+	si->P_ACTIVE = nrecovery + rows;
+	nstandbys = rows;
+	standby_index = 0;
+	recovery_index = 0;
+	return (caddr_t) 0;
+}
+
+/*
+ * The standbys of the last sample as rows to be recorded, and the lines shown
+ * before them.
+ */
+int
+get_replication_rows(struct replication_row **rows, char ***lines,
+					 int *nlines)
+{
+	static char *recovery_lines[2];
+	struct replication_row *r;
+	struct standby *p;
+	int			i;
+
+	if (nstandbys > rowtable_size)
+	{
+		r = reallocarray(rowtable, nstandbys, sizeof(struct replication_row));
+		if (r == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		rowtable = r;
+		rowtable_size = nstandbys;
+	}
+
+	for (i = 0; i < nstandbys; i++)
+	{
+		p = standbytable[i];
+		r = &rowtable[i];
+		r->pid = p->pid;
+		r->usename = p->usename;
+		r->application_name = p->application_name;
+		r->client_addr = p->client_addr;
+		r->state = p->state;
+		memcpy(r->lsn, p->lsn, sizeof(r->lsn));
+		memcpy(r->lagtime, p->lagtime, sizeof(r->lagtime));
+		r->rated = p->nhistory >= 2;
+		r->rate = p->rate;
+		r->eta = p->eta;
+	}
+
+	for (i = 0; i < nrecovery; i++)
+		recovery_lines[i] = recovery[i];
+	*lines = recovery_lines;
+	*nlines = nrecovery;
+	*rows = rowtable;
+	return nstandbys;
+}
+
+/* Show recorded standbys as if they were sampled, in order by compare_index. */
+caddr_t
+put_replication_rows(struct system_info *si, struct replication_row *rows,
+					 int nrows, char **lines, int nlines, int compare_index)
+{
+	struct standby *p;
+	struct replication_row *r;
+	int			i;
+
+	if (nrows > replayed_size)
+	{
+		replayed_standbys = reallocarray(replayed_standbys, nrows,
+										 sizeof(struct standby));
+		if (replayed_standbys == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		replayed_size = nrows;
+	}
+	if (nrows > standbytable_size)
+	{
+		standbytable = reallocarray(standbytable, nrows,
+									sizeof(struct standby *));
+		if (standbytable == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		standbytable_size = nrows;
+	}
+
+	for (i = 0; i < nrows; i++)
+	{
+		r = &rows[i];
+		p = &replayed_standbys[i];
+		memset(p, 0, sizeof(struct standby));
+		p->pid = r->pid;
+		p->usename = r->usename;
+		p->application_name = r->application_name;
+		p->client_addr = r->client_addr;
+		p->state = r->state;
+		memcpy(p->lsn, r->lsn, sizeof(p->lsn));
+		memcpy(p->lagtime, r->lagtime, sizeof(p->lagtime));
+		p->nhistory = r->rated ? 2 : 0;
+		p->rate = r->rate;
+		p->eta = r->eta;
+		standbytable[i] = p;
+	}
+
+	nrecovery = nlines < 2 ? nlines : 2;
+	for (i = 0; i < nrecovery; i++)
+		snprintf(recovery[i], sizeof(recovery[i]), "%s", lines[i]);
+
+	if (compare_index >= 0 && nrows > 0)
+		qsort(standbytable, nrows, sizeof(struct standby *),
+			  replication_compares[compare_index]);
+
+	si->P_ACTIVE = nrecovery + nrows;
+	nstandbys = nrows;
+	standby_index = 0;
+	recovery_index = 0;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_replication(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		rate[16];
+	char		eta[10];
+	struct standby *p;
+
+	if (recovery_index < nrecovery)
+		return recovery[recovery_index++];
+	p = standbytable[standby_index++];
+
+	/* a negative rate means the standby is catching up */
+	if (p->nhistory < 2)
+		rate[0] = '\0';
+	else if (p->rate < 0)
+		snprintf(rate, sizeof(rate), "-%s/s", format_b((long long) -p->rate));
+	else
+		snprintf(rate, sizeof(rate), "%s/s", format_b((long long) p->rate));
+
+	if (p->eta >= 0)
+		snprintf(eta, sizeof(eta), "%s", format_time((long) p->eta));
+	else
+		eta[0] = '\0';
+
+	snprintf(fmt, sizeof(fmt),
+			 "%7d %-8.8s %-11.11s %15s %-9.9s %5s %5s %5s %5s %6s %6s %6s %7s %6s %-17s %-17s %-17s %-17s %s",
+			 p->pid,
+			 p->usename,
+			 p->application_name,
+			 p->client_addr,
+			 p->state,
+			 format_lag(LAG(p, REP_SENT)),
+			 format_lag(LAG(p, REP_WRITE)),
+			 format_lag(LAG(p, REP_FLUSH)),
+			 format_lag(LAG(p, REP_REPLAY)),
+			 format_lag_time(LAGTIME(p, REP_WRITE_TIME)),
+			 format_lag_time(LAGTIME(p, REP_FLUSH_TIME)),
+			 format_lag_time(LAGTIME(p, REP_REPLAY_TIME)),
+			 rate,
+			 eta,
+			 format_lsn(LSN(p, REP_PRIMARY)),
+			 format_lsn(LSN(p, REP_SENT)),
+			 format_lsn(LSN(p, REP_WRITE)),
+			 format_lsn(LSN(p, REP_FLUSH)),
+			 format_lsn(LSN(p, REP_REPLAY)));
+
+	return (fmt);
+}
+
+/*
+ * Comparison routines for qsort, largest first.  What is not known sorts
+ * last.
+ */
+
+#define ORDERKEY_LAG(i)  if ((result = (LAG(p2, i) > LAG(p1, i)) - \
+                                       (LAG(p2, i) < LAG(p1, i))) == 0)
+#define ORDERKEY_LAGTIME(i) if ((result = (LAGTIME(p2, i) > LAGTIME(p1, i)) - \
+                                          (LAGTIME(p2, i) < LAGTIME(p1, i))) == 0)
+#define ORDERKEY_RATE    if ((result = (p2->rate > p1->rate) - \
+                                       (p2->rate < p1->rate)) == 0)
+#define ORDERKEY_ETA     if ((result = (p2->eta > p1->eta) - \
+                                       (p2->eta < p1->eta)) == 0)
+#define ORDERKEY_PID     if ((result = (p1->pid > p2->pid) - \
+                                       (p1->pid < p2->pid)) == 0)
+
+static int
+compare_eta(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_ETA
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_lag_flush(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_LAG(REP_FLUSH)
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_lag_replay(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_LAG(REP_FLUSH)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_lag_sent(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_LAG(REP_SENT)
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_lag_write(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_LAG(REP_WRITE)
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_rate(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_RATE
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
+
+static int
+compare_time_replay(const void *v1, const void *v2)
+{
+	struct standby *p1 = *(struct standby **) v1;
+	struct standby *p2 = *(struct standby **) v2;
+	int			result;
+
+	ORDERKEY_LAGTIME(REP_REPLAY_TIME)
+		ORDERKEY_LAG(REP_REPLAY)
+		ORDERKEY_PID
+		;
+
+	return (result);
+}
@@ -0,0 +1,40 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _REPLICATION_H_
+#define _REPLICATION_H_
+
+#include "machine.h"
+
+/* number of samples the rate the replay lag changes at is measured over */
+#define REPLICATION_HISTORY 10
+
+/* the positions in WAL and the lag times that are kept for each standby */
+#define NLSNS (REP_REPLAY - REP_PRIMARY + 1)
+#define NLAGTIMES (REP_REPLAY_TIME - REP_WRITE_TIME + 1)
+
+/* a standby of the last sample, as it is recorded and replayed */
+struct replication_row
+{
+	int			pid;
+	char	   *usename;
+	char	   *application_name;
+	char	   *client_addr;
+	char	   *state;
+	long long	lsn[NLSNS];
+	double		lagtime[NLAGTIMES];
+	int			rated;			/* whether the rate is known yet */
+	double		rate;
+	double		eta;
+};
+
+caddr_t		get_replication_info(struct system_info *,
+								 struct pg_conninfo_ctx *, int);
+char	   *format_next_replication(caddr_t);
+int			get_replication_rows(struct replication_row **, char ***, int *);
+caddr_t		put_replication_rows(struct system_info *, struct replication_row *,
+								 int, char **, int, int);
+
+extern char fmt_header_replication[];
+extern char *replication_ordernames[];
+
+#endif							/* _REPLICATION_H_ */
@@ -0,0 +1,423 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Serving: one pg_top samples the server and publishes each update into a
+ * file that any number of others map read only and show, without connecting
+ * to the server themselves.  Putting the file in a memory file system, such
+ * as /dev/shm, keeps it in shared memory.
+ *
+ * The file is a ring of the last few updates, each whole: the numbers of the
+ * header lines and the lines of the display as they were formatted.  The
+ * update being written is marked with an odd sequence number, so a viewer
+ * that copied it while it changed can tell and copy it again.
+ */
+
+#include "os.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "display.h"
+#include "serve.h"
+#include "pg.h"
+#include "utils.h"
+
+#define SERVE_MAGIC "pg_top serve 2"
+
+/* how many delays without an update before it is said to be old */
+#define STALE_UPDATES 3
+
+struct serve_header
+{
+	char		magic[16];
+	int			info_size;		/* sizeof(struct serve_info) */
+	pid_t		pid;			/* of the pg_top serving */
+	int			delay;
+	struct serve_statics statics;
+
+	/* the number of updates published, the last at latest % SERVE_SLOTS */
+	volatile unsigned long long latest;
+};
+
+struct serve_update
+{
+	/* twice the number of the update, less one while it is written */
+	volatile unsigned long long sequence;
+	struct serve_info info;
+
+	int			nlines;
+	char		lines[SERVE_LINES][MAX_COLS];
+};
+
+struct serve_file
+{
+	struct serve_header header;
+	struct serve_update updates[SERVE_SLOTS];
+};
+
+static struct serve_file *serve_file;
+static struct serve_update *writing;
+
+/* a viewer's copy of the header, and of the last two updates it read */
+static struct serve_header served_header;
+static struct serve_update served[2];
+static int	current;
+static int	served_index;
+
+/* the names in the statics of a viewer */
+static char *statics_names[4][SERVE_NAMES + 1];
+
+static void
+put_names(struct serve_names *served, char **names)
+{
+	served->count = 0;
+	if (names == NULL)
+	{
+		served->count = -1;
+		return;
+	}
+	for (; *names != NULL && served->count < SERVE_NAMES; names++)
+		snprintf(served->names[served->count++], SERVE_NAME_LEN, "%s",
+				 *names);
+}
+
+static char **
+get_names(struct serve_names *served, char **names)
+{
+	int			i;
+
+	if (served->count < 0)
+		return NULL;
+	for (i = 0; i < served->count && i < SERVE_NAMES; i++)
+		names[i] = served->names[i];
+	names[i] = NULL;
+	return names;
+}
+
+/* Keep what the header lines are shown with. */
+void
+put_serve_statics(struct serve_statics *ss, struct statics *statics)
+{
+	memset(ss, 0, sizeof(struct serve_statics));
+	ss->boottime = statics->boottime;
+	ss->ncpus = statics->ncpus;
+	ss->diskstats = statics->flags.diskstats;
+	put_names(&ss->procstates, statics->procstate_names);
+	put_names(&ss->cpustates, statics->cpustate_names);
+	put_names(&ss->memory, statics->memory_names);
+	put_names(&ss->swap, statics->swap_names);
+}
+
+/*
+ * Fill in the statics from what was kept, which has to stay put for as long
+ * as they are used.
+ */
+void
+get_serve_statics(struct serve_statics *ss, struct statics *statics)
+{
+	statics->procstate_names = get_names(&ss->procstates, statics_names[0]);
+	statics->cpustate_names = get_names(&ss->cpustates, statics_names[1]);
+	statics->memory_names = get_names(&ss->memory, statics_names[2]);
+	statics->swap_names = get_names(&ss->swap, statics_names[3]);
+	statics->boottime = ss->boottime;
+	statics->ncpus = ss->ncpus;
+	statics->flags.diskstats = ss->diskstats;
+}
+
+/* Keep the numbers of the header lines of an update. */
+void
+put_serve_info(struct serve_info *info, struct serve_statics *ss,
+			   struct system_info *si, struct db_info *db,
+			   struct wal_info *wal, struct bgwriter_info *bgwriter,
+			   char *header)
+{
+	/* zeroed, so that what is not used compares the same every update */
+	memset(info, 0, sizeof(struct serve_info));
+	time(&info->time);
+	info->last_pid = si->last_pid;
+	memcpy(info->load_avg, si->load_avg, sizeof(info->load_avg));
+	info->p_total = si->p_total;
+	if (si->procstates != NULL)
+		memcpy(info->procstates, si->procstates,
+			   ss->procstates.count * sizeof(int));
+	if (si->cpustates != NULL)
+		memcpy(info->cpustates, si->cpustates,
+			   ss->cpustates.count * sizeof(int64_t));
+	if (si->memory != NULL)
+		memcpy(info->memory, si->memory, ss->memory.count * sizeof(long));
+	if (si->swap != NULL && ss->swap.count > 0)
+		memcpy(info->swap, si->swap, ss->swap.count * sizeof(long));
+
+	info->has_disk = si->disk != NULL;
+	if (si->disk != NULL)
+	{
+		info->disk = *si->disk;
+		info->disk.busiest = NULL;
+		snprintf(info->busiest, sizeof(info->busiest), "%s",
+				 si->disk->busiest != NULL ? si->disk->busiest : "");
+	}
+	info->db = *db;
+	info->db.datname = NULL;
+	snprintf(info->datname, sizeof(info->datname), "%s",
+			 db->datname != NULL ? db->datname : "");
+	info->wal = *wal;
+	info->bgwriter = *bgwriter;
+	snprintf(info->header, sizeof(info->header), "%s",
+			 header != NULL ? header : "");
+}
+
+/*
+ * Fill in the system information and database activity from the numbers kept
+ * of an update, which has to stay put for as long as they are used.
+ */
+void
+get_serve_info(struct serve_info *info, struct system_info *si,
+			   struct db_info *db, struct wal_info *wal,
+			   struct bgwriter_info *bgwriter, char **header)
+{
+	si->last_pid = info->last_pid;
+	memcpy(si->load_avg, info->load_avg, sizeof(si->load_avg));
+	si->p_total = info->p_total;
+	si->procstates = info->procstates;
+	si->cpustates = info->cpustates;
+	si->memory = info->memory;
+	si->swap = info->swap;
+	si->disk = NULL;
+	if (info->has_disk)
+	{
+		si->disk = &info->disk;
+		info->disk.busiest = info->busiest[0] != '\0' ? info->busiest : NULL;
+	}
+
+	*db = info->db;
+	db->datname = info->datname[0] != '\0' ? info->datname : NULL;
+	*wal = info->wal;
+	*bgwriter = info->bgwriter;
+	*header = info->header[0] != '\0' ? info->header : NULL;
+}
+
+/*
+ * Create the file updates are published in.  It is written under another
+ * name and renamed, so that a viewer never sees it half made, and a viewer
+ * of a file it replaces keeps showing the last update of that one.
+ */
+int
+serve_init(char *path, struct statics *statics, int delay)
+{
+	struct serve_header *h;
+	char		tmp[MAXPATHLEN];
+	int			fd;
+
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if ((fd = mkstemp(tmp)) == -1)
+	{
+		fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+	if (fchmod(fd, 0644) == -1 ||
+		ftruncate(fd, sizeof(struct serve_file)) == -1 ||
+		(serve_file = mmap(NULL, sizeof(struct serve_file),
+						   PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) ==
+		MAP_FAILED)
+	{
+		fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+		close(fd);
+		unlink(tmp);
+		return -1;
+	}
+	close(fd);
+
+	h = &serve_file->header;
+	snprintf(h->magic, sizeof(h->magic), "%s", SERVE_MAGIC);
+	h->info_size = sizeof(struct serve_info);
+	h->pid = getpid();
+	h->delay = delay;
+	put_serve_statics(&h->statics, statics);
+	h->latest = 0;
+
+	if (msync(serve_file, sizeof(struct serve_header), MS_SYNC) == -1 ||
+		rename(tmp, path) == -1)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/* Start writing an update, with the numbers of its header lines. */
+void
+serve_begin(struct system_info *si, struct db_info *db, struct wal_info *wal,
+			struct bgwriter_info *bgwriter, char *header)
+{
+	struct serve_header *h = &serve_file->header;
+	unsigned long long next = h->latest + 1;
+	struct serve_update *u = &serve_file->updates[next % SERVE_SLOTS];
+
+	u->sequence = next * 2 - 1;
+	__sync_synchronize();
+
+	put_serve_info(&u->info, &h->statics, si, db, wal, bgwriter, header);
+	u->nlines = 0;
+
+	writing = u;
+}
+
+/* Add the next line of the display to the update being written. */
+void
+serve_line(char *line)
+{
+	if (writing->nlines < SERVE_LINES)
+		snprintf(writing->lines[writing->nlines++], MAX_COLS, "%s", line);
+}
+
+/* Publish the update being written. */
+void
+serve_end(void)
+{
+	struct serve_header *h = &serve_file->header;
+
+	__sync_synchronize();
+	writing->sequence = (h->latest + 1) * 2;
+	__sync_synchronize();
+	h->latest++;
+	writing = NULL;
+}
+
+/*
+ * Map the file a pg_top serving publishes in, and fill in the statics it
+ * sampled with.
+ */
+int
+attach_init(char *path, struct statics *statics)
+{
+	struct stat st;
+	int			fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) == -1 ||
+		(st.st_size >= sizeof(struct serve_file) &&
+		 (serve_file = mmap(NULL, sizeof(struct serve_file), PROT_READ,
+							MAP_SHARED, fd, 0)) == MAP_FAILED))
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	if (st.st_size < sizeof(struct serve_file) ||
+		strncmp(serve_file->header.magic, SERVE_MAGIC,
+				sizeof(serve_file->header.magic)) != 0 ||
+		serve_file->header.info_size != sizeof(struct serve_info))
+	{
+		fprintf(stderr, "%s: not written by this version of pg_top --serve\n",
+				path);
+		if (st.st_size >= sizeof(struct serve_file))
+			munmap(serve_file, sizeof(struct serve_file));
+		return -1;
+	}
+
+	served_header = serve_file->header;
+	get_serve_statics(&served_header.statics, statics);
+	return 0;
+}
+
+/*
+ * Copy the last update published, trying again if it changed while it was
+ * copied.  Returns whether there was one to copy.
+ */
+static int
+copy_update(void)
+{
+	struct serve_update *u;
+	struct serve_update *copy = &served[!current];
+	unsigned long long latest;
+	unsigned long long sequence;
+	int			tries;
+
+	for (tries = 0; tries < SERVE_SLOTS; tries++)
+	{
+		latest = serve_file->header.latest;
+		if (latest == 0)
+			return 0;
+		__sync_synchronize();
+
+		u = &serve_file->updates[latest % SERVE_SLOTS];
+		sequence = u->sequence;
+		if (sequence != latest * 2)
+			continue;
+		__sync_synchronize();
+
+		memcpy(copy, u, offsetof(struct serve_update, lines));
+		if (copy->nlines < 0 || copy->nlines > SERVE_LINES)
+			continue;
+		memcpy(copy->lines, u->lines, copy->nlines * MAX_COLS);
+
+		__sync_synchronize();
+		if (u->sequence == sequence)
+		{
+			current = !current;
+			return 1;
+		}
+	}
+
+	/* keep showing the one before */
+	return served[current].sequence != 0;
+}
+
+/*
+ * Show the last update published, saying when it is old because the pg_top
+ * serving stopped or fell behind.
+ */
+caddr_t
+get_served_info(struct system_info *si, struct db_info *db,
+				struct wal_info *wal, struct bgwriter_info *bgwriter,
+				char **header)
+{
+	struct serve_update *u = &served[current];
+	time_t		now;
+
+	if (!copy_update())
+	{
+		new_message(MT_standout | MT_delayed,
+					" Waiting for the first update of pg_top --serve");
+		memset(u, 0, offsetof(struct serve_update, lines));
+		u->info.db.hit = -1;
+	}
+	else
+	{
+		u = &served[current];
+		time(&now);
+		if (kill(served_header.pid, 0) == -1 && errno == ESRCH)
+			new_message(MT_standout | MT_delayed,
+						" pg_top --serve stopped, last update at %.8s",
+						ctime(&u->info.time) + 11);
+		else if (now - u->info.time > STALE_UPDATES *
+				 (served_header.delay > 0 ? served_header.delay : 1))
+			new_message(MT_standout | MT_delayed,
+						" No update since %.8s", ctime(&u->info.time) + 11);
+	}
+
+	get_serve_info(&u->info, si, db, wal, bgwriter, header);
+	si->P_ACTIVE = u->nlines;
+
+	served_index = 0;
+	return (caddr_t) u;
+}
+
+char *
+format_next_served(caddr_t handle)
+{
+	struct serve_update *u = (struct serve_update *) handle;
+
+	return u->lines[served_index++];
+}
@@ -0,0 +1,81 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _SERVE_H_
+#define _SERVE_H_
+
+#include "machine.h"
+
+/* updates kept in the file, so that a slow viewer is not overtaken */
+#define SERVE_SLOTS 4
+
+/* most lines of an update that are kept */
+#define SERVE_LINES 1024
+
+/* most names of each kind in the header */
+#define SERVE_NAMES 16
+
+/* longest name of a state, a part of memory or a disk */
+#define SERVE_NAME_LEN 24
+
+/* the names of one kind of header line, from the statics */
+struct serve_names
+{
+	int			count;			/* -1 for no such line */
+	char		names[SERVE_NAMES][SERVE_NAME_LEN];
+};
+
+/* what the header lines are shown with, from the statics */
+struct serve_statics
+{
+	time_t		boottime;
+	int			ncpus;
+	int			diskstats;
+	struct serve_names procstates;
+	struct serve_names cpustates;
+	struct serve_names memory;
+	struct serve_names swap;
+};
+
+/* the numbers of the header lines of an update, without pointers */
+struct serve_info
+{
+	time_t		time;
+	int			last_pid;
+	double		load_avg[NUM_AVERAGES];
+	int			p_total;
+	int			procstates[SERVE_NAMES];
+	int64_t		cpustates[SERVE_NAMES];
+	long		memory[SERVE_NAMES];
+	long		swap[SERVE_NAMES];
+	int			has_disk;
+	struct disk_info disk;
+	char		busiest[SERVE_NAME_LEN];
+	struct db_info db;
+	char		datname[NAMEDATALEN];
+	struct wal_info wal;
+	struct bgwriter_info bgwriter;
+	char		header[MAX_COLS];
+};
+
+void		put_serve_statics(struct serve_statics *, struct statics *);
+void		get_serve_statics(struct serve_statics *, struct statics *);
+void		put_serve_info(struct serve_info *, struct serve_statics *,
+						   struct system_info *, struct db_info *,
+						   struct wal_info *, struct bgwriter_info *, char *);
+void		get_serve_info(struct serve_info *, struct system_info *,
+						   struct db_info *, struct wal_info *,
+						   struct bgwriter_info *, char **);
+
+int			serve_init(char *, struct statics *, int);
+void		serve_begin(struct system_info *, struct db_info *,
+						struct wal_info *, struct bgwriter_info *, char *);
+void		serve_line(char *);
+void		serve_end(void);
+
+int			attach_init(char *, struct statics *);
+caddr_t		get_served_info(struct system_info *, struct db_info *,
+							struct wal_info *, struct bgwriter_info *,
+							char **);
+char	   *format_next_served(caddr_t);
+
+#endif							/* _SERVE_H_ */
@@ -0,0 +1,413 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Replication slots: how much WAL each slot keeps from being removed, how
+ * fast that is growing, and whether max_slot_wal_keep_size is about to
+ * invalidate it, from pg_replication_slots.  Logical slots also show how much
+ * decoding spilled to disk and streamed to the subscriber, from
+ * pg_stat_replication_slots.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "delta.h"
+#include "display.h"
+#include "slots.h"
+#include "pg.h"
+#include "utils.h"
+
+char		fmt_header_slots[] =
+"SLOT                 TYPE         PID DATABASE   RETAINED UNCONFRM    GROWTH STATUS       SAFE    SPILL   STREAM";
+
+/*
+ * The bytes of a slot kept from one sample to the next, -1 if unknown.  The
+ * counters come first.
+ */
+enum SlotStat
+{
+	SLOT_STAT_SPILL,
+	SLOT_STAT_STREAM,
+	SLOT_COUNTERS,
+	SLOT_STAT_RETAINED = SLOT_COUNTERS
+};
+
+struct slot
+{
+	RB_ENTRY(slot) entry;
+	char	   *name;
+
+	/* the last sample this slot was seen in */
+	unsigned int sample;
+
+	char	   *type;
+	char	   *database;
+	char	   *wal_status;
+	int			pid;			/* 0 when the slot is not in use */
+	long long	retained;		/* bytes of WAL kept, or -1 if none */
+	long long	unconfirmed;	/* bytes not confirmed, or -1 if unknown */
+	long long	safe;			/* bytes until invalidated */
+	int			safe_known;
+	struct delta_stats stats;
+
+	double		growth;			/* bytes per second, when growth_known */
+	int			growth_known;
+	double		spill_rate;		/* bytes per second, or -1 if unknown */
+	double		stream_rate;	/* bytes per second, or -1 if unknown */
+};
+
+int			slotcmp(struct slot *, struct slot *);
+
+RB_HEAD(pgslot, slot) head_slot = RB_INITIALIZER(&head_slot);
+RB_PROTOTYPE(pgslot, slot, entry, slotcmp)
+RB_GENERATE(pgslot, slot, entry, slotcmp)
+
+static int	compare_growth(const void *, const void *);
+static int	compare_retained(const void *, const void *);
+static int	compare_slot(const void *, const void *);
+static int	compare_spill(const void *, const void *);
+static int	compare_stream(const void *, const void *);
+
+char	   *slot_ordernames[] = {
+	"retained", "growth", "spill", "stream", "slot", NULL
+};
+
+int			(*slot_compares[]) () =
+{
+	compare_retained,
+		compare_growth,
+		compare_spill,
+		compare_stream,
+		compare_slot,
+		NULL
+};
+
+static struct slot **slottable;
+static int	slottable_size;
+static int	slot_index;
+static unsigned int sample;
+
+int
+slotcmp(struct slot *e1, struct slot *e2)
+{
+	return strcmp(e1->name, e2->name);
+}
+
+static long long
+get_bytes(PGresult *pgresult, int row, int column)
+{
+	if (PQgetisnull(pgresult, row, column))
+		return -1;
+	return strtoll(PQgetvalue(pgresult, row, column), NULL, 10);
+}
+
+/* Bytes that may be negative, which format_b() does not handle. */
+static char *
+format_signed_b(long long amt, char *buf, size_t size)
+{
+	if (amt < 0)
+		snprintf(buf, size, "-%s", format_b(-amt));
+	else
+		snprintf(buf, size, "%s", format_b(amt));
+	return buf;
+}
+
+/*
+ * Sample the replication slots and put them in order by compare_index.
+ */
+caddr_t
+get_slot_info(struct system_info *si, struct pg_conninfo_ctx *conninfo,
+			  int compare_index)
+{
+	struct slot *n,
+			   *p,
+			   *tmp;
+	PGresult   *pgresult = NULL;
+	double		delta[SLOT_COUNTERS];
+	double		seconds;
+	double	   *value;
+	double		retained;
+	int			rows = 0;
+	int			i;
+
+	++sample;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection != NULL)
+	{
+		pgresult = pg_slots(conninfo->connection);
+		if (pgresult == NULL)
+		{
+			new_message(MT_standout | MT_delayed,
+						" Replication slots need PostgreSQL 9.4 or later");
+		}
+		else if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+		{
+			new_message(MT_standout | MT_delayed, " %s",
+						PQresultErrorMessage(pgresult));
+		}
+		else
+		{
+			rows = PQntuples(pgresult);
+		}
+	}
+
+	if (rows > slottable_size)
+	{
+		slottable = reallocarray(slottable, rows, sizeof(struct slot *));
+		if (slottable == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		slottable_size = rows;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		n = malloc(sizeof(struct slot));
+		if (n == NULL)
+		{
+			fprintf(stderr, "malloc error\n");
+			PQclear(pgresult);
+			disconnect_from_db(conninfo);
+			exit(1);
+		}
+		memset(n, 0, sizeof(struct slot));
+		n->name = PQgetvalue(pgresult, i, SLOT_NAME);
+		p = RB_INSERT(pgslot, &head_slot, n);
+		if (p != NULL)
+		{
+			free(n);
+			n = p;
+		}
+		else
+		{
+			n->name = strdup(n->name);
+		}
+		n->sample = sample;
+		slottable[i] = n;
+
+		update_str(&n->type, PQgetvalue(pgresult, i, SLOT_TYPE));
+		update_str(&n->database, PQgetvalue(pgresult, i, SLOT_DATABASE));
+		update_str(&n->wal_status, PQgetvalue(pgresult, i, SLOT_WAL_STATUS));
+		n->pid = atoi(PQgetvalue(pgresult, i, SLOT_PID));
+		n->retained = get_bytes(pgresult, i, SLOT_RETAINED);
+		n->unconfirmed = get_bytes(pgresult, i, SLOT_UNCONFIRMED);
+		n->safe_known = !PQgetisnull(pgresult, i, SLOT_SAFE_WAL_SIZE);
+		n->safe = get_bytes(pgresult, i, SLOT_SAFE_WAL_SIZE);
+
+		value = delta_next(&n->stats);
+		value[SLOT_STAT_SPILL] = get_bytes(pgresult, i, SLOT_SPILL_BYTES);
+		value[SLOT_STAT_STREAM] = get_bytes(pgresult, i, SLOT_STREAM_BYTES);
+		value[SLOT_STAT_RETAINED] = n->retained;
+
+		/* counters go backwards when the statistics are reset */
+		seconds = delta_diff(&n->stats, delta, SLOT_COUNTERS);
+		n->spill_rate = seconds > 0 && delta[SLOT_STAT_SPILL] >= 0 ?
+			delta[SLOT_STAT_SPILL] / seconds : -1;
+		n->stream_rate = seconds > 0 && delta[SLOT_STAT_STREAM] >= 0 ?
+			delta[SLOT_STAT_STREAM] / seconds : -1;
+
+		/* retained WAL shrinks as the slot advances, so it is not a counter */
+		retained = n->stats.value[(n->stats.index + 1) % 2][SLOT_STAT_RETAINED];
+		n->growth_known = seconds > 0 && n->retained >= 0 && retained >= 0;
+		if (n->growth_known)
+			n->growth = (n->retained - retained) / seconds;
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+	disconnect_from_db(conninfo);
+
+	/* forget the slots that were dropped */
+	RB_FOREACH_SAFE(n, pgslot, &head_slot, tmp)
+	{
+		if (n->sample != sample)
+		{
+			RB_REMOVE(pgslot, &head_slot, n);
+			free(n->name);
+			free(n->type);
+			free(n->database);
+			free(n->wal_status);
+			free(n);
+		}
+	}
+
+	if (compare_index >= 0 && rows > 0)
+		qsort(slottable, rows, sizeof(struct slot *),
+			  slot_compares[compare_index]);
+
+	si->P_ACTIVE = rows;
+	slot_index = 0;
+	return (caddr_t) 0;
+}
+
+char *
+format_next_slot(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		pid[16];
+	char		retained[16];
+	char		unconfirmed[16];
+	char		growth[16];
+	char		safe[16];
+	char		spill[16];
+	char		stream[16];
+	struct slot *p = slottable[slot_index++];
+	long long	r = p->retained;
+
+	if (p->pid > 0)
+		snprintf(pid, sizeof(pid), "%d", p->pid);
+	else
+		pid[0] = '\0';
+
+	if (r >= 0)
+		snprintf(retained, sizeof(retained), "%s", format_b(r));
+	else
+		retained[0] = '\0';
+
+	if (p->unconfirmed >= 0)
+		snprintf(unconfirmed, sizeof(unconfirmed), "%s",
+				 format_b(p->unconfirmed));
+	else
+		unconfirmed[0] = '\0';
+
+	if (p->growth_known)
+	{
+		format_signed_b((long long) p->growth, growth, sizeof(growth) - 2);
+		strcat(growth, "/s");
+	}
+	else
+		growth[0] = '\0';
+
+	/* safe_wal_size goes negative once the slot is past the limit */
+	if (p->safe_known)
+		format_signed_b(p->safe, safe, sizeof(safe));
+	else
+		safe[0] = '\0';
+
+	if (p->spill_rate >= 0)
+		snprintf(spill, sizeof(spill), "%s/s",
+				 format_b((long long) p->spill_rate));
+	else
+		spill[0] = '\0';
+
+	if (p->stream_rate >= 0)
+		snprintf(stream, sizeof(stream), "%s/s",
+				 format_b((long long) p->stream_rate));
+	else
+		stream[0] = '\0';
+
+	snprintf(fmt, sizeof(fmt),
+			 "%-20.20s %-8.8s %7s %-10.10s %8s %8s %9s %-10.10s %6s %8s %8s",
+			 p->name,
+			 p->type,
+			 pid,
+			 p->database,
+			 retained,
+			 unconfirmed,
+			 growth,
+			 p->wal_status,
+			 safe,
+			 spill,
+			 stream);
+
+	return (fmt);
+}
+
+/*
+ * Comparison routines for qsort, largest first.  What is not known sorts
+ * last.
+ */
+
+#define RETAINED(p) ((p)->retained)
+#define GROWTH(p) ((p)->growth_known ? (p)->growth : -1e300)
+
+#define ORDERKEY_RETAINED if ((result = (RETAINED(p2) > RETAINED(p1)) - \
+                                        (RETAINED(p2) < RETAINED(p1))) == 0)
+#define ORDERKEY_GROWTH  if ((result = (GROWTH(p2) > GROWTH(p1)) - \
+                                       (GROWTH(p2) < GROWTH(p1))) == 0)
+#define ORDERKEY_SPILL   if ((result = (p2->spill_rate > p1->spill_rate) - \
+                                       (p2->spill_rate < p1->spill_rate)) == 0)
+#define ORDERKEY_STREAM  if ((result = (p2->stream_rate > p1->stream_rate) - \
+                                       (p2->stream_rate < p1->stream_rate)) == 0)
+#define ORDERKEY_SLOT    if ((result = strcmp(p1->name, p2->name)) == 0)
+
+static int
+compare_growth(const void *v1, const void *v2)
+{
+	struct slot *p1 = *(struct slot **) v1;
+	struct slot *p2 = *(struct slot **) v2;
+	int			result;
+
+	ORDERKEY_GROWTH
+		ORDERKEY_RETAINED
+		ORDERKEY_SLOT
+		;
+
+	return (result);
+}
+
+static int
+compare_retained(const void *v1, const void *v2)
+{
+	struct slot *p1 = *(struct slot **) v1;
+	struct slot *p2 = *(struct slot **) v2;
+	int			result;
+
+	ORDERKEY_RETAINED
+		ORDERKEY_GROWTH
+		ORDERKEY_SLOT
+		;
+
+	return (result);
+}
+
+static int
+compare_slot(const void *v1, const void *v2)
+{
+	struct slot *p1 = *(struct slot **) v1;
+	struct slot *p2 = *(struct slot **) v2;
+	int			result;
+
+	ORDERKEY_SLOT
+		;
+
+	return (result);
+}
+
+static int
+compare_spill(const void *v1, const void *v2)
+{
+	struct slot *p1 = *(struct slot **) v1;
+	struct slot *p2 = *(struct slot **) v2;
+	int			result;
+
+	ORDERKEY_SPILL
+		ORDERKEY_STREAM
+		ORDERKEY_RETAINED
+		ORDERKEY_SLOT
+		;
+
+	return (result);
+}
+
+static int
+compare_stream(const void *v1, const void *v2)
+{
+	struct slot *p1 = *(struct slot **) v1;
+	struct slot *p2 = *(struct slot **) v2;
+	int			result;
+
+	ORDERKEY_STREAM
+		ORDERKEY_SPILL
+		ORDERKEY_RETAINED
+		ORDERKEY_SLOT
+		;
+
+	return (result);
+}
@@ -0,0 +1,14 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _SLOTS_H_
+#define _SLOTS_H_
+
+#include "machine.h"
+
+caddr_t		get_slot_info(struct system_info *, struct pg_conninfo_ctx *, int);
+char	   *format_next_slot(caddr_t);
+
+extern char fmt_header_slots[];
+extern char *slot_ordernames[];
+
+#endif							/* _SLOTS_H_ */
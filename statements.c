@@ -0,0 +1,487 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Top statements: the calls, execution time, rows and blocks of each
+ * statement in pg_stat_statements over the time since the last update.
+ *
+ * The calls of every statement last seen are kept on the server, in a
+ * temporary table of the connection, so that only the statements called since
+ * are transferred, along with those that are gone.  The counters last seen
+ * are kept here and the new ones compared with them.  Where the calls cannot
+ * be kept, on a standby or before 9.5, every statement is transferred.  The
+ * text of a statement is only fetched the first time it is shown.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+#include <bsd/sys/tree.h>
+
+#include "display.h"
+#include "statements.h"
+#include "pg.h"
+#include "utils.h"
+
+/* number of counters kept for each statement */
+#define NSTMTSTATS (STMT_TEMP_BLKS - STMT_CALLS + 1)
+
+#define STAT(p, i) ((p)->delta[(i) - STMT_CALLS])
+#define MEAN(p) (STAT(p, STMT_CALLS) > 0 ? \
+		STAT(p, STMT_TOTAL_TIME) / STAT(p, STMT_CALLS) : 0)
+
+/* longest array literal element: a signed 64-bit integer and a comma */
+#define ELEMENT_LEN 21
+
+char		fmt_header_statements[] =
+"             QUERYID   CALLS   TOTAL    MEAN  ROWS/s  READ/s   HIT/s  TEMP/s QUERY";
+
+struct statement
+{
+	RB_ENTRY(statement) entry;
+	long long	queryid;
+
+	/* index for which element is current in data arrays */
+	int			index;
+
+	/* the last sample this statement was seen in */
+	unsigned int sample;
+
+	char	   *query;
+	double		stat[NSTMTSTATS][2];
+	double		delta[NSTMTSTATS];
+};
+
+int			statementcmp(struct statement *, struct statement *);
+
+RB_HEAD(pgstmt, statement) head_stmt = RB_INITIALIZER(&head_stmt);
+RB_PROTOTYPE(pgstmt, statement, entry, statementcmp)
+RB_GENERATE(pgstmt, statement, entry, statementcmp)
+
+static int	compare_calls(const void *, const void *);
+static int	compare_hit(const void *, const void *);
+static int	compare_mean(const void *, const void *);
+static int	compare_read(const void *, const void *);
+static int	compare_rows(const void *, const void *);
+static int	compare_temp(const void *, const void *);
+static int	compare_total(const void *, const void *);
+
+char	   *statement_ordernames[] = {
+	"total", "calls", "mean", "rows", "read", "hit", "temp", NULL
+};
+
+int			(*statement_compares[]) () =
+{
+	compare_total,
+		compare_calls,
+		compare_mean,
+		compare_rows,
+		compare_read,
+		compare_hit,
+		compare_temp,
+		NULL
+};
+
+/* the statements called in the last interval */
+static struct statement **stmttable;
+static int	stmttable_size;
+static int	stmt_index;
+
+static unsigned int sample;
+static double timediff;
+static struct timeval lasttime;
+
+/* the backend last connected to, and whether it keeps the calls last seen */
+static int	tracker_pid;
+static int	tracking;
+
+int
+statementcmp(struct statement *e1, struct statement *e2)
+{
+	return (e1->queryid < e2->queryid ? -1 : e1->queryid > e2->queryid);
+}
+
+static void *
+xreallocarray(void *ptr, size_t nmemb, size_t size,
+			  struct pg_conninfo_ctx *conninfo)
+{
+	void	   *p;
+
+	p = reallocarray(ptr, nmemb, size);
+	if (p == NULL)
+	{
+		fprintf(stderr, "reallocarray error\n");
+		disconnect_from_db(conninfo);
+		exit(1);
+	}
+	return p;
+}
+
+/*
+ * Fill in the text of the statements about to be shown that were not shown
+ * before.
+ */
+static void
+get_statement_texts(PGconn *pgconn, int count)
+{
+	static char *queryids = NULL;
+	static size_t queryids_size = 0;
+	struct statement find,
+			   *n;
+	PGresult   *pgresult;
+	char	   *s;
+	int			i;
+
+	if ((size_t) count * ELEMENT_LEN + 3 > queryids_size)
+	{
+		queryids_size = (size_t) count * ELEMENT_LEN + 3;
+		queryids = realloc(queryids, queryids_size);
+		if (queryids == NULL)
+		{
+			fprintf(stderr, "realloc error\n");
+			exit(1);
+		}
+	}
+
+	s = queryids;
+	*s++ = '{';
+	for (i = 0; i < count; i++)
+		if (stmttable[i]->query == NULL)
+			s += sprintf(s, "%lld,", stmttable[i]->queryid);
+	if (s == queryids + 1)
+		return;
+	s[-1] = '}';
+
+	pgresult = pg_statement_texts(pgconn, queryids);
+	if (PQresultStatus(pgresult) == PGRES_TUPLES_OK)
+	{
+		for (i = 0; i < PQntuples(pgresult); i++)
+		{
+			find.queryid = strtoll(PQgetvalue(pgresult, i, STMT_TEXT_QUERYID),
+								   NULL, 10);
+			n = RB_FIND(pgstmt, &head_stmt, &find);
+			if (n == NULL)
+				continue;
+			update_str(&n->query, PQgetvalue(pgresult, i, STMT_TEXT_QUERY));
+
+			/* show the statement on one line */
+			for (s = n->query; *s != '\0'; s++)
+				if (*s == '\n' || *s == '\r' || *s == '\t')
+					*s = ' ';
+		}
+	}
+	PQclear(pgresult);
+}
+
+/*
+ * Sample pg_stat_statements and gather the statements that were called since
+ * the last sample, sorted by compare_index.  The text is fetched for the
+ * first topn of them.
+ */
+caddr_t
+get_statement_info(struct system_info *si, struct pg_conninfo_ctx *conninfo,
+				   int compare_index, int topn)
+{
+	struct timeval thistime;
+	struct statement *n,
+			   *tmp;
+	PGresult   *pgresult = NULL;
+	int			active_stmts = 0;
+	int			rows = 0;
+	int			i,
+				j;
+	int			fresh;
+	int			whole;
+
+	/* calculate the time difference since our last check */
+	gettimeofday(&thistime, 0);
+	if (lasttime.tv_sec)
+	{
+		timediff = ((thistime.tv_sec - lasttime.tv_sec) +
+					(thistime.tv_usec - lasttime.tv_usec) * 1e-6);
+	}
+	else
+	{
+		timediff = 0;
+	}
+	lasttime = thistime;
+	++sample;
+
+	connect_to_db(conninfo);
+	if (conninfo->connection == NULL)
+	{
+		si->P_ACTIVE = 0;
+		return (caddr_t) 0;
+	}
+
+	/*
+	 * A new connection starts with none of the calls last seen, so all of the
+	 * statements are transferred once, as when they cannot be kept.
+	 */
+	whole = PQbackendPID(conninfo->connection) != tracker_pid || !tracking;
+	if (PQbackendPID(conninfo->connection) != tracker_pid)
+	{
+		tracker_pid = PQbackendPID(conninfo->connection);
+		tracking = pg_statements_track(conninfo->connection) == 0;
+	}
+
+	pgresult = pg_statements(conninfo->connection, tracking);
+	if (pgresult == NULL)
+	{
+		new_message(MT_standout | MT_delayed,
+					" Statements need PostgreSQL 9.4 or later");
+	}
+	else if (PQresultStatus(pgresult) != PGRES_TUPLES_OK)
+	{
+		new_message(MT_standout | MT_delayed, " %s",
+					PQresultErrorMessage(pgresult));
+	}
+	else
+	{
+		rows = PQntuples(pgresult);
+	}
+
+	if (rows > stmttable_size)
+	{
+		stmttable = xreallocarray(stmttable, rows, sizeof(struct statement *),
+								  conninfo);
+		stmttable_size = rows;
+	}
+
+	for (i = 0; i < rows; i++)
+	{
+		struct statement find;
+
+		find.queryid = strtoll(PQgetvalue(pgresult, i, STMT_QUERYID), NULL,
+							   10);
+
+		/* only a statement not seen before needs a node */
+		n = RB_FIND(pgstmt, &head_stmt, &find);
+
+		/* a statement that is gone has no counters */
+		if (PQgetisnull(pgresult, i, STMT_CALLS))
+		{
+			if (n != NULL)
+			{
+				RB_REMOVE(pgstmt, &head_stmt, n);
+				free(n->query);
+				free(n);
+			}
+			continue;
+		}
+
+		fresh = n == NULL;
+		if (fresh)
+		{
+			n = malloc(sizeof(struct statement));
+			if (n == NULL)
+			{
+				fprintf(stderr, "malloc error\n");
+				PQclear(pgresult);
+				disconnect_from_db(conninfo);
+				exit(1);
+			}
+			memset(n, 0, sizeof(struct statement));
+			n->queryid = find.queryid;
+			RB_INSERT(pgstmt, &head_stmt, n);
+		}
+		n->sample = sample;
+
+		for (j = 0; j < NSTMTSTATS; j++)
+			n->stat[j][n->index] =
+				strtod(PQgetvalue(pgresult, i, STMT_CALLS + j), NULL);
+
+		/*
+		 * A statement seen for the first time, or since its statistics were
+		 * reset, has no activity yet.
+		 */
+		if (fresh || n->stat[0][n->index] < n->stat[0][(n->index + 1) % 2])
+			for (j = 0; j < NSTMTSTATS; j++)
+				n->stat[j][(n->index + 1) % 2] = n->stat[j][n->index];
+
+		for (j = 0; j < NSTMTSTATS; j++)
+			n->delta[j] = n->stat[j][n->index] -
+				n->stat[j][(n->index + 1) % 2];
+
+		if (n->delta[0] > 0 && timediff > 0)
+			stmttable[active_stmts++] = n;
+
+		n->index = (n->index + 1) % 2;
+	}
+
+	if (pgresult != NULL)
+		PQclear(pgresult);
+
+	/* forget the statements that were evicted, when all were transferred */
+	if (whole && rows > 0)
+	{
+		RB_FOREACH_SAFE(n, pgstmt, &head_stmt, tmp)
+		{
+			if (n->sample != sample)
+			{
+				RB_REMOVE(pgstmt, &head_stmt, n);
+				free(n->query);
+				free(n);
+			}
+		}
+	}
+
+	if (compare_index >= 0 && active_stmts)
+	{
+		qsort(stmttable, active_stmts, sizeof(struct statement *),
+			  statement_compares[compare_index]);
+	}
+
+	/* only the text of the statements that can be shown is needed */
+	get_statement_texts(conninfo->connection,
+						active_stmts < topn ? active_stmts : topn);
+	disconnect_from_db(conninfo);
+
+	si->P_ACTIVE = active_stmts;
+	stmt_index = 0;
+	return (caddr_t) 0;
+}
+
+static char *
+format_mean(double ms)
+{
+	static char buf[16];
+
+	if (ms >= 1000)
+		return format_n(ms);
+	snprintf(buf, sizeof(buf), "%.2f", ms);
+	return buf;
+}
+
+char *
+format_next_statement(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	struct statement *p = stmttable[stmt_index++];
+
+	snprintf(fmt, sizeof(fmt),
+			 "%20lld %7s %7s %7s %7s %7s %7s %7s %s",
+			 p->queryid,
+			 format_n(STAT(p, STMT_CALLS)),
+			 format_n(STAT(p, STMT_TOTAL_TIME)),
+			 format_mean(MEAN(p)),
+			 format_n(STAT(p, STMT_ROWS) / timediff),
+			 format_n(STAT(p, STMT_SHARED_BLKS_READ) / timediff),
+			 format_n(STAT(p, STMT_SHARED_BLKS_HIT) / timediff),
+			 format_n(STAT(p, STMT_TEMP_BLKS) / timediff),
+			 p->query != NULL ? p->query : "");
+
+	return (fmt);
+}
+
+/* comparison routines for qsort */
+
+#define ORDERKEY_DELTA(i) if ((result = (STAT(p2, i) > STAT(p1, i)) - \
+										 (STAT(p2, i) < STAT(p1, i))) == 0)
+#define ORDERKEY_MEAN if ((result = (MEAN(p2) > MEAN(p1)) - \
+									(MEAN(p2) < MEAN(p1))) == 0)
+#define ORDERKEY_QUERYID if ((result = (p1->queryid > p2->queryid) - \
+									   (p1->queryid < p2->queryid)) == 0)
+
+static int
+compare_total(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_TOTAL_TIME)
+		ORDERKEY_DELTA(STMT_CALLS)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_calls(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_CALLS)
+		ORDERKEY_DELTA(STMT_TOTAL_TIME)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_mean(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_MEAN
+		ORDERKEY_DELTA(STMT_TOTAL_TIME)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_rows(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_ROWS)
+		ORDERKEY_DELTA(STMT_TOTAL_TIME)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_read(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_SHARED_BLKS_READ)
+		ORDERKEY_DELTA(STMT_SHARED_BLKS_HIT)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_hit(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_SHARED_BLKS_HIT)
+		ORDERKEY_DELTA(STMT_SHARED_BLKS_READ)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
+
+static int
+compare_temp(const void *v1, const void *v2)
+{
+	struct statement *p1 = *(struct statement **) v1;
+	struct statement *p2 = *(struct statement **) v2;
+	int			result;
+
+	ORDERKEY_DELTA(STMT_TEMP_BLKS)
+		ORDERKEY_DELTA(STMT_TOTAL_TIME)
+		ORDERKEY_QUERYID
+		;
+
+	return (result);
+}
@@ -0,0 +1,15 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _STATEMENTS_H_
+#define _STATEMENTS_H_
+
+#include "machine.h"
+
+caddr_t		get_statement_info(struct system_info *, struct pg_conninfo_ctx *,
+							   int, int);
+char	   *format_next_statement(caddr_t);
+
+extern char fmt_header_statements[];
+extern char *statement_ordernames[];
+
+#endif							/* _STATEMENTS_H_ */
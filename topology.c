@@ -0,0 +1,324 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+/*
+ * Replication topology: the servers of the fleet drawn as trees, each standby
+ * under the server it replicates from, with how far behind it is on its own
+ * hop and all the way from the top of its tree.
+ *
+ * Every server only knows the standbys directly replicating from it, from
+ * pg_stat_replication, so the trees are put together from the samples of all
+ * of them, taken at once.  A standby is taken to be a server of the fleet when
+ * its application_name is the server's cluster_name or name in the list, or
+ * else when its client_addr is the address the server was connected to on, or
+ * the host it is listed with.  A standby that is not in the fleet is shown,
+ * but what replicates from it cannot be.
+ */
+
+#include "os.h"
+#include <bsd/stdlib.h>
+
+#include "display.h"
+#include "fleet.h"
+#include "topology.h"
+#include "pg.h"
+#include "utils.h"
+
+/* deepest level of a tree that is indented */
+#define MAX_INDENT 6
+
+char		fmt_header_topology[] =
+"NODE                         ROLE    STATE       HOP LAG HOP TIME TOTAL LAG TOTAL TIME STATUS";
+
+struct node
+{
+	struct fleet_server *server;	/* NULL for a standby not in the fleet */
+
+	/* the row about it in the sample of the server it replicates from */
+	PGresult   *hop;
+	int			row;
+
+	int			parent;			/* the node it replicates from, or -1 */
+	int			child;			/* first node replicating from it, or -1 */
+	int			sibling;		/* next node with the same parent, or -1 */
+	int			depth;
+	int			visited;
+
+	long long	replayed;		/* position in WAL, or -1 if unknown */
+	long long	total;			/* bytes behind the top of its tree */
+	double		total_time;		/* seconds, or -1 if unknown */
+};
+
+static struct node *nodes;
+static int	nodes_size;
+static int	nnodes;
+
+/* the order the nodes are shown in, as indexes into nodes */
+static int *shown;
+static int	nshown;
+static int	shown_index;
+
+static void
+add_node(struct fleet_server *server, int parent, PGresult *hop, int row)
+{
+	struct node *n;
+	int		   *o;
+
+	if (nnodes == nodes_size)
+	{
+		nodes_size = nodes_size == 0 ? 16 : nodes_size * 2;
+		n = reallocarray(nodes, nodes_size, sizeof(struct node));
+		o = reallocarray(shown, nodes_size, sizeof(int));
+		if (n == NULL || o == NULL)
+		{
+			fprintf(stderr, "reallocarray error\n");
+			exit(1);
+		}
+		nodes = n;
+		shown = o;
+	}
+
+	n = &nodes[nnodes++];
+	memset(n, 0, sizeof(struct node));
+	n->server = server;
+	n->parent = parent;
+	n->child = -1;
+	n->sibling = -1;
+	n->hop = hop;
+	n->row = row;
+}
+
+/* Find the server of the fleet a standby is, returning its node or -1. */
+static int
+find_standby(PGresult *pgresult, int row, int parent)
+{
+	struct fleet_server *s;
+	char	   *name = PQgetvalue(pgresult, row, DOWNSTREAM_APPLICATION_NAME);
+	char	   *addr = PQgetvalue(pgresult, row, DOWNSTREAM_CLIENT_ADDR);
+	int			i;
+
+	for (i = 0; i < fleet_servers() && *name != '\0'; i++)
+	{
+		s = nodes[i].server;
+		if (i != parent && nodes[i].parent == -1 &&
+			((s->cluster_name != NULL && strcmp(s->cluster_name, name) == 0) ||
+			 strcmp(s->name, name) == 0))
+			return i;
+	}
+	for (i = 0; i < fleet_servers() && *addr != '\0'; i++)
+	{
+		s = nodes[i].server;
+		if (i != parent && nodes[i].parent == -1 &&
+			((s->address != NULL && strcmp(s->address, addr) == 0) ||
+			 (s->host != NULL && strcmp(s->host, addr) == 0)))
+			return i;
+	}
+	return -1;
+}
+
+static long long
+get_bytes(PGresult *pgresult, int row, int column)
+{
+	if (PQgetisnull(pgresult, row, column))
+		return -1;
+	return strtoll(PQgetvalue(pgresult, row, column), NULL, 10);
+}
+
+/*
+ * Put a node and the ones replicating from it in the order shown, adding up
+ * the lag along the way from the top of the tree.
+ */
+static void
+show_tree(int i, int depth, long long top)
+{
+	struct node *n = &nodes[i];
+	struct node *p;
+	double		hop_time;
+	int			c;
+
+	n->visited = 1;
+	n->depth = depth;
+	shown[nshown++] = i;
+
+	/* the position a standby itself reports is the newest there is */
+	if (n->server != NULL && n->server->stats.samples > 0 &&
+		n->server->recovery && n->server->position >= 0)
+		n->replayed = n->server->position;
+	else if (n->hop != NULL)
+		n->replayed = get_bytes(n->hop, n->row, DOWNSTREAM_REPLAYED);
+	else if (n->server != NULL && n->server->stats.samples > 0)
+		n->replayed = n->server->position;
+	else
+		n->replayed = -1;
+
+	if (depth == 0)
+	{
+		top = n->replayed;
+		n->total = -1;
+		n->total_time = 0;
+	}
+	else
+	{
+		p = &nodes[n->parent];
+		/* a standby can be ahead of the top of the tree between samples */
+		if (top < 0 || n->replayed < 0)
+			n->total = -1;
+		else
+			n->total = top > n->replayed ? top - n->replayed : 0;
+		hop_time = PQgetisnull(n->hop, n->row, DOWNSTREAM_LAG_TIME) ? -1 :
+			atof(PQgetvalue(n->hop, n->row, DOWNSTREAM_LAG_TIME));
+		n->total_time = p->total_time >= 0 && hop_time >= 0 ?
+			p->total_time + hop_time : -1;
+	}
+
+	for (c = n->child; c != -1; c = nodes[c].sibling)
+		if (!nodes[c].visited)
+			show_tree(c, depth + 1, top);
+}
+
+/*
+ * Sample the fleet and put the nodes in the order shown: each server that does
+ * not replicate from another in the fleet, in the order listed, followed by
+ * the standbys replicating from it.
+ */
+caddr_t
+get_topology_info(struct system_info *si, struct timeval *delay)
+{
+	struct fleet_server *s;
+	int			servers = fleet_servers();
+	int			i,
+				j,
+				row,
+				rows,
+				head;
+
+	fleet_sample(delay);
+
+	nnodes = 0;
+	nshown = 0;
+	shown_index = 0;
+	for (i = 0; i < servers; i++)
+		add_node(fleet_server(i), -1, NULL, 0);
+
+	for (i = 0; i < servers; i++)
+	{
+		s = nodes[i].server;
+		if (s->downstream == NULL)
+			continue;
+		rows = PQntuples(s->downstream);
+		for (row = 0; row < rows; row++)
+		{
+			if ((j = find_standby(s->downstream, row, i)) == -1)
+			{
+				add_node(NULL, i, s->downstream, row);
+				continue;
+			}
+			nodes[j].parent = i;
+			nodes[j].hop = s->downstream;
+			nodes[j].row = row;
+		}
+	}
+
+	/* link the nodes to their parents, keeping them in the order added */
+	for (i = nnodes - 1; i >= 0; i--)
+	{
+		if (nodes[i].parent == -1)
+			continue;
+		nodes[i].sibling = nodes[nodes[i].parent].child;
+		nodes[nodes[i].parent].child = i;
+	}
+
+	for (i = 0; i < servers; i++)
+		if (nodes[i].parent == -1)
+			show_tree(i, 0, -1);
+
+	/*
+	 * What is left replicates in a circle, as logical replication can.
+	 * Following the parents for as many steps as there are nodes is sure to
+	 * end up in the circle.
+	 */
+	for (i = 0; i < servers; i++)
+	{
+		if (nodes[i].visited)
+			continue;
+		head = i;
+		for (j = 0; j < nnodes; j++)
+			head = nodes[head].parent;
+		show_tree(head, 0, -1);
+	}
+
+	si->P_ACTIVE = nshown;
+	return (caddr_t) 0;
+}
+
+static char *
+format_seconds(char *buf, size_t size, double seconds)
+{
+	if (seconds < 0)
+		buf[0] = '\0';
+	else if (seconds < 60)
+		snprintf(buf, size, "%.2fs", seconds);
+	else
+		snprintf(buf, size, "%s", format_time((long) seconds));
+	return buf;
+}
+
+char *
+format_next_topology(caddr_t handle)
+{
+	static char fmt[MAX_COLS];	/* static area where result is built */
+	char		name[64];
+	char		hop_lag[16];
+	char		hop_time[16];
+	char		total[16];
+	char		total_time[16];
+	struct node *n = &nodes[shown[shown_index++]];
+	struct fleet_server *s = n->server;
+	char	   *role = "";
+	char	   *label;
+	int			depth;
+	long long	lag;
+
+	depth = n->depth < MAX_INDENT ? n->depth : MAX_INDENT;
+	if (s != NULL)
+	{
+		label = s->name;
+		if (s->stats.samples > 0)
+			role = s->recovery ? "standby" : "primary";
+	}
+	else if (*(label = PQgetvalue(n->hop, n->row,
+								  DOWNSTREAM_APPLICATION_NAME)) == '\0')
+		label = PQgetvalue(n->hop, n->row, DOWNSTREAM_CLIENT_ADDR);
+	snprintf(name, sizeof(name), "%*s%s", depth * 2, "", label);
+
+	hop_lag[0] = hop_time[0] = total[0] = total_time[0] = '\0';
+	if (n->hop != NULL)
+	{
+		if (!PQgetisnull(n->hop, n->row, DOWNSTREAM_LAG))
+		{
+			lag = get_bytes(n->hop, n->row, DOWNSTREAM_LAG);
+			snprintf(hop_lag, sizeof(hop_lag), "%s",
+					 lag > 0 ? format_b(lag) : "0");
+		}
+		if (!PQgetisnull(n->hop, n->row, DOWNSTREAM_LAG_TIME))
+			format_seconds(hop_time, sizeof(hop_time),
+						   atof(PQgetvalue(n->hop, n->row,
+										   DOWNSTREAM_LAG_TIME)));
+		if (n->total >= 0)
+			snprintf(total, sizeof(total), "%s", format_b(n->total));
+		if (n->depth > 0)
+			format_seconds(total_time, sizeof(total_time), n->total_time);
+	}
+
+	snprintf(fmt, sizeof(fmt),
+			 "%-28.28s %-7s %-9.9s %9s %8s %9s %10s %s",
+			 printable(name),
+			 role,
+			 n->hop != NULL ? PQgetvalue(n->hop, n->row, DOWNSTREAM_STATE) : "",
+			 hop_lag,
+			 hop_time,
+			 total,
+			 total_time,
+			 s != NULL ? fleet_status(s) : "");
+
+	return (fmt);
+}
@@ -0,0 +1,15 @@
+/*	Copyright (c) 2007-2019, Mark Wong */
+
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <sys/time.h>
+
+#include "machine.h"
+
+caddr_t		get_topology_info(struct system_info *, struct timeval *);
+char	   *format_next_topology(caddr_t);
+
+extern char fmt_header_topology[];
+
+#endif							/* _TOPOLOGY_H_ */
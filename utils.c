@@ -569,7 +569,7 @@ format_b(long long amt)
 		if (amt >= 10000)
 		{
 			amt = (amt + 512) / 1024;
-			tag = 'B';
+			tag = 'M';
 			if (amt >= 10000)
 			{
 				amt = (amt + 512) / 1024;
@@ -583,6 +583,46 @@ format_b(long long amt)
 	return (ret);
 }
 
+/*
+ * format_n(amt) - format a count, such as a rate per second, returning a
+ *		string suitable for display.  Returns a pointer to a static
+ *		area that changes each call.  If "amt" is 10000 or greater,
+ *		then it is formatted as thousands (rounded) with a trailing
+ *		"K".  And so on...
+ */
+
+char *
+format_n(double amt)
+{
+	static char retarray[NUM_STRINGS][16];
+	static int	index = 0;
+	register char *ret;
+	char	   *tag = "";
+
+	ret = retarray[index];
+	index = (index + 1) % NUM_STRINGS;
+
+	if (amt >= 10000)
+	{
+		amt /= 1000;
+		tag = "K";
+		if (amt >= 10000)
+		{
+			amt /= 1000;
+			tag = "M";
+			if (amt >= 10000)
+			{
+				amt /= 1000;
+				tag = "G";
+			}
+		}
+	}
+
+	snprintf(ret, sizeof(retarray[index]) - 1, "%.0f%s", amt, tag);
+
+	return (ret);
+}
+
 /*
  * format_k(amt) - format a kilobyte memory value, returning a string
  *		suitable for display.  Returns a pointer to a static
@@ -29,6 +29,7 @@ char	   *format_percent(double);
 char	   *format_time(long);
 char	   *format_b(long long);
 char	   *format_k(long);
+char	   *format_n(double);
 char	   *string_list(char **);
 void		debug_set(int);
 